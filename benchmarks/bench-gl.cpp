@@ -0,0 +1,105 @@
+#include "scenes.hpp"
+
+#include <ny/ny.hpp>
+#include <ny/common/gl.hpp>
+
+#include <chrono>
+
+// Renders the benchmark scenes with the nanovg GL3 backend for comparison with vvg.
+// The frames are rendered into the window without presenting them, so vsync does
+// not limit the frame rate. The device time is measured with timer queries.
+
+#define NANOVG_GL_IMPLEMENTATION 1
+#define NANOVG_GL3 1
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include "nanovg-gl.h"
+
+int main(int argc, char** argv)
+{
+	auto options = bench::parseOptions(argc, argv);
+
+	// ny init
+	auto& backend = ny::Backend::choose();
+	auto ac = backend.createAppContext();
+
+	auto ws = ny::WindowSettings {};
+	ny::GlSurface* surf {};
+	ws.surface = ny::SurfaceType::gl;
+	ws.size = {bench::width, bench::height};
+	ws.gl.storeSurface = &surf;
+	auto wc = ac->createWindowContext(ws);
+
+	auto context = ac->glSetup()->createContext();
+	context->makeCurrent(*surf);
+
+	auto nvgContext = nvgCreateGL3(NVG_ANTIALIAS | NVG_STENCIL_STROKES);
+	auto resources = bench::createResources(nvgContext, options.font);
+
+	// one query per frame, read after the scene was rendered
+	std::vector<GLuint> queries(options.frames);
+	glGenQueries(queries.size(), queries.data());
+
+	using Clock = std::chrono::steady_clock;
+	using Milliseconds = std::chrono::duration<double, std::milli>;
+
+	std::vector<bench::Result> results;
+	for(auto& scene : bench::scenes) {
+		if(options.scene && std::string(options.scene) != scene.name)
+			continue;
+
+		auto cpuTime = 0.0;
+		auto start = Clock::now();
+		for(auto i = 0u; i < options.warmup + options.frames; ++i) {
+			if(i == options.warmup) {
+				glFinish();
+				start = Clock::now();
+			}
+
+			auto measured = i >= options.warmup;
+			if(measured)
+				glBeginQuery(GL_TIME_ELAPSED, queries[i - options.warmup]);
+
+			auto frameStart = Clock::now();
+			glClearColor(0.f, 0.f, 0.f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+			nvgBeginFrame(nvgContext, bench::width, bench::height, 1.f);
+			scene.render(nvgContext, resources, i);
+			nvgEndFrame(nvgContext);
+
+			if(measured) {
+				cpuTime += Milliseconds(Clock::now() - frameStart).count();
+				glEndQuery(GL_TIME_ELAPSED);
+			}
+
+			glFlush();
+		}
+
+		glFinish();
+		auto total = std::chrono::duration<double>(Clock::now() - start).count();
+
+		auto gpuTime = 0.0;
+		for(auto query : queries) {
+			GLuint64 elapsed {};
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			gpuTime += elapsed / 1000000.0;
+		}
+
+		bench::Result result;
+		result.backend = "gl";
+		result.scene = scene.name;
+		result.frames = options.frames;
+		result.fps = options.frames / total;
+		result.cpuTime = cpuTime / options.frames;
+		result.gpuTime = gpuTime / options.frames;
+		results.push_back(result);
+	}
+
+	bench::report(results, options.json);
+
+	glDeleteQueries(queries.size(), queries.data());
+	bench::destroyResources(nvgContext, resources);
+	nvgDeleteGL3(nvgContext);
+}
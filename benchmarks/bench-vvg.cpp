@@ -0,0 +1,131 @@
+#include "scenes.hpp"
+
+#include <vvg.hpp>
+
+#include <vpp/device.hpp>
+#include <vpp/instance.hpp>
+#include <vpp/vk.hpp>
+
+#include <chrono>
+#include <memory>
+
+// Renders the benchmark scenes with an offscreen vvg Renderer.
+// The device time comes from the profiling stats of the Renderer.
+
+int main(int argc, char** argv)
+{
+	auto options = bench::parseOptions(argc, argv);
+
+	//instance
+	vk::ApplicationInfo appInfo;
+	appInfo.pApplicationName = "vvg-bench";
+	appInfo.applicationVersion = 1;
+	appInfo.pEngineName = "vvg";
+	appInfo.engineVersion = 1;
+	appInfo.apiVersion = VK_MAKE_VERSION(1, 0, 21);
+
+	vk::InstanceCreateInfo iniinfo;
+	iniinfo.pApplicationInfo = &appInfo;
+
+	vpp::Instance instance(iniinfo);
+
+	//device, the first one with a graphics queue
+	auto phdevs = vk::enumeratePhysicalDevices(instance);
+	auto queueProps = vk::getPhysicalDeviceQueueFamilyProperties(phdevs[0]);
+
+	const float prio = 0.0;
+	vk::DeviceQueueCreateInfo queueInfo;
+	queueInfo.queueCount = 1;
+	queueInfo.pQueuePriorities = &prio;
+	for(auto i = 0u; i < queueProps.size(); ++i) {
+		queueInfo.queueFamilyIndex = i;
+		if(queueProps[i].queueFlags & vk::QueueBits::graphics)
+			break;
+	}
+
+	vk::DeviceCreateInfo devinfo;
+	devinfo.queueCreateInfoCount = 1;
+	devinfo.pQueueCreateInfos = &queueInfo;
+
+	vpp::Device dev(instance, phdevs[0], devinfo);
+
+	//renderer
+	vvg::RendererSettings settings;
+	settings.profiling = true;
+
+	auto renderer = std::make_unique<vvg::Renderer>(dev, vk::Format::r8g8b8a8Unorm,
+		vk::Extent2D {bench::width, bench::height}, settings);
+	auto nvgContext = vvg::createContext(std::move(renderer));
+	auto& rendererRef = vvg::getRenderer(*nvgContext);
+
+	auto resources = bench::createResources(nvgContext, options.font);
+
+	//scenes
+	using Clock = std::chrono::steady_clock;
+	using Milliseconds = std::chrono::duration<double, std::milli>;
+
+	std::vector<bench::Result> results;
+	for(auto& scene : bench::scenes) {
+		if(options.scene && std::string(options.scene) != scene.name)
+			continue;
+
+		auto cpuTime = 0.0;
+		auto gpuTime = 0.0;
+		auto gpuFrames = 0u;
+		auto lastStats = std::uint64_t(0);
+		auto firstMeasured = std::uint64_t(0);
+
+		//the stats of a frame are known once its slot is used again, so they are
+		//collected after every begin frame. Only the last of the frames finished by
+		//wait is seen, the device time is averaged over the seen frames
+		auto collect = [&]{
+			auto& stats = rendererRef.stats();
+			if(stats.frame == lastStats)
+				return;
+
+			lastStats = stats.frame;
+			if(firstMeasured && stats.frame >= firstMeasured && stats.gpuTime >= 0.0) {
+				gpuTime += stats.gpuTime;
+				++gpuFrames;
+			}
+		};
+
+		auto start = Clock::now();
+		for(auto i = 0u; i < options.warmup + options.frames; ++i) {
+			if(i == options.warmup) {
+				rendererRef.wait();
+				collect();
+				start = Clock::now();
+				firstMeasured = rendererRef.stats().frame + 1;
+			}
+
+			auto frameStart = Clock::now();
+			nvgBeginFrame(nvgContext, bench::width, bench::height, 1.f);
+			collect();
+
+			scene.render(nvgContext, resources, i);
+			nvgEndFrame(nvgContext);
+
+			if(i >= options.warmup)
+				cpuTime += Milliseconds(Clock::now() - frameStart).count();
+		}
+
+		rendererRef.wait();
+		auto total = std::chrono::duration<double>(Clock::now() - start).count();
+		collect();
+
+		bench::Result result;
+		result.backend = "vvg";
+		result.scene = scene.name;
+		result.frames = options.frames;
+		result.fps = options.frames / total;
+		result.cpuTime = cpuTime / options.frames;
+		result.gpuTime = gpuFrames ? gpuTime / gpuFrames : -1.0;
+		results.push_back(result);
+	}
+
+	bench::report(results, options.json);
+
+	bench::destroyResources(nvgContext, resources);
+	vvg::destroyContext(*nvgContext);
+}
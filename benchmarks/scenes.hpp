@@ -0,0 +1,303 @@
+#pragma once
+
+// The scenes rendered by the benchmarks. They only use the nanovg api so that every
+// backend renders exactly the same frames. All pseudo random values come from a
+// fixed seed, the scenes only change with the frame number.
+
+#include <nanovg.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// The size of the rendered frames.
+constexpr auto width = 1280u;
+constexpr auto height = 720u;
+
+// Resources that are created once per context.
+struct Resources {
+	int font = -1;
+	std::vector<int> images;
+};
+
+// Deterministic pseudo random numbers (xorshift), independent of the standard library.
+class Random {
+public:
+	Random(std::uint32_t seed) : state_(seed ? seed : 1u) {}
+
+	std::uint32_t next()
+	{
+		state_ ^= state_ << 13;
+		state_ ^= state_ >> 17;
+		state_ ^= state_ << 5;
+		return state_;
+	}
+
+	// returns a value in [min, max)
+	float range(float min, float max)
+	{
+		return min + (next() % 65536u) / 65536.f * (max - min);
+	}
+
+	NVGcolor color(float alpha = 1.f)
+	{
+		return nvgRGBAf(range(0.f, 1.f), range(0.f, 1.f), range(0.f, 1.f), alpha);
+	}
+
+protected:
+	std::uint32_t state_;
+};
+
+inline void manyRects(NVGcontext* vg, const Resources&, unsigned int frame)
+{
+	Random random(1);
+	for(auto i = 0u; i < 10000u; ++i) {
+		auto x = random.range(0.f, width) + (frame % 16);
+		auto y = random.range(0.f, height);
+
+		nvgBeginPath(vg);
+		nvgRect(vg, x, y, random.range(2.f, 40.f), random.range(2.f, 40.f));
+		nvgFillColor(vg, random.color(0.8f));
+		nvgFill(vg);
+	}
+}
+
+inline void polylines(NVGcontext* vg, const Resources&, unsigned int frame)
+{
+	Random random(2);
+	for(auto i = 0u; i < 20u; ++i) {
+		auto y = random.range(0.f, height);
+
+		nvgBeginPath(vg);
+		nvgMoveTo(vg, 0.f, y);
+		for(auto j = 1u; j < 1000u; ++j) {
+			y += random.range(-8.f, 8.f);
+			nvgLineTo(vg, j * (width / 1000.f), y + (frame % 8));
+		}
+
+		nvgStrokeWidth(vg, random.range(1.f, 6.f));
+		nvgLineJoin(vg, NVG_ROUND);
+		nvgStrokeColor(vg, random.color());
+		nvgStroke(vg);
+	}
+}
+
+inline void textWall(NVGcontext* vg, const Resources& res, unsigned int frame)
+{
+	if(res.font < 0)
+		return;
+
+	constexpr auto text = "The quick brown fox jumps over the lazy dog 0123456789";
+
+	nvgFontFaceId(vg, res.font);
+	nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+
+	auto y = 0.f;
+	auto row = 0u;
+	while(y < height) {
+		auto size = 10.f + (row % 4) * 4.f;
+		nvgFontSize(vg, size);
+		nvgFillColor(vg, nvgRGBA(255, 255, 255, 200 + (row % 3) * 20));
+		nvgText(vg, -float(frame % 32), y, text, nullptr);
+		nvgText(vg, width / 2.f - float(frame % 32), y, text, nullptr);
+		y += size * 1.2f;
+		++row;
+	}
+}
+
+inline void imageGrid(NVGcontext* vg, const Resources& res, unsigned int frame)
+{
+	if(res.images.empty())
+		return;
+
+	constexpr auto size = 40.f;
+	auto i = std::size_t(frame);
+	for(auto y = 0.f; y < height; y += size) {
+		for(auto x = 0.f; x < width; x += size) {
+			auto image = res.images[i++ % res.images.size()];
+			auto paint = nvgImagePattern(vg, x, y, size, size, 0.f, image, 1.f);
+
+			nvgBeginPath(vg);
+			nvgRect(vg, x + 2.f, y + 2.f, size - 4.f, size - 4.f);
+			nvgFillPaint(vg, paint);
+			nvgFill(vg);
+		}
+	}
+}
+
+inline void gradients(NVGcontext* vg, const Resources&, unsigned int frame)
+{
+	Random random(5);
+	for(auto i = 0u; i < 2000u; ++i) {
+		auto x = random.range(0.f, width);
+		auto y = random.range(0.f, height);
+		auto r = random.range(10.f, 60.f);
+		auto inner = random.color();
+		auto outer = random.color(0.f);
+
+		NVGpaint paint;
+		switch((i + frame) % 3) {
+			case 0: paint = nvgLinearGradient(vg, x - r, y, x + r, y, inner, outer); break;
+			case 1: paint = nvgRadialGradient(vg, x, y, r * 0.2f, r, inner, outer); break;
+			default: paint = nvgBoxGradient(vg, x - r, y - r, 2 * r, 2 * r, 8.f, 12.f,
+				inner, outer); break;
+		}
+
+		nvgBeginPath(vg);
+		nvgCircle(vg, x, y, r);
+		nvgFillPaint(vg, paint);
+		nvgFill(vg);
+	}
+}
+
+inline void scissoring(NVGcontext* vg, const Resources&, unsigned int frame)
+{
+	Random random(6);
+	for(auto i = 0u; i < 3000u; ++i) {
+		auto x = random.range(0.f, width);
+		auto y = random.range(0.f, height);
+
+		nvgSave(vg);
+		nvgTranslate(vg, x, y);
+		nvgRotate(vg, (i + frame) * 0.01f);
+		nvgScissor(vg, -20.f, -20.f, 40.f, 40.f);
+		nvgIntersectScissor(vg, -10.f, -30.f, 60.f, 30.f);
+
+		nvgBeginPath(vg);
+		nvgRoundedRect(vg, -30.f, -30.f, 60.f, 60.f, 6.f);
+		nvgFillColor(vg, random.color(0.7f));
+		nvgFill(vg);
+		nvgRestore(vg);
+	}
+}
+
+using SceneFunction = void(*)(NVGcontext*, const Resources&, unsigned int frame);
+
+struct Scene {
+	const char* name;
+	SceneFunction render;
+};
+
+constexpr Scene scenes[] = {
+	{"rects", manyRects},
+	{"polylines", polylines},
+	{"text", textWall},
+	{"images", imageGrid},
+	{"gradients", gradients},
+	{"scissor", scissoring},
+};
+
+// Creates the font and the images of the image grid scene.
+inline Resources createResources(NVGcontext* vg, const char* fontPath)
+{
+	Resources res;
+	res.font = nvgCreateFont(vg, "sans", fontPath);
+	if(res.font < 0)
+		std::fprintf(stderr, "bench: cannot load font %s, text scene is empty\n", fontPath);
+
+	constexpr auto size = 32;
+	Random random(4);
+	std::vector<unsigned char> pixels(size * size * 4);
+	for(auto i = 0u; i < 16u; ++i) {
+		auto a = random.color();
+		auto b = random.color();
+		for(auto y = 0; y < size; ++y) {
+			for(auto x = 0; x < size; ++x) {
+				auto& color = (((x / 8) + (y / 8)) % 2) ? a : b;
+				auto pixel = &pixels[(y * size + x) * 4];
+				pixel[0] = color.r * 255;
+				pixel[1] = color.g * 255;
+				pixel[2] = color.b * 255;
+				pixel[3] = 255;
+			}
+		}
+
+		res.images.push_back(nvgCreateImageRGBA(vg, size, size, 0, pixels.data()));
+	}
+
+	return res;
+}
+
+inline void destroyResources(NVGcontext* vg, const Resources& res)
+{
+	for(auto image : res.images)
+		nvgDeleteImage(vg, image);
+}
+
+// Command line options shared by all benchmark drivers.
+struct Options {
+	unsigned int frames = 300; // measured frames per scene
+	unsigned int warmup = 30; // not measured frames before them
+	const char* font = BENCH_FONT;
+	const char* scene = nullptr; // only this scene if given
+	bool json = false;
+};
+
+inline Options parseOptions(int argc, char** argv)
+{
+	Options options;
+	for(auto i = 1; i < argc; ++i) {
+		auto arg = argv[i];
+		auto value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+		if(!std::strcmp(arg, "--json")) {
+			options.json = true;
+		} else if(!std::strcmp(arg, "--frames") && value) {
+			options.frames = std::max(std::stoul(value), 1ul);
+			++i;
+		} else if(!std::strcmp(arg, "--warmup") && value) {
+			options.warmup = std::stoul(value);
+			++i;
+		} else if(!std::strcmp(arg, "--font") && value) {
+			options.font = value;
+			++i;
+		} else if(!std::strcmp(arg, "--scene") && value) {
+			options.scene = value;
+			++i;
+		} else {
+			std::fprintf(stderr, "usage: %s [--frames n] [--warmup n] [--scene name] "
+				"[--font path] [--json]\n", argv[0]);
+			std::exit(1);
+		}
+	}
+
+	return options;
+}
+
+// The measured results of one scene.
+struct Result {
+	const char* backend;
+	const char* scene;
+	unsigned int frames;
+	double fps; // frames per second, including waiting for the device
+	double cpuTime; // cpu milliseconds per frame from begin to end frame
+	double gpuTime; // device milliseconds per frame, -1 if unknown
+};
+
+// Prints the results as csv (with a header) or as one json array.
+inline void report(const std::vector<Result>& results, bool json)
+{
+	if(json) {
+		std::printf("[\n");
+		for(auto i = 0u; i < results.size(); ++i) {
+			auto& r = results[i];
+			std::printf("\t{\"backend\": \"%s\", \"scene\": \"%s\", \"frames\": %u, "
+				"\"fps\": %.2f, \"cpuMs\": %.4f, \"gpuMs\": %.4f}%s\n", r.backend, r.scene,
+				r.frames, r.fps, r.cpuTime, r.gpuTime, (i + 1 < results.size()) ? "," : "");
+		}
+		std::printf("]\n");
+		return;
+	}
+
+	std::printf("backend,scene,frames,fps,cpuMs,gpuMs\n");
+	for(auto& r : results)
+		std::printf("%s,%s,%u,%.2f,%.4f,%.4f\n", r.backend, r.scene, r.frames, r.fps,
+			r.cpuTime, r.gpuTime);
+}
+
+} // namespace bench
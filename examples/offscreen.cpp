@@ -1,7 +1,5 @@
 #include <vvg.hpp>
 
-#include <vpp/framebuffer.hpp>
-#include <vpp/image.hpp>
 #include <vpp/device.hpp>
 #include <vpp/instance.hpp>
 #include <vpp/debug.hpp>
@@ -9,11 +7,13 @@
 
 #include <nanovg.h>
 
+#include <deque>
+#include <memory>
+#include <string>
+
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-vpp::RenderPass initRenderPass(const vpp::Device& dev, vk::Format format);
-
 int main()
 {
 	//init vulkan stuff
@@ -61,106 +61,53 @@ int main()
 
 	vpp::Device dev(instance, phdevs[0], devinfo);
 
-	//renderPass
-	auto renderPass = initRenderPass(dev, vk::Format::r8g8b8a8Unorm);
-
-	//framebuffer
-	auto width = 1024;
-	auto height = 1024;
-
-	auto colorAttachment = vpp::ViewableImage::defaultColor2D();
-	// colorAttachment.imgInfo.extent = {width, height, 1};
-	colorAttachment.imgInfo.usage |= vk::ImageUsageBits::colorAttachment | vk::ImageUsageBits::transferSrc;
-	colorAttachment.imgInfo.format = vk::Format::r8g8b8a8Unorm;
-	colorAttachment.imgInfo.tiling = vk::ImageTiling::linear;
-	colorAttachment.viewInfo.format = vk::Format::r8g8b8a8Unorm;
-
-	// colorAttachment.memoryTypeBits = dev.memoryTypeBits(vk::MemoryPropertyBits::hostVisible);
-	// auto depthAttachment = vpp::ViewableImage::defaultDepth2D();
-
-	vpp::Framebuffer framebuffer(dev, renderPass, {width, height},
-		{colorAttachment});
-
-	//create the nanovg context
-	auto nvgContext = vvg::createContext(framebuffer, renderPass);
-	nvgBeginFrame(nvgContext, width, height, width / (float)height);
-
-	nvgBeginPath(nvgContext);
-	nvgMoveTo(nvgContext, 10, 10);
-	nvgLineTo(nvgContext, 10, 400);
-	nvgLineTo(nvgContext, 100, 400);
-	nvgQuadTo(nvgContext, 100, 50, 400, 120);
-	nvgLineTo(nvgContext, 450, 10);
-	nvgClosePath(nvgContext);
-	nvgFillColor(nvgContext, nvgRGBAf(0.5, 0.8, 0.7, 0.7));
-	nvgFill(nvgContext);
+	//offscreen renderer, renders up to framesInFlight images at the same time and
+	//reads them back asynchronously
+	const auto width = 1024u;
+	const auto height = 1024u;
+	const auto count = 8u;
+
+	vvg::RendererSettings settings;
+	settings.framesInFlight = 3;
+
+	auto renderer = std::make_unique<vvg::Renderer>(dev, vk::Format::r8g8b8a8Unorm,
+		vk::Extent2D {width, height}, settings);
+	auto nvgContext = vvg::createContext(std::move(renderer));
+	auto& rendererRef = vvg::getRenderer(*nvgContext);
+
+	//writes the given readback into a file once the device has finished it
+	auto write = [&](const vvg::Readback& readback) {
+		vk::waitForFences(dev, {readback.fence}, true, UINT64_MAX);
+		auto name = "test" + std::to_string(readback.frame) + ".png";
+		stbi_write_png(name.c_str(), width, height, 4, readback.data, width * 4);
+	};
+
+	std::deque<vvg::Readback> pending;
+	for(auto i = 0u; i < count; ++i) {
+		//the data of a readback is only valid until its frame slot is used again
+		if(pending.size() == settings.framesInFlight) {
+			write(pending.front());
+			pending.pop_front();
+		}
+
+		nvgBeginFrame(nvgContext, width, height, width / (float)height);
+
+		nvgBeginPath(nvgContext);
+		nvgMoveTo(nvgContext, 10, 10);
+		nvgLineTo(nvgContext, 10, 400);
+		nvgLineTo(nvgContext, 100 + 50 * i, 400);
+		nvgQuadTo(nvgContext, 100, 50, 400, 120);
+		nvgLineTo(nvgContext, 450, 10);
+		nvgClosePath(nvgContext);
+		nvgFillColor(nvgContext, nvgRGBAf(0.5, 0.8, 0.7, 0.7));
+		nvgFill(nvgContext);
+
+		nvgEndFrame(nvgContext);
+		pending.push_back(rendererRef.readback());
+	}
 
-	nvgEndFrame(nvgContext);
+	for(auto& readback : pending)
+		write(readback);
 
 	vvg::destroyContext(*nvgContext);
-
-	//write the image to a file
-	auto layout = vk::ImageLayout::presentSrcKHR;
-	auto ptr = vpp::retrieve(framebuffer.attachments()[0].image(), layout,
-		vk::Format::r8g8b8a8Unorm, {width, height, 1}, {vk::ImageAspectBits::color, 0, 1});
-	auto& data = *ptr->data().data();
-	return stbi_write_png("test1.png", width, height, 4, &data, width * 4);
-}
-
-vpp::RenderPass initRenderPass(const vpp::Device& dev, vk::Format format)
-{
-	vk::AttachmentDescription attachments[1] {};
-
-	//color from swapchain
-	attachments[0].format = format;
-	attachments[0].samples = vk::SampleCountBits::e1;
-	attachments[0].loadOp = vk::AttachmentLoadOp::clear;
-	attachments[0].storeOp = vk::AttachmentStoreOp::store;
-	attachments[0].stencilLoadOp = vk::AttachmentLoadOp::dontCare;
-	attachments[0].stencilStoreOp = vk::AttachmentStoreOp::dontCare;
-	attachments[0].initialLayout = vk::ImageLayout::undefined;
-	attachments[0].finalLayout = vk::ImageLayout::presentSrcKHR;
-
-	vk::AttachmentReference colorReference;
-	colorReference.attachment = 0;
-	colorReference.layout = vk::ImageLayout::colorAttachmentOptimal;
-
-	//depth from own depth stencil
-	// attachments[1].format = vk::Format::d16UnormS8Uint;
-	// attachments[1].samples = vk::SampleCountBits::e1;
-	// attachments[1].loadOp = vk::AttachmentLoadOp::clear;
-	// attachments[1].storeOp = vk::AttachmentStoreOp::store;
-	// attachments[1].stencilLoadOp = vk::AttachmentLoadOp::dontCare;
-	// attachments[1].stencilStoreOp = vk::AttachmentStoreOp::dontCare;
-	// attachments[1].initialLayout = vk::ImageLayout::undefined;
-	// attachments[1].finalLayout = vk::ImageLayout::undefined;
-	// attachments[1].initialLayout = vk::ImageLayout::depthStencilAttachmentOptimal;
-	// attachments[1].finalLayout = vk::ImageLayout::depthStencilAttachmentOptimal;
-
-	// vk::AttachmentReference depthReference;
-	// depthReference.attachment = 1;
-	// depthReference.layout = vk::ImageLayout::depthStencilAttachmentOptimal;
-
-	//only subpass
-	vk::SubpassDescription subpass;
-	subpass.pipelineBindPoint = vk::PipelineBindPoint::graphics;
-	subpass.flags = {};
-	subpass.inputAttachmentCount = 0;
-	subpass.pInputAttachments = nullptr;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorReference;
-	subpass.pResolveAttachments = nullptr;
-	subpass.pDepthStencilAttachment = nullptr;
-	subpass.preserveAttachmentCount = 0;
-	subpass.pPreserveAttachments = nullptr;
-
-	vk::RenderPassCreateInfo renderPassInfo;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = attachments;
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 0;
-	renderPassInfo.pDependencies = nullptr;
-
-	return {dev, renderPassInfo};
 }
@@ -24,8 +24,20 @@
 enum FONSflags {
 	FONS_ZERO_TOPLEFT = 1,
 	FONS_ZERO_BOTTOMLEFT = 2,
+	// Glyphs are rasterized once at FONS_SDF_SIZE as signed distance field and the quads
+	// are scaled to the requested size. The atlas stores the distance as signed bytes
+	// (positive inside, +-127 at FONS_SDF_SPREAD pixels) and the blur is left to the renderer.
+	FONS_SDF = 4,
 };
 
+// Pixel size and maximal distance of the glyphs of FONS_SDF atlases.
+#ifndef FONS_SDF_SIZE
+#	define FONS_SDF_SIZE 48
+#endif
+#ifndef FONS_SDF_SPREAD
+#	define FONS_SDF_SPREAD 6
+#endif
+
 enum FONSalign {
 	// Horizontal align
 	FONS_ALIGN_LEFT 	= 1<<0,	// Default
@@ -1006,6 +1018,51 @@ static void fons__blur(FONScontext* stash, unsigned char* dst, int w, int h, int
 //	fons__blurcols(dst, w, h, dstStride, alpha);
 }
 
+// Converts the coverage bitmap at dst into a signed distance field in place.
+// The distance to the outline is estimated from the nearest pixel on the other side,
+// corrected by its coverage, so the zero crossing keeps the antialiased edge position.
+static void fons__sdf(FONScontext* stash, unsigned char* dst, int w, int h, int dstStride)
+{
+	int x, y, i, j, dx, dy, inside;
+	int r = FONS_SDF_SPREAD;
+	float a, b, d, best;
+	unsigned char* cov;
+
+	stash->nscratch = 0;
+	cov = (unsigned char*)fons__tmpalloc(w*h, stash);
+	if (cov == NULL) {
+		// The error was reported by fons__tmpalloc. Leave an empty glyph (everywhere outside)
+		// instead of the coverage, which would be read as distances.
+		for (y = 0; y < h; y++)
+			memset(&dst[y*dstStride], (unsigned char)(signed char)-127, w);
+		return;
+	}
+	for (y = 0; y < h; y++)
+		memcpy(&cov[y*w], &dst[y*dstStride], w);
+
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			a = cov[x + y*w] / 255.0f;
+			inside = a >= 0.5f;
+			best = (float)r;
+			for (j = fons__maxi(0, y-r); j <= fons__mini(h-1, y+r); j++) {
+				for (i = fons__maxi(0, x-r); i <= fons__mini(w-1, x+r); i++) {
+					b = cov[i + j*w] / 255.0f;
+					if (inside ? b >= 1.0f : b <= 0.0f) continue;
+					dx = i-x;
+					dy = j-y;
+					// The coverage correction is at most 0.5
+					if ((float)(dx*dx + dy*dy) >= (best+0.5f)*(best+0.5f)) continue;
+					d = sqrtf((float)(dx*dx + dy*dy)) + (inside ? b - 0.5f : 0.5f - b);
+					if (d < best) best = d;
+				}
+			}
+			d = (inside ? best : -best) / r;
+			dst[x + y*dstStride] = (unsigned char)(signed char)floorf(d * 127.0f + 0.5f);
+		}
+	}
+}
+
 static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
 								 short isize, short iblur)
 {
@@ -1022,6 +1079,14 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	if (iblur > 20) iblur = 20;
 	pad = iblur+2;
 
+	// Distance field glyphs serve all sizes and blurs.
+	if (stash->params.flags & FONS_SDF) {
+		isize = FONS_SDF_SIZE*10;
+		iblur = 0;
+		pad = FONS_SDF_SPREAD+2;
+		size = (float)FONS_SDF_SIZE;
+	}
+
 	// Reset allocator.
 	stash->nscratch = 0;
 
@@ -1094,6 +1159,10 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 		}
 	}*/
 
+	if (stash->params.flags & FONS_SDF) {
+		fons__sdf(stash, &stash->texData[glyph->x0 + glyph->y0 * stash->params.width], gw,gh, stash->params.width);
+	}
+
 	// Blur
 	if (iblur > 0) {
 		stash->nscratch = 0;
@@ -1110,10 +1179,12 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 }
 
 static void fons__getQuad(FONScontext* stash, FONSfont* font,
-						   int prevGlyphIndex, FONSglyph* glyph,
+						   int prevGlyphIndex, FONSglyph* glyph, short isize,
 						   float scale, float spacing, float* x, float* y, FONSquad* q)
 {
 	float rx,ry,xoff,yoff,x0,y0,x1,y1;
+	// Distance field glyphs are scaled from their size to the requested one.
+	float gs = (float)isize / glyph->size;
 
 	if (prevGlyphIndex != -1) {
 		float adv = fons__tt_getGlyphKernAdvance(&font->font, prevGlyphIndex, glyph->index) * scale;
@@ -1123,8 +1194,8 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 	// Each glyph has 2px border to allow good interpolation,
 	// one pixel to prevent leaking, and one to allow good interpolation for rendering.
 	// Inset the texture region by one pixel for correct interpolation.
-	xoff = (short)(glyph->xoff+1);
-	yoff = (short)(glyph->yoff+1);
+	xoff = (short)(glyph->xoff+1) * gs;
+	yoff = (short)(glyph->yoff+1) * gs;
 	x0 = (float)(glyph->x0+1);
 	y0 = (float)(glyph->y0+1);
 	x1 = (float)(glyph->x1-1);
@@ -1136,8 +1207,8 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 
 		q->x0 = rx;
 		q->y0 = ry;
-		q->x1 = rx + x1 - x0;
-		q->y1 = ry + y1 - y0;
+		q->x1 = rx + (x1 - x0) * gs;
+		q->y1 = ry + (y1 - y0) * gs;
 
 		q->s0 = x0 * stash->itw;
 		q->t0 = y0 * stash->ith;
@@ -1149,8 +1220,8 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 
 		q->x0 = rx;
 		q->y0 = ry;
-		q->x1 = rx + x1 - x0;
-		q->y1 = ry - y1 + y0;
+		q->x1 = rx + (x1 - x0) * gs;
+		q->y1 = ry - (y1 - y0) * gs;
 
 		q->s0 = x0 * stash->itw;
 		q->t0 = y0 * stash->ith;
@@ -1158,7 +1229,7 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 		q->t1 = y1 * stash->ith;
 	}
 
-	*x += (int)(glyph->xadv / 10.0f + 0.5f);
+	*x += (int)(glyph->xadv * gs / 10.0f + 0.5f);
 }
 
 static void fons__flush(FONScontext* stash)
@@ -1262,7 +1333,7 @@ float fonsDrawText(FONScontext* stash,
 			continue;
 		glyph = fons__getGlyph(stash, font, codepoint, isize, iblur);
 		if (glyph != NULL) {
-			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+			fons__getQuad(stash, font, prevGlyphIndex, glyph, isize, scale, state->spacing, &x, &y, &q);
 
 			if (stash->nverts+6 > FONS_VERTEX_COUNT)
 				fons__flush(stash);
@@ -1345,7 +1416,7 @@ int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, FONSquad* quad)
 		iter->y = iter->nexty;
 		glyph = fons__getGlyph(stash, iter->font, iter->codepoint, iter->isize, iter->iblur);
 		if (glyph != NULL)
-			fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
+			fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->isize, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
 		iter->prevGlyphIndex = glyph != NULL ? glyph->index : -1;
 		break;
 	}
@@ -1442,7 +1513,7 @@ float fonsTextBounds(FONScontext* stash,
 			continue;
 		glyph = fons__getGlyph(stash, font, codepoint, isize, iblur);
 		if (glyph != NULL) {
-			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+			fons__getQuad(stash, font, prevGlyphIndex, glyph, isize, scale, state->spacing, &x, &y, &q);
 			if (q.x0 < minx) minx = q.x0;
 			if (q.x1 > maxx) maxx = q.x1;
 			if (stash->params.flags & FONS_ZERO_TOPLEFT) {
@@ -21,6 +21,20 @@
 #include <math.h>
 #include <memory.h>
 
+#if !defined(NVG_NO_SIMD)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NVG_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define NVG_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define NVG_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
 #include "nanovg.h"
 #define FONTSTASH_IMPLEMENTATION
 #include "fontstash.h"
@@ -107,6 +121,42 @@ struct NVGpathCache {
 };
 typedef struct NVGpathCache NVGpathCache;
 
+// The SIMD kernels used for tessellation, see nvg__selectKernels.
+struct NVGkernels {
+	void (*transformPoints)(float* dst, const float* src, int npts, const float* t);
+	void (*segmentDirs)(NVGpoint* pts, int npts, float* bounds);
+	void (*joinPoints)(NVGpoint* pts, int npts, float iw, int lineJoin, float miterLimit,
+					   int* nleft, int* nbevel);
+	NVGvertex* (*extrudePoints)(NVGvertex* dst, const NVGpoint* pts, int npts,
+								float lw, float rw, float lu, float ru);
+};
+
+typedef struct NVGkernels NVGkernels;
+static const NVGkernels* nvg__selectKernels(void);
+
+enum NVGtessOp {
+	NVG_TESS_FLATTEN,
+	NVG_TESS_FILL,
+	NVG_TESS_STROKE,
+};
+
+// A range of sub-paths tessellated in parallel into its own cache.
+struct NVGtessJob {
+	NVGpathCache* cache;
+	int begin, end; // command range, starts with a move
+};
+typedef struct NVGtessJob NVGtessJob;
+
+// The parameters of the current parallel tessellation operation.
+struct NVGtessParams {
+	int op;
+	float w;
+	int lineCap;
+	int lineJoin;
+	float miterLimit;
+};
+typedef struct NVGtessParams NVGtessParams;
+
 struct NVGcontext {
 	NVGparams params;
 	float* commands;
@@ -127,6 +177,17 @@ struct NVGcontext {
 	int fillTriCount;
 	int strokeTriCount;
 	int textTriCount;
+	const NVGkernels* kernels;
+	NVGdispatchFunc dispatch;
+	void* dispatchPtr;
+	int maxJobs;
+	int minJobCommands;
+	NVGtessJob* jobs;
+	int njobs;
+	int cjobs;
+	NVGtessParams tessParams;
+	int shapeValid;
+	NVGshape shape;
 };
 
 static float nvg__sqrtf(float a) { return sqrtf(a); }
@@ -203,6 +264,11 @@ static void nvg__setDevicePixelRatio(NVGcontext* ctx, float ratio)
 	ctx->devicePxRatio = ratio;
 }
 
+static int nvg__fontTextureType(NVGcontext* ctx)
+{
+	return ctx->params.sdfText ? NVG_TEXTURE_SDF : NVG_TEXTURE_ALPHA;
+}
+
 NVGcontext* nvgCreateInternal(NVGparams* params)
 {
 	FONSparams fontParams;
@@ -223,6 +289,8 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 	ctx->cache = nvg__allocPathCache();
 	if (ctx->cache == NULL) goto error;
 
+	ctx->kernels = nvg__selectKernels();
+
 	nvgSave(ctx);
 	nvgReset(ctx);
 
@@ -235,6 +303,8 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 	fontParams.width = NVG_INIT_FONTIMAGE_SIZE;
 	fontParams.height = NVG_INIT_FONTIMAGE_SIZE;
 	fontParams.flags = FONS_ZERO_TOPLEFT;
+	if (ctx->params.sdfText)
+		fontParams.flags |= FONS_SDF;
 	fontParams.renderCreate = NULL;
 	fontParams.renderUpdate = NULL;
 	fontParams.renderDraw = NULL;
@@ -244,7 +314,7 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 	if (ctx->fs == NULL) goto error;
 
 	// Create font texture
-	ctx->fontImages[0] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, fontParams.width, fontParams.height, 0, NULL);
+	ctx->fontImages[0] = ctx->params.renderCreateTexture(ctx->params.userPtr, nvg__fontTextureType(ctx), fontParams.width, fontParams.height, 0, NULL);
 	if (ctx->fontImages[0] == 0) goto error;
 	ctx->fontImageIdx = 0;
 
@@ -266,6 +336,11 @@ void nvgDeleteInternal(NVGcontext* ctx)
 	if (ctx == NULL) return;
 	if (ctx->commands != NULL) free(ctx->commands);
 	if (ctx->cache != NULL) nvg__deletePathCache(ctx->cache);
+	if (ctx->jobs != NULL) {
+		for (i = 0; i < ctx->cjobs; i++)
+			nvg__deletePathCache(ctx->jobs[i].cache);
+		free(ctx->jobs);
+	}
 
 	if (ctx->fs)
 		fonsDeleteInternal(ctx->fs);
@@ -968,6 +1043,9 @@ static void nvg__appendCommands(NVGcontext* ctx, float* vals, int nvals)
 	NVGstate* state = nvg__getState(ctx);
 	int i;
 
+	// Any further command turns the path into something the shape fast path can't describe.
+	ctx->shapeValid = 0;
+
 	if (ctx->ncommands+nvals > ctx->ccommands) {
 		float* commands;
 		int ccommands = ctx->ncommands+nvals + ctx->ccommands/2;
@@ -996,9 +1074,7 @@ static void nvg__appendCommands(NVGcontext* ctx, float* vals, int nvals)
 			i += 3;
 			break;
 		case NVG_BEZIERTO:
-			nvgTransformPoint(&vals[i+1],&vals[i+2], state->xform, vals[i+1],vals[i+2]);
-			nvgTransformPoint(&vals[i+3],&vals[i+4], state->xform, vals[i+3],vals[i+4]);
-			nvgTransformPoint(&vals[i+5],&vals[i+6], state->xform, vals[i+5],vals[i+6]);
+			ctx->kernels->transformPoints(&vals[i+1], &vals[i+1], 3, state->xform);
 			i += 7;
 			break;
 		case NVG_CLOSE:
@@ -1022,84 +1098,85 @@ static void nvg__clearPathCache(NVGcontext* ctx)
 {
 	ctx->cache->npoints = 0;
 	ctx->cache->npaths = 0;
+	ctx->njobs = 0;
 }
 
-static NVGpath* nvg__lastPath(NVGcontext* ctx)
+static NVGpath* nvg__lastPath(NVGpathCache* cache)
 {
-	if (ctx->cache->npaths > 0)
-		return &ctx->cache->paths[ctx->cache->npaths-1];
+	if (cache->npaths > 0)
+		return &cache->paths[cache->npaths-1];
 	return NULL;
 }
 
-static void nvg__addPath(NVGcontext* ctx)
+static void nvg__addPath(NVGpathCache* cache)
 {
 	NVGpath* path;
-	if (ctx->cache->npaths+1 > ctx->cache->cpaths) {
+	if (cache->npaths+1 > cache->cpaths) {
 		NVGpath* paths;
-		int cpaths = ctx->cache->npaths+1 + ctx->cache->cpaths/2;
-		paths = (NVGpath*)realloc(ctx->cache->paths, sizeof(NVGpath)*cpaths);
+		int cpaths = cache->npaths+1 + cache->cpaths/2;
+		paths = (NVGpath*)realloc(cache->paths, sizeof(NVGpath)*cpaths);
 		if (paths == NULL) return;
-		ctx->cache->paths = paths;
-		ctx->cache->cpaths = cpaths;
+		cache->paths = paths;
+		cache->cpaths = cpaths;
 	}
-	path = &ctx->cache->paths[ctx->cache->npaths];
+	path = &cache->paths[cache->npaths];
 	memset(path, 0, sizeof(*path));
-	path->first = ctx->cache->npoints;
+	path->first = cache->npoints;
 	path->winding = NVG_CCW;
 
-	ctx->cache->npaths++;
+	cache->npaths++;
 }
 
-static NVGpoint* nvg__lastPoint(NVGcontext* ctx)
+static NVGpoint* nvg__lastPoint(NVGpathCache* cache)
 {
-	if (ctx->cache->npoints > 0)
-		return &ctx->cache->points[ctx->cache->npoints-1];
+	if (cache->npoints > 0)
+		return &cache->points[cache->npoints-1];
 	return NULL;
 }
 
-static void nvg__addPoint(NVGcontext* ctx, float x, float y, int flags)
+static void nvg__addPoint(NVGcontext* ctx, NVGpathCache* cache, float x, float y, int flags)
 {
-	NVGpath* path = nvg__lastPath(ctx);
+	NVGpath* path = nvg__lastPath(cache);
 	NVGpoint* pt;
 	if (path == NULL) return;
 
-	if (path->count > 0 && ctx->cache->npoints > 0) {
-		pt = nvg__lastPoint(ctx);
+	if (path->count > 0 && cache->npoints > 0) {
+		pt = nvg__lastPoint(cache);
 		if (nvg__ptEquals(pt->x,pt->y, x,y, ctx->distTol)) {
 			pt->flags |= flags;
 			return;
 		}
 	}
 
-	if (ctx->cache->npoints+1 > ctx->cache->cpoints) {
+	if (cache->npoints+1 > cache->cpoints) {
 		NVGpoint* points;
-		int cpoints = ctx->cache->npoints+1 + ctx->cache->cpoints/2;
-		points = (NVGpoint*)realloc(ctx->cache->points, sizeof(NVGpoint)*cpoints);
+		int cpoints = cache->npoints+1 + cache->cpoints/2;
+		points = (NVGpoint*)realloc(cache->points, sizeof(NVGpoint)*cpoints);
 		if (points == NULL) return;
-		ctx->cache->points = points;
-		ctx->cache->cpoints = cpoints;
+		cache->points = points;
+		cache->cpoints = cpoints;
 	}
 
-	pt = &ctx->cache->points[ctx->cache->npoints];
+	pt = &cache->points[cache->npoints];
 	memset(pt, 0, sizeof(*pt));
 	pt->x = x;
 	pt->y = y;
 	pt->flags = (unsigned char)flags;
 
-	ctx->cache->npoints++;
+	cache->npoints++;
 	path->count++;
 }
 
-static void nvg__closePath(NVGcontext* ctx)
+static void nvg__closePath(NVGpathCache* cache)
 {
-	NVGpath* path = nvg__lastPath(ctx);
+	NVGpath* path = nvg__lastPath(cache);
 	if (path == NULL) return;
 	path->closed = 1;
 }
 
-static void nvg__pathWinding(NVGcontext* ctx, int winding)
+static void nvg__pathWinding(NVGpathCache* cache, int winding)
 {
-	NVGpath* path = nvg__lastPath(ctx);
+	NVGpath* path = nvg__lastPath(cache);
 	if (path == NULL) return;
 	path->winding = winding;
 }
@@ -1111,18 +1188,18 @@ static float nvg__getAverageScale(float *t)
 	return (sx + sy) * 0.5f;
 }
 
-static NVGvertex* nvg__allocTempVerts(NVGcontext* ctx, int nverts)
+static NVGvertex* nvg__allocTempVerts(NVGpathCache* cache, int nverts)
 {
-	if (nverts > ctx->cache->cverts) {
+	if (nverts > cache->cverts) {
 		NVGvertex* verts;
 		int cverts = (nverts + 0xff) & ~0xff; // Round up to prevent allocations when things change just slightly.
-		verts = (NVGvertex*)realloc(ctx->cache->verts, sizeof(NVGvertex)*cverts);
+		verts = (NVGvertex*)realloc(cache->verts, sizeof(NVGvertex)*cverts);
 		if (verts == NULL) return NULL;
-		ctx->cache->verts = verts;
-		ctx->cache->cverts = cverts;
+		cache->verts = verts;
+		cache->cverts = cverts;
 	}
 
-	return ctx->cache->verts;
+	return cache->verts;
 }
 
 static float nvg__triarea2(float ax, float ay, float bx, float by, float cx, float cy)
@@ -1169,7 +1246,648 @@ static void nvg__vset(NVGvertex* vtx, float x, float y, float u, float v)
 	vtx->v = v;
 }
 
-static void nvg__tesselateBezier(NVGcontext* ctx,
+//
+// SIMD kernels
+//
+// The hot per-point loops of the tessellation are implemented once in scalar
+// code and once per instruction set. All variants do the same operations in
+// the same order, so their results are identical unless the compiler contracts
+// the scalar code into fused multiply-adds. The variant is selected at runtime
+// when the context is created. Define NVG_NO_SIMD to only use the scalar code.
+
+static void nvg__transformPointsC(float* dst, const float* src, int npts, const float* t)
+{
+	int i;
+	for (i = 0; i < npts; i++)
+		nvgTransformPoint(&dst[i*2], &dst[i*2+1], t, src[i*2], src[i*2+1]);
+}
+
+// Calculates direction and length of the segment p0 -> p1.
+static void nvg__segmentDir(NVGpoint* p0, const NVGpoint* p1, float* bounds)
+{
+	p0->dx = p1->x - p0->x;
+	p0->dy = p1->y - p0->y;
+	p0->len = nvg__normalize(&p0->dx, &p0->dy);
+	// Update bounds
+	bounds[0] = nvg__minf(bounds[0], p0->x);
+	bounds[1] = nvg__minf(bounds[1], p0->y);
+	bounds[2] = nvg__maxf(bounds[2], p0->x);
+	bounds[3] = nvg__maxf(bounds[3], p0->y);
+}
+
+// Calculates the segments from pts[i] to pts[i+1] for i in [0..npts).
+static void nvg__segmentDirsC(NVGpoint* pts, int npts, float* bounds)
+{
+	int i;
+	for (i = 0; i < npts; i++)
+		nvg__segmentDir(&pts[i], &pts[i+1], bounds);
+}
+
+static void nvg__joinFlags(NVGpoint* p1, int left, int innerBevel, int miterBevel, int lineJoin,
+						   int* nleft, int* nbevel)
+{
+	// Clear flags, but keep the corner.
+	p1->flags = (p1->flags & NVG_PT_CORNER) ? NVG_PT_CORNER : 0;
+
+	// Keep track of left turns.
+	if (left) {
+		(*nleft)++;
+		p1->flags |= NVG_PT_LEFT;
+	}
+
+	// Calculate if we should use bevel or miter for inner join.
+	if (innerBevel)
+		p1->flags |= NVG_PR_INNERBEVEL;
+
+	// Check to see if the corner needs to be beveled.
+	if (p1->flags & NVG_PT_CORNER) {
+		if (miterBevel || lineJoin == NVG_BEVEL || lineJoin == NVG_ROUND) {
+			p1->flags |= NVG_PT_BEVEL;
+		}
+	}
+
+	if ((p1->flags & (NVG_PT_BEVEL | NVG_PR_INNERBEVEL)) != 0)
+		(*nbevel)++;
+}
+
+// Calculates the extrusion and join flags of p1 between the segments p0 and p1.
+static void nvg__joinPoint(const NVGpoint* p0, NVGpoint* p1, float iw, int lineJoin, float miterLimit,
+						   int* nleft, int* nbevel)
+{
+	float dlx0, dly0, dlx1, dly1, dmr2, cross, limit;
+	dlx0 = p0->dy;
+	dly0 = -p0->dx;
+	dlx1 = p1->dy;
+	dly1 = -p1->dx;
+	// Calculate extrusions
+	p1->dmx = (dlx0 + dlx1) * 0.5f;
+	p1->dmy = (dly0 + dly1) * 0.5f;
+	dmr2 = p1->dmx*p1->dmx + p1->dmy*p1->dmy;
+	if (dmr2 > 0.000001f) {
+		float scale = 1.0f / dmr2;
+		if (scale > 600.0f) {
+			scale = 600.0f;
+		}
+		p1->dmx *= scale;
+		p1->dmy *= scale;
+	}
+
+	cross = p1->dx * p0->dy - p0->dx * p1->dy;
+	limit = nvg__maxf(1.01f, nvg__minf(p0->len, p1->len) * iw);
+	nvg__joinFlags(p1, cross > 0.0f, (dmr2 * limit*limit) < 1.0f,
+		(dmr2 * miterLimit*miterLimit) < 1.0f, lineJoin, nleft, nbevel);
+}
+
+// Calculates the joins of pts[i] for i in [1..npts), pts[i-1] is the previous point.
+static void nvg__joinPointsC(NVGpoint* pts, int npts, float iw, int lineJoin, float miterLimit,
+							 int* nleft, int* nbevel)
+{
+	int i;
+	for (i = 1; i < npts; i++)
+		nvg__joinPoint(&pts[i-1], &pts[i], iw, lineJoin, miterLimit, nleft, nbevel);
+}
+
+// Emits the left and right vertex of the miter joins of the given points.
+static NVGvertex* nvg__extrudePointsC(NVGvertex* dst, const NVGpoint* pts, int npts,
+									   float lw, float rw, float lu, float ru)
+{
+	int i;
+	for (i = 0; i < npts; i++) {
+		const NVGpoint* p = &pts[i];
+		nvg__vset(dst, p->x + (p->dmx * lw), p->y + (p->dmy * lw), lu,1); dst++;
+		nvg__vset(dst, p->x - (p->dmx * rw), p->y - (p->dmy * rw), ru,1); dst++;
+	}
+	return dst;
+}
+
+// Returns the number of points from pts on that only need a miter join, at most n.
+static int nvg__miterRun(const NVGpoint* pts, int n)
+{
+	int i = 0;
+	while (i < n && (pts[i].flags & (NVG_PT_BEVEL | NVG_PR_INNERBEVEL)) == 0)
+		i++;
+	return i;
+}
+
+#if !defined(NVG_SSE2) && !defined(NVG_NEON)
+static const NVGkernels nvg__kernelsC = {
+	nvg__transformPointsC,
+	nvg__segmentDirsC,
+	nvg__joinPointsC,
+	nvg__extrudePointsC,
+};
+#endif
+
+#ifdef NVG_SSE2
+
+static void nvg__transformPointsSSE2(float* dst, const float* src, int npts, const float* t)
+{
+	__m128 a = _mm_setr_ps(t[0], t[1], t[0], t[1]);
+	__m128 b = _mm_setr_ps(t[2], t[3], t[2], t[3]);
+	__m128 c = _mm_setr_ps(t[4], t[5], t[4], t[5]);
+	int i;
+	for (i = 0; i+2 <= npts; i += 2) {
+		__m128 p = _mm_loadu_ps(&src[i*2]);
+		__m128 x = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2,2,0,0));
+		__m128 y = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3,3,1,1));
+		_mm_storeu_ps(&dst[i*2], _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, a), _mm_mul_ps(y, b)), c));
+	}
+	nvg__transformPointsC(&dst[i*2], &src[i*2], npts-i, t);
+}
+
+// Loads the first (x, y, dx, dy) or second (len, dmx, dmy, flags) half of 4 points
+// transposed into one vector per member.
+#define NVG__LOAD4_SSE2(pts, member, r0, r1, r2, r3) do { \
+	r0 = _mm_loadu_ps(&(pts)[0].member); \
+	r1 = _mm_loadu_ps(&(pts)[1].member); \
+	r2 = _mm_loadu_ps(&(pts)[2].member); \
+	r3 = _mm_loadu_ps(&(pts)[3].member); \
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3); \
+} while (0)
+
+#define NVG__STORE4_SSE2(pts, member, r0, r1, r2, r3) do { \
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3); \
+	_mm_storeu_ps(&(pts)[0].member, r0); \
+	_mm_storeu_ps(&(pts)[1].member, r1); \
+	_mm_storeu_ps(&(pts)[2].member, r2); \
+	_mm_storeu_ps(&(pts)[3].member, r3); \
+} while (0)
+
+static __m128 nvg__selectSSE2(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static void nvg__segmentDirsSSE2(NVGpoint* pts, int npts, float* bounds)
+{
+	__m128 bminx = _mm_set1_ps(1e6f), bmaxx = _mm_set1_ps(-1e6f);
+	__m128 bminy = bminx, bmaxy = bmaxx;
+	__m128 eps = _mm_set1_ps(1e-6f), one = _mm_set1_ps(1.0f);
+	float tmp[4];
+	int i, k;
+
+	for (i = 0; i+4 <= npts; i += 4) {
+		__m128 x, y, dx, dy, nx, ny, t0, t1, len, mask, id;
+		NVG__LOAD4_SSE2(&pts[i], x, x, y, dx, dy);
+		NVG__LOAD4_SSE2(&pts[i+1], x, nx, ny, t0, t1);
+
+		dx = _mm_sub_ps(nx, x);
+		dy = _mm_sub_ps(ny, y);
+		len = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+		mask = _mm_cmpgt_ps(len, eps);
+		id = _mm_div_ps(one, len);
+		dx = nvg__selectSSE2(mask, _mm_mul_ps(dx, id), dx);
+		dy = nvg__selectSSE2(mask, _mm_mul_ps(dy, id), dy);
+
+		bminx = _mm_min_ps(bminx, x);
+		bminy = _mm_min_ps(bminy, y);
+		bmaxx = _mm_max_ps(bmaxx, x);
+		bmaxy = _mm_max_ps(bmaxy, y);
+
+		NVG__STORE4_SSE2(&pts[i], x, x, y, dx, dy);
+		_mm_storeu_ps(tmp, len);
+		for (k = 0; k < 4; k++)
+			pts[i+k].len = tmp[k];
+	}
+
+#define NVG__REDUCE_SSE2(v, op, dst) \
+	_mm_storeu_ps(tmp, v); \
+	for (k = 0; k < 4; k++) dst = op(dst, tmp[k]);
+	NVG__REDUCE_SSE2(bminx, nvg__minf, bounds[0]);
+	NVG__REDUCE_SSE2(bminy, nvg__minf, bounds[1]);
+	NVG__REDUCE_SSE2(bmaxx, nvg__maxf, bounds[2]);
+	NVG__REDUCE_SSE2(bmaxy, nvg__maxf, bounds[3]);
+#undef NVG__REDUCE_SSE2
+
+	nvg__segmentDirsC(&pts[i], npts-i, bounds);
+}
+
+static void nvg__joinPointsSSE2(NVGpoint* pts, int npts, float iw, int lineJoin, float miterLimit,
+								int* nleft, int* nbevel)
+{
+	__m128 half = _mm_set1_ps(0.5f), one = _mm_set1_ps(1.0f), eps = _mm_set1_ps(0.000001f);
+	__m128 maxScale = _mm_set1_ps(600.0f), minLimit = _mm_set1_ps(1.01f);
+	__m128 viw = _mm_set1_ps(iw), vml = _mm_set1_ps(miterLimit);
+	__m128 sign = _mm_set1_ps(-0.0f);
+	int i, k;
+
+	for (i = 1; i+4 <= npts; i += 4) {
+		__m128 x0, y0, dx0, dy0, len0, dmx0, dmy0, fl0;
+		__m128 x1, y1, dx1, dy1, len1, dmx, dmy, fl1;
+		__m128 dmr2, scale, mask, cross, limit;
+		int left, inner, miter;
+		NVG__LOAD4_SSE2(&pts[i-1], x, x0, y0, dx0, dy0);
+		NVG__LOAD4_SSE2(&pts[i-1], len, len0, dmx0, dmy0, fl0);
+		NVG__LOAD4_SSE2(&pts[i], x, x1, y1, dx1, dy1);
+		NVG__LOAD4_SSE2(&pts[i], len, len1, dmx, dmy, fl1);
+
+		// Calculate extrusions, dlx = dy, dly = -dx
+		dmx = _mm_mul_ps(_mm_add_ps(dy0, dy1), half);
+		dmy = _mm_mul_ps(_mm_add_ps(_mm_xor_ps(dx0, sign), _mm_xor_ps(dx1, sign)), half);
+		dmr2 = _mm_add_ps(_mm_mul_ps(dmx, dmx), _mm_mul_ps(dmy, dmy));
+		mask = _mm_cmpgt_ps(dmr2, eps);
+		scale = _mm_min_ps(_mm_div_ps(one, dmr2), maxScale);
+		dmx = nvg__selectSSE2(mask, _mm_mul_ps(dmx, scale), dmx);
+		dmy = nvg__selectSSE2(mask, _mm_mul_ps(dmy, scale), dmy);
+
+		cross = _mm_sub_ps(_mm_mul_ps(dx1, dy0), _mm_mul_ps(dx0, dy1));
+		limit = _mm_max_ps(minLimit, _mm_mul_ps(_mm_min_ps(len0, len1), viw));
+		left = _mm_movemask_ps(_mm_cmpgt_ps(cross, _mm_setzero_ps()));
+		inner = _mm_movemask_ps(_mm_cmplt_ps(_mm_mul_ps(_mm_mul_ps(dmr2, limit), limit), one));
+		miter = _mm_movemask_ps(_mm_cmplt_ps(_mm_mul_ps(_mm_mul_ps(dmr2, vml), vml), one));
+
+		NVG__STORE4_SSE2(&pts[i], len, len1, dmx, dmy, fl1);
+		for (k = 0; k < 4; k++)
+			nvg__joinFlags(&pts[i+k], (left >> k) & 1, (inner >> k) & 1, (miter >> k) & 1,
+				lineJoin, nleft, nbevel);
+
+	}
+
+	nvg__joinPointsC(&pts[i-1], npts-i+1, iw, lineJoin, miterLimit, nleft, nbevel);
+}
+
+static NVGvertex* nvg__extrudePointsSSE2(NVGvertex* dst, const NVGpoint* pts, int npts,
+										  float lw, float rw, float lu, float ru)
+{
+	__m128 w = _mm_setr_ps(lw, lw, -rw, -rw);
+	__m128 uv = _mm_setr_ps(lu, 1.0f, ru, 1.0f);
+	int i;
+	for (i = 0; i < npts; i++) {
+		__m128 a = _mm_loadu_ps(&pts[i].x); // x, y, dx, dy
+		__m128 b = _mm_loadu_ps(&pts[i].len); // len, dmx, dmy, flags
+		__m128 p = _mm_movelh_ps(a, a);
+		__m128 d = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2,1,2,1));
+		__m128 r = _mm_add_ps(p, _mm_mul_ps(d, w));
+		_mm_storeu_ps(&dst[0].x, _mm_movelh_ps(r, uv));
+		_mm_storeu_ps(&dst[1].x, _mm_shuffle_ps(r, uv, _MM_SHUFFLE(3,2,3,2)));
+		dst += 2;
+	}
+	return dst;
+}
+
+static const NVGkernels nvg__kernelsSSE2 = {
+	nvg__transformPointsSSE2,
+	nvg__segmentDirsSSE2,
+	nvg__joinPointsSSE2,
+	nvg__extrudePointsSSE2,
+};
+
+#endif // NVG_SSE2
+
+#ifdef NVG_AVX2
+
+#define NVG_AVX2_FUNC __attribute__((target("avx2")))
+
+NVG_AVX2_FUNC static void nvg__transformPointsAVX2(float* dst, const float* src, int npts, const float* t)
+{
+	__m256 a = _mm256_setr_ps(t[0], t[1], t[0], t[1], t[0], t[1], t[0], t[1]);
+	__m256 b = _mm256_setr_ps(t[2], t[3], t[2], t[3], t[2], t[3], t[2], t[3]);
+	__m256 c = _mm256_setr_ps(t[4], t[5], t[4], t[5], t[4], t[5], t[4], t[5]);
+	int i;
+	for (i = 0; i+4 <= npts; i += 4) {
+		__m256 p = _mm256_loadu_ps(&src[i*2]);
+		__m256 x = _mm256_permute_ps(p, _MM_SHUFFLE(2,2,0,0));
+		__m256 y = _mm256_permute_ps(p, _MM_SHUFFLE(3,3,1,1));
+		_mm256_storeu_ps(&dst[i*2], _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, a), _mm256_mul_ps(y, b)), c));
+	}
+	nvg__transformPointsC(&dst[i*2], &src[i*2], npts-i, t);
+}
+
+// Like NVG__LOAD4_SSE2 but for 8 points, the first 4 in the low lane
+// and the other 4 in the high lane.
+#define NVG__TRANSPOSE8_AVX2(r0, r1, r2, r3) do { \
+	__m256 t0_ = _mm256_unpacklo_ps(r0, r1), t1_ = _mm256_unpackhi_ps(r0, r1); \
+	__m256 t2_ = _mm256_unpacklo_ps(r2, r3), t3_ = _mm256_unpackhi_ps(r2, r3); \
+	r0 = _mm256_shuffle_ps(t0_, t2_, _MM_SHUFFLE(1,0,1,0)); \
+	r1 = _mm256_shuffle_ps(t0_, t2_, _MM_SHUFFLE(3,2,3,2)); \
+	r2 = _mm256_shuffle_ps(t1_, t3_, _MM_SHUFFLE(1,0,1,0)); \
+	r3 = _mm256_shuffle_ps(t1_, t3_, _MM_SHUFFLE(3,2,3,2)); \
+} while (0)
+
+#define NVG__LANES_AVX2(lo, hi) \
+	_mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1)
+
+#define NVG__LOAD8_AVX2(pts, member, r0, r1, r2, r3) do { \
+	r0 = NVG__LANES_AVX2(_mm_loadu_ps(&(pts)[0].member), _mm_loadu_ps(&(pts)[4].member)); \
+	r1 = NVG__LANES_AVX2(_mm_loadu_ps(&(pts)[1].member), _mm_loadu_ps(&(pts)[5].member)); \
+	r2 = NVG__LANES_AVX2(_mm_loadu_ps(&(pts)[2].member), _mm_loadu_ps(&(pts)[6].member)); \
+	r3 = NVG__LANES_AVX2(_mm_loadu_ps(&(pts)[3].member), _mm_loadu_ps(&(pts)[7].member)); \
+	NVG__TRANSPOSE8_AVX2(r0, r1, r2, r3); \
+} while (0)
+
+#define NVG__STORE8_AVX2(pts, member, r0, r1, r2, r3) do { \
+	NVG__TRANSPOSE8_AVX2(r0, r1, r2, r3); \
+	_mm_storeu_ps(&(pts)[0].member, _mm256_castps256_ps128(r0)); \
+	_mm_storeu_ps(&(pts)[1].member, _mm256_castps256_ps128(r1)); \
+	_mm_storeu_ps(&(pts)[2].member, _mm256_castps256_ps128(r2)); \
+	_mm_storeu_ps(&(pts)[3].member, _mm256_castps256_ps128(r3)); \
+	_mm_storeu_ps(&(pts)[4].member, _mm256_extractf128_ps(r0, 1)); \
+	_mm_storeu_ps(&(pts)[5].member, _mm256_extractf128_ps(r1, 1)); \
+	_mm_storeu_ps(&(pts)[6].member, _mm256_extractf128_ps(r2, 1)); \
+	_mm_storeu_ps(&(pts)[7].member, _mm256_extractf128_ps(r3, 1)); \
+} while (0)
+
+NVG_AVX2_FUNC static void nvg__segmentDirsAVX2(NVGpoint* pts, int npts, float* bounds)
+{
+	__m256 bminx = _mm256_set1_ps(1e6f), bmaxx = _mm256_set1_ps(-1e6f);
+	__m256 bminy = bminx, bmaxy = bmaxx;
+	__m256 eps = _mm256_set1_ps(1e-6f), one = _mm256_set1_ps(1.0f);
+	float tmp[8];
+	int i, k;
+
+	for (i = 0; i+8 <= npts; i += 8) {
+		__m256 x, y, dx, dy, nx, ny, t0, t1, len, mask, id;
+		NVG__LOAD8_AVX2(&pts[i], x, x, y, dx, dy);
+		NVG__LOAD8_AVX2(&pts[i+1], x, nx, ny, t0, t1);
+
+		dx = _mm256_sub_ps(nx, x);
+		dy = _mm256_sub_ps(ny, y);
+		len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+		mask = _mm256_cmp_ps(len, eps, _CMP_GT_OQ);
+		id = _mm256_div_ps(one, len);
+		dx = _mm256_blendv_ps(dx, _mm256_mul_ps(dx, id), mask);
+		dy = _mm256_blendv_ps(dy, _mm256_mul_ps(dy, id), mask);
+
+		bminx = _mm256_min_ps(bminx, x);
+		bminy = _mm256_min_ps(bminy, y);
+		bmaxx = _mm256_max_ps(bmaxx, x);
+		bmaxy = _mm256_max_ps(bmaxy, y);
+
+		NVG__STORE8_AVX2(&pts[i], x, x, y, dx, dy);
+		_mm256_storeu_ps(tmp, len);
+		for (k = 0; k < 8; k++)
+			pts[i+k].len = tmp[k];
+	}
+
+#define NVG__REDUCE_AVX2(v, op, dst) \
+	_mm256_storeu_ps(tmp, v); \
+	for (k = 0; k < 8; k++) dst = op(dst, tmp[k]);
+	NVG__REDUCE_AVX2(bminx, nvg__minf, bounds[0]);
+	NVG__REDUCE_AVX2(bminy, nvg__minf, bounds[1]);
+	NVG__REDUCE_AVX2(bmaxx, nvg__maxf, bounds[2]);
+	NVG__REDUCE_AVX2(bmaxy, nvg__maxf, bounds[3]);
+#undef NVG__REDUCE_AVX2
+
+	nvg__segmentDirsC(&pts[i], npts-i, bounds);
+}
+
+NVG_AVX2_FUNC static void nvg__joinPointsAVX2(NVGpoint* pts, int npts, float iw, int lineJoin,
+											  float miterLimit, int* nleft, int* nbevel)
+{
+	__m256 half = _mm256_set1_ps(0.5f), one = _mm256_set1_ps(1.0f), eps = _mm256_set1_ps(0.000001f);
+	__m256 maxScale = _mm256_set1_ps(600.0f), minLimit = _mm256_set1_ps(1.01f);
+	__m256 viw = _mm256_set1_ps(iw), vml = _mm256_set1_ps(miterLimit);
+	__m256 sign = _mm256_set1_ps(-0.0f);
+	int i, k;
+
+	for (i = 1; i+8 <= npts; i += 8) {
+		__m256 x0, y0, dx0, dy0, len0, dmx0, dmy0, fl0;
+		__m256 x1, y1, dx1, dy1, len1, dmx, dmy, fl1;
+		__m256 dmr2, scale, mask, cross, limit;
+		int left, inner, miter;
+		NVG__LOAD8_AVX2(&pts[i-1], x, x0, y0, dx0, dy0);
+		NVG__LOAD8_AVX2(&pts[i-1], len, len0, dmx0, dmy0, fl0);
+		NVG__LOAD8_AVX2(&pts[i], x, x1, y1, dx1, dy1);
+		NVG__LOAD8_AVX2(&pts[i], len, len1, dmx, dmy, fl1);
+
+		// Calculate extrusions, dlx = dy, dly = -dx
+		dmx = _mm256_mul_ps(_mm256_add_ps(dy0, dy1), half);
+		dmy = _mm256_mul_ps(_mm256_add_ps(_mm256_xor_ps(dx0, sign), _mm256_xor_ps(dx1, sign)), half);
+		dmr2 = _mm256_add_ps(_mm256_mul_ps(dmx, dmx), _mm256_mul_ps(dmy, dmy));
+		mask = _mm256_cmp_ps(dmr2, eps, _CMP_GT_OQ);
+		scale = _mm256_min_ps(_mm256_div_ps(one, dmr2), maxScale);
+		dmx = _mm256_blendv_ps(dmx, _mm256_mul_ps(dmx, scale), mask);
+		dmy = _mm256_blendv_ps(dmy, _mm256_mul_ps(dmy, scale), mask);
+
+		cross = _mm256_sub_ps(_mm256_mul_ps(dx1, dy0), _mm256_mul_ps(dx0, dy1));
+		limit = _mm256_max_ps(minLimit, _mm256_mul_ps(_mm256_min_ps(len0, len1), viw));
+		left = _mm256_movemask_ps(_mm256_cmp_ps(cross, _mm256_setzero_ps(), _CMP_GT_OQ));
+		inner = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_mul_ps(_mm256_mul_ps(dmr2, limit), limit), one, _CMP_LT_OQ));
+		miter = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_mul_ps(_mm256_mul_ps(dmr2, vml), vml), one, _CMP_LT_OQ));
+
+		NVG__STORE8_AVX2(&pts[i], len, len1, dmx, dmy, fl1);
+		for (k = 0; k < 8; k++)
+			nvg__joinFlags(&pts[i+k], (left >> k) & 1, (inner >> k) & 1, (miter >> k) & 1,
+				lineJoin, nleft, nbevel);
+
+	}
+
+	nvg__joinPointsC(&pts[i-1], npts-i+1, iw, lineJoin, miterLimit, nleft, nbevel);
+}
+
+NVG_AVX2_FUNC static NVGvertex* nvg__extrudePointsAVX2(NVGvertex* dst, const NVGpoint* pts, int npts,
+													   float lw, float rw, float lu, float ru)
+{
+	__m256 w = _mm256_setr_ps(lw, lw, -rw, -rw, lw, lw, -rw, -rw);
+	__m256 uv = _mm256_setr_ps(lu, 1.0f, ru, 1.0f, lu, 1.0f, ru, 1.0f);
+	int i;
+	for (i = 0; i+2 <= npts; i += 2) {
+		// Each point is 32 bytes: x, y, dx, dy | len, dmx, dmy, flags
+		__m256 a = _mm256_loadu_ps(&pts[i].x);
+		__m256 b = _mm256_loadu_ps(&pts[i+1].x);
+		__m256 xy = _mm256_permute2f128_ps(a, b, 0x20); // x, y, dx, dy of both points
+		__m256 dm = _mm256_permute2f128_ps(a, b, 0x31); // len, dmx, dmy, flags of both points
+		__m256 p = _mm256_shuffle_ps(xy, xy, _MM_SHUFFLE(1,0,1,0));
+		__m256 d = _mm256_shuffle_ps(dm, dm, _MM_SHUFFLE(2,1,2,1));
+		__m256 r = _mm256_add_ps(p, _mm256_mul_ps(d, w));
+		__m256 v0 = _mm256_shuffle_ps(r, uv, _MM_SHUFFLE(1,0,1,0)); // left vertices
+		__m256 v1 = _mm256_shuffle_ps(r, uv, _MM_SHUFFLE(3,2,3,2)); // right vertices
+		_mm256_storeu_ps(&dst[0].x, _mm256_permute2f128_ps(v0, v1, 0x20));
+		_mm256_storeu_ps(&dst[2].x, _mm256_permute2f128_ps(v0, v1, 0x31));
+		dst += 4;
+	}
+	return nvg__extrudePointsC(dst, &pts[i], npts-i, lw, rw, lu, ru);
+}
+
+static const NVGkernels nvg__kernelsAVX2 = {
+	nvg__transformPointsAVX2,
+	nvg__segmentDirsAVX2,
+	nvg__joinPointsAVX2,
+	nvg__extrudePointsAVX2,
+};
+
+#endif // NVG_AVX2
+
+#ifdef NVG_NEON
+
+static void nvg__transformPointsNEON(float* dst, const float* src, int npts, const float* t)
+{
+	float32x4_t t0 = vdupq_n_f32(t[0]), t1 = vdupq_n_f32(t[1]), t2 = vdupq_n_f32(t[2]);
+	float32x4_t t3 = vdupq_n_f32(t[3]), t4 = vdupq_n_f32(t[4]), t5 = vdupq_n_f32(t[5]);
+	int i;
+	for (i = 0; i+4 <= npts; i += 4) {
+		float32x4x2_t p = vld2q_f32(&src[i*2]);
+		float32x4x2_t r;
+		r.val[0] = vaddq_f32(vaddq_f32(vmulq_f32(p.val[0], t0), vmulq_f32(p.val[1], t2)), t4);
+		r.val[1] = vaddq_f32(vaddq_f32(vmulq_f32(p.val[0], t1), vmulq_f32(p.val[1], t3)), t5);
+		vst2q_f32(&dst[i*2], r);
+	}
+	nvg__transformPointsC(&dst[i*2], &src[i*2], npts-i, t);
+}
+
+static void nvg__transposeNEON(float32x4_t* r0, float32x4_t* r1, float32x4_t* r2, float32x4_t* r3)
+{
+	float32x4x2_t a = vtrnq_f32(*r0, *r1);
+	float32x4x2_t b = vtrnq_f32(*r2, *r3);
+	*r0 = vcombine_f32(vget_low_f32(a.val[0]), vget_low_f32(b.val[0]));
+	*r1 = vcombine_f32(vget_low_f32(a.val[1]), vget_low_f32(b.val[1]));
+	*r2 = vcombine_f32(vget_high_f32(a.val[0]), vget_high_f32(b.val[0]));
+	*r3 = vcombine_f32(vget_high_f32(a.val[1]), vget_high_f32(b.val[1]));
+}
+
+#define NVG__LOAD4_NEON(pts, member, r0, r1, r2, r3) do { \
+	r0 = vld1q_f32(&(pts)[0].member); \
+	r1 = vld1q_f32(&(pts)[1].member); \
+	r2 = vld1q_f32(&(pts)[2].member); \
+	r3 = vld1q_f32(&(pts)[3].member); \
+	nvg__transposeNEON(&r0, &r1, &r2, &r3); \
+} while (0)
+
+#define NVG__STORE4_NEON(pts, member, r0, r1, r2, r3) do { \
+	nvg__transposeNEON(&r0, &r1, &r2, &r3); \
+	vst1q_f32(&(pts)[0].member, r0); \
+	vst1q_f32(&(pts)[1].member, r1); \
+	vst1q_f32(&(pts)[2].member, r2); \
+	vst1q_f32(&(pts)[3].member, r3); \
+} while (0)
+
+static int nvg__maskNEON(uint32x4_t mask)
+{
+	static const uint32_t bits[4] = {1, 2, 4, 8};
+	return (int)vaddvq_u32(vandq_u32(mask, vld1q_u32(bits)));
+}
+
+static void nvg__segmentDirsNEON(NVGpoint* pts, int npts, float* bounds)
+{
+	float32x4_t bminx = vdupq_n_f32(1e6f), bmaxx = vdupq_n_f32(-1e6f);
+	float32x4_t bminy = bminx, bmaxy = bmaxx;
+	float32x4_t eps = vdupq_n_f32(1e-6f), one = vdupq_n_f32(1.0f);
+	float tmp[4];
+	int i, k;
+
+	for (i = 0; i+4 <= npts; i += 4) {
+		float32x4_t x, y, dx, dy, nx, ny, t0, t1, len, id;
+		uint32x4_t mask;
+		NVG__LOAD4_NEON(&pts[i], x, x, y, dx, dy);
+		NVG__LOAD4_NEON(&pts[i+1], x, nx, ny, t0, t1);
+
+		dx = vsubq_f32(nx, x);
+		dy = vsubq_f32(ny, y);
+		len = vsqrtq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)));
+		mask = vcgtq_f32(len, eps);
+		id = vdivq_f32(one, len);
+		dx = vbslq_f32(mask, vmulq_f32(dx, id), dx);
+		dy = vbslq_f32(mask, vmulq_f32(dy, id), dy);
+
+		// vminq/vmaxq differ from nvg__minf/maxf only for NaN
+		bminx = vminq_f32(bminx, x);
+		bminy = vminq_f32(bminy, y);
+		bmaxx = vmaxq_f32(bmaxx, x);
+		bmaxy = vmaxq_f32(bmaxy, y);
+
+		NVG__STORE4_NEON(&pts[i], x, x, y, dx, dy);
+		vst1q_f32(tmp, len);
+		for (k = 0; k < 4; k++)
+			pts[i+k].len = tmp[k];
+	}
+
+	bounds[0] = nvg__minf(bounds[0], vminvq_f32(bminx));
+	bounds[1] = nvg__minf(bounds[1], vminvq_f32(bminy));
+	bounds[2] = nvg__maxf(bounds[2], vmaxvq_f32(bmaxx));
+	bounds[3] = nvg__maxf(bounds[3], vmaxvq_f32(bmaxy));
+
+	nvg__segmentDirsC(&pts[i], npts-i, bounds);
+}
+
+static void nvg__joinPointsNEON(NVGpoint* pts, int npts, float iw, int lineJoin, float miterLimit,
+								int* nleft, int* nbevel)
+{
+	float32x4_t half = vdupq_n_f32(0.5f), one = vdupq_n_f32(1.0f), eps = vdupq_n_f32(0.000001f);
+	float32x4_t maxScale = vdupq_n_f32(600.0f), minLimit = vdupq_n_f32(1.01f);
+	float32x4_t viw = vdupq_n_f32(iw), vml = vdupq_n_f32(miterLimit);
+	int i, k;
+
+	for (i = 1; i+4 <= npts; i += 4) {
+		float32x4_t x0, y0, dx0, dy0, len0, dmx0, dmy0, fl0;
+		float32x4_t x1, y1, dx1, dy1, len1, dmx, dmy, fl1;
+		float32x4_t dmr2, scale, cross, limit;
+		uint32x4_t mask;
+		int left, inner, miter;
+		NVG__LOAD4_NEON(&pts[i-1], x, x0, y0, dx0, dy0);
+		NVG__LOAD4_NEON(&pts[i-1], len, len0, dmx0, dmy0, fl0);
+		NVG__LOAD4_NEON(&pts[i], x, x1, y1, dx1, dy1);
+		NVG__LOAD4_NEON(&pts[i], len, len1, dmx, dmy, fl1);
+
+		// Calculate extrusions, dlx = dy, dly = -dx
+		dmx = vmulq_f32(vaddq_f32(dy0, dy1), half);
+		dmy = vmulq_f32(vaddq_f32(vnegq_f32(dx0), vnegq_f32(dx1)), half);
+		dmr2 = vaddq_f32(vmulq_f32(dmx, dmx), vmulq_f32(dmy, dmy));
+		mask = vcgtq_f32(dmr2, eps);
+		scale = vminq_f32(vdivq_f32(one, dmr2), maxScale);
+		dmx = vbslq_f32(mask, vmulq_f32(dmx, scale), dmx);
+		dmy = vbslq_f32(mask, vmulq_f32(dmy, scale), dmy);
+
+		cross = vsubq_f32(vmulq_f32(dx1, dy0), vmulq_f32(dx0, dy1));
+		limit = vmaxq_f32(minLimit, vmulq_f32(vminq_f32(len0, len1), viw));
+		left = nvg__maskNEON(vcgtq_f32(cross, vdupq_n_f32(0.0f)));
+		inner = nvg__maskNEON(vcltq_f32(vmulq_f32(vmulq_f32(dmr2, limit), limit), one));
+		miter = nvg__maskNEON(vcltq_f32(vmulq_f32(vmulq_f32(dmr2, vml), vml), one));
+
+		NVG__STORE4_NEON(&pts[i], len, len1, dmx, dmy, fl1);
+		for (k = 0; k < 4; k++)
+			nvg__joinFlags(&pts[i+k], (left >> k) & 1, (inner >> k) & 1, (miter >> k) & 1,
+				lineJoin, nleft, nbevel);
+
+	}
+
+	nvg__joinPointsC(&pts[i-1], npts-i+1, iw, lineJoin, miterLimit, nleft, nbevel);
+}
+
+static NVGvertex* nvg__extrudePointsNEON(NVGvertex* dst, const NVGpoint* pts, int npts,
+										  float lw, float rw, float lu, float ru)
+{
+	static const float wl[2] = {0.0f, 1.0f};
+	float32x4_t w = vcombine_f32(vdup_n_f32(lw), vdup_n_f32(-rw));
+	float32x2_t luv = vset_lane_f32(lu, vld1_f32(wl), 0);
+	float32x2_t ruv = vset_lane_f32(ru, vld1_f32(wl), 0);
+	int i;
+	for (i = 0; i < npts; i++) {
+		float32x2_t p = vld1_f32(&pts[i].x);
+		float32x2_t d = vld1_f32(&pts[i].dmx);
+		float32x4_t r = vaddq_f32(vcombine_f32(p, p), vmulq_f32(vcombine_f32(d, d), w));
+		vst1q_f32(&dst[0].x, vcombine_f32(vget_low_f32(r), luv));
+		vst1q_f32(&dst[1].x, vcombine_f32(vget_high_f32(r), ruv));
+		dst += 2;
+	}
+	return dst;
+}
+
+static const NVGkernels nvg__kernelsNEON = {
+	nvg__transformPointsNEON,
+	nvg__segmentDirsNEON,
+	nvg__joinPointsNEON,
+	nvg__extrudePointsNEON,
+};
+
+#endif // NVG_NEON
+
+static const NVGkernels* nvg__selectKernels(void)
+{
+#ifdef NVG_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return &nvg__kernelsAVX2;
+#endif
+#if defined(NVG_SSE2)
+	return &nvg__kernelsSSE2;
+#elif defined(NVG_NEON)
+	return &nvg__kernelsNEON;
+#else
+	return &nvg__kernelsC;
+#endif
+}
+
+static void nvg__tesselateBezier(NVGcontext* ctx, NVGpathCache* cache,
 								 float x1, float y1, float x2, float y2,
 								 float x3, float y3, float x4, float y4,
 								 int level, int type)
@@ -1194,7 +1912,7 @@ static void nvg__tesselateBezier(NVGcontext* ctx,
 	d3 = nvg__absf(((x3 - x4) * dy - (y3 - y4) * dx));
 
 	if ((d2 + d3)*(d2 + d3) < ctx->tessTol * (dx*dx + dy*dy)) {
-		nvg__addPoint(ctx, x4, y4, type);
+		nvg__addPoint(ctx, cache, x4, y4, type);
 		return;
 	}
 
@@ -1208,13 +1926,13 @@ static void nvg__tesselateBezier(NVGcontext* ctx,
 	x1234 = (x123+x234)*0.5f;
 	y1234 = (y123+y234)*0.5f;
 
-	nvg__tesselateBezier(ctx, x1,y1, x12,y12, x123,y123, x1234,y1234, level+1, 0);
-	nvg__tesselateBezier(ctx, x1234,y1234, x234,y234, x34,y34, x4,y4, level+1, type);
+	nvg__tesselateBezier(ctx, cache, x1,y1, x12,y12, x123,y123, x1234,y1234, level+1, 0);
+	nvg__tesselateBezier(ctx, cache, x1234,y1234, x234,y234, x34,y34, x4,y4, level+1, type);
 }
 
-static void nvg__flattenPaths(NVGcontext* ctx)
+// Flattens the commands in [begin, end) into the given cache.
+static void nvg__flattenCommands(NVGcontext* ctx, NVGpathCache* cache, int begin, int end)
 {
-	NVGpathCache* cache = ctx->cache;
 //	NVGstate* state = nvg__getState(ctx);
 	NVGpoint* last;
 	NVGpoint* p0;
@@ -1227,41 +1945,41 @@ static void nvg__flattenPaths(NVGcontext* ctx)
 	float* p;
 	float area;
 
-	if (cache->npaths > 0)
-		return;
+	cache->npoints = 0;
+	cache->npaths = 0;
 
 	// Flatten
-	i = 0;
-	while (i < ctx->ncommands) {
+	i = begin;
+	while (i < end) {
 		int cmd = (int)ctx->commands[i];
 		switch (cmd) {
 		case NVG_MOVETO:
-			nvg__addPath(ctx);
+			nvg__addPath(cache);
 			p = &ctx->commands[i+1];
-			nvg__addPoint(ctx, p[0], p[1], NVG_PT_CORNER);
+			nvg__addPoint(ctx, cache, p[0], p[1], NVG_PT_CORNER);
 			i += 3;
 			break;
 		case NVG_LINETO:
 			p = &ctx->commands[i+1];
-			nvg__addPoint(ctx, p[0], p[1], NVG_PT_CORNER);
+			nvg__addPoint(ctx, cache, p[0], p[1], NVG_PT_CORNER);
 			i += 3;
 			break;
 		case NVG_BEZIERTO:
-			last = nvg__lastPoint(ctx);
+			last = nvg__lastPoint(cache);
 			if (last != NULL) {
 				cp1 = &ctx->commands[i+1];
 				cp2 = &ctx->commands[i+3];
 				p = &ctx->commands[i+5];
-				nvg__tesselateBezier(ctx, last->x,last->y, cp1[0],cp1[1], cp2[0],cp2[1], p[0],p[1], 0, NVG_PT_CORNER);
+				nvg__tesselateBezier(ctx, cache, last->x,last->y, cp1[0],cp1[1], cp2[0],cp2[1], p[0],p[1], 0, NVG_PT_CORNER);
 			}
 			i += 7;
 			break;
 		case NVG_CLOSE:
-			nvg__closePath(ctx);
+			nvg__closePath(cache);
 			i++;
 			break;
 		case NVG_WINDING:
-			nvg__pathWinding(ctx, (int)ctx->commands[i+1]);
+			nvg__pathWinding(cache, (int)ctx->commands[i+1]);
 			i += 2;
 			break;
 		default:
@@ -1295,18 +2013,10 @@ static void nvg__flattenPaths(NVGcontext* ctx)
 				nvg__polyReverse(pts, path->count);
 		}
 
-		for(i = 0; i < path->count; i++) {
-			// Calculate segment direction and length
-			p0->dx = p1->x - p0->x;
-			p0->dy = p1->y - p0->y;
-			p0->len = nvg__normalize(&p0->dx, &p0->dy);
-			// Update bounds
-			cache->bounds[0] = nvg__minf(cache->bounds[0], p0->x);
-			cache->bounds[1] = nvg__minf(cache->bounds[1], p0->y);
-			cache->bounds[2] = nvg__maxf(cache->bounds[2], p0->x);
-			cache->bounds[3] = nvg__maxf(cache->bounds[3], p0->y);
-			// Advance
-			p0 = p1++;
+		// Calculate segment direction and length
+		if (path->count > 0) {
+			nvg__segmentDir(p0, p1, cache->bounds);
+			ctx->kernels->segmentDirs(pts, path->count-1, cache->bounds);
 		}
 	}
 }
@@ -1536,10 +2246,9 @@ static NVGvertex* nvg__roundCapEnd(NVGvertex* dst, NVGpoint* p,
 }
 
 
-static void nvg__calculateJoins(NVGcontext* ctx, float w, int lineJoin, float miterLimit)
+static void nvg__calculateJoins(NVGcontext* ctx, NVGpathCache* cache, float w, int lineJoin, float miterLimit)
 {
-	NVGpathCache* cache = ctx->cache;
-	int i, j;
+	int i;
 	float iw = 0.0f;
 
 	if (w > 0.0f) iw = 1.0f / w;
@@ -1548,74 +2257,29 @@ static void nvg__calculateJoins(NVGcontext* ctx, float w, int lineJoin, float mi
 	for (i = 0; i < cache->npaths; i++) {
 		NVGpath* path = &cache->paths[i];
 		NVGpoint* pts = &cache->points[path->first];
-		NVGpoint* p0 = &pts[path->count-1];
-		NVGpoint* p1 = &pts[0];
 		int nleft = 0;
+		int nbevel = 0;
 
-		path->nbevel = 0;
-
-		for (j = 0; j < path->count; j++) {
-			float dlx0, dly0, dlx1, dly1, dmr2, cross, limit;
-			dlx0 = p0->dy;
-			dly0 = -p0->dx;
-			dlx1 = p1->dy;
-			dly1 = -p1->dx;
-			// Calculate extrusions
-			p1->dmx = (dlx0 + dlx1) * 0.5f;
-			p1->dmy = (dly0 + dly1) * 0.5f;
-			dmr2 = p1->dmx*p1->dmx + p1->dmy*p1->dmy;
-			if (dmr2 > 0.000001f) {
-				float scale = 1.0f / dmr2;
-				if (scale > 600.0f) {
-					scale = 600.0f;
-				}
-				p1->dmx *= scale;
-				p1->dmy *= scale;
-			}
-
-			// Clear flags, but keep the corner.
-			p1->flags = (p1->flags & NVG_PT_CORNER) ? NVG_PT_CORNER : 0;
-
-			// Keep track of left turns.
-			cross = p1->dx * p0->dy - p0->dx * p1->dy;
-			if (cross > 0.0f) {
-				nleft++;
-				p1->flags |= NVG_PT_LEFT;
-			}
-
-			// Calculate if we should use bevel or miter for inner join.
-			limit = nvg__maxf(1.01f, nvg__minf(p0->len, p1->len) * iw);
-			if ((dmr2 * limit*limit) < 1.0f)
-				p1->flags |= NVG_PR_INNERBEVEL;
-
-			// Check to see if the corner needs to be beveled.
-			if (p1->flags & NVG_PT_CORNER) {
-				if ((dmr2 * miterLimit*miterLimit) < 1.0f || lineJoin == NVG_BEVEL || lineJoin == NVG_ROUND) {
-					p1->flags |= NVG_PT_BEVEL;
-				}
-			}
-
-			if ((p1->flags & (NVG_PT_BEVEL | NVG_PR_INNERBEVEL)) != 0)
-				path->nbevel++;
-
-			p0 = p1++;
+		if (path->count > 0) {
+			nvg__joinPoint(&pts[path->count-1], &pts[0], iw, lineJoin, miterLimit, &nleft, &nbevel);
+			ctx->kernels->joinPoints(pts, path->count, iw, lineJoin, miterLimit, &nleft, &nbevel);
 		}
 
+		path->nbevel = nbevel;
 		path->convex = (nleft == path->count) ? 1 : 0;
 	}
 }
 
 
-static int nvg__expandStroke(NVGcontext* ctx, float w, int lineCap, int lineJoin, float miterLimit)
+static int nvg__expandStroke(NVGcontext* ctx, NVGpathCache* cache, float w, int lineCap, int lineJoin, float miterLimit)
 {
-	NVGpathCache* cache = ctx->cache;
 	NVGvertex* verts;
 	NVGvertex* dst;
 	int cverts, i, j;
 	float aa = ctx->fringeWidth;
 	int ncap = nvg__curveDivs(w, NVG_PI, ctx->tessTol);	// Calculate divisions per half circle.
 
-	nvg__calculateJoins(ctx, w, lineJoin, miterLimit);
+	nvg__calculateJoins(ctx, cache, w, lineJoin, miterLimit);
 
 	// Calculate max vertex usage.
 	cverts = 0;
@@ -1636,7 +2300,7 @@ static int nvg__expandStroke(NVGcontext* ctx, float w, int lineCap, int lineJoin
 		}
 	}
 
-	verts = nvg__allocTempVerts(ctx, cverts);
+	verts = nvg__allocTempVerts(cache, cverts);
 	if (verts == NULL) return 0;
 
 	for (i = 0; i < cache->npaths; i++) {
@@ -1682,18 +2346,22 @@ static int nvg__expandStroke(NVGcontext* ctx, float w, int lineCap, int lineJoin
 				dst = nvg__roundCapStart(dst, p0, dx, dy, w, ncap, aa);
 		}
 
-		for (j = s; j < e; ++j) {
+		for (j = s; j < e;) {
 			if ((p1->flags & (NVG_PT_BEVEL | NVG_PR_INNERBEVEL)) != 0) {
 				if (lineJoin == NVG_ROUND) {
 					dst = nvg__roundJoin(dst, p0, p1, w, w, 0, 1, ncap, aa);
 				} else {
 					dst = nvg__bevelJoin(dst, p0, p1, w, w, 0, 1, aa);
 				}
+				p0 = p1++;
+				++j;
 			} else {
-				nvg__vset(dst, p1->x + (p1->dmx * w), p1->y + (p1->dmy * w), 0,1); dst++;
-				nvg__vset(dst, p1->x - (p1->dmx * w), p1->y - (p1->dmy * w), 1,1); dst++;
+				int n = nvg__miterRun(p1, e - j);
+				dst = ctx->kernels->extrudePoints(dst, p1, n, w, w, 0, 1);
+				p1 += n;
+				p0 = p1 - 1;
+				j += n;
 			}
-			p0 = p1++;
 		}
 
 		if (loop) {
@@ -1721,16 +2389,17 @@ static int nvg__expandStroke(NVGcontext* ctx, float w, int lineCap, int lineJoin
 	return 1;
 }
 
-static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLimit)
+// Convex single paths get only half a fringe, allowConvex must be 0 if the cache
+// only holds a part of the paths.
+static int nvg__expandFill(NVGcontext* ctx, NVGpathCache* cache, float w, int lineJoin, float miterLimit, int allowConvex)
 {
-	NVGpathCache* cache = ctx->cache;
 	NVGvertex* verts;
 	NVGvertex* dst;
 	int cverts, convex, i, j;
 	float aa = ctx->fringeWidth;
 	int fringe = w > 0.0f;
 
-	nvg__calculateJoins(ctx, w, lineJoin, miterLimit);
+	nvg__calculateJoins(ctx, cache, w, lineJoin, miterLimit);
 
 	// Calculate max vertex usage.
 	cverts = 0;
@@ -1741,10 +2410,10 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 			cverts += (path->count + path->nbevel*5 + 1) * 2; // plus one for loop
 	}
 
-	verts = nvg__allocTempVerts(ctx, cverts);
+	verts = nvg__allocTempVerts(cache, cverts);
 	if (verts == NULL) return 0;
 
-	convex = cache->npaths == 1 && cache->paths[0].convex;
+	convex = allowConvex && cache->npaths == 1 && cache->paths[0].convex;
 
 	for (i = 0; i < cache->npaths; i++) {
 		NVGpath* path = &cache->paths[i];
@@ -1816,14 +2485,18 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 			p0 = &pts[path->count-1];
 			p1 = &pts[0];
 
-			for (j = 0; j < path->count; ++j) {
+			for (j = 0; j < path->count;) {
 				if ((p1->flags & (NVG_PT_BEVEL | NVG_PR_INNERBEVEL)) != 0) {
 					dst = nvg__bevelJoin(dst, p0, p1, lw, rw, lu, ru, ctx->fringeWidth);
+					p0 = p1++;
+					++j;
 				} else {
-					nvg__vset(dst, p1->x + (p1->dmx * lw), p1->y + (p1->dmy * lw), lu,1); dst++;
-					nvg__vset(dst, p1->x - (p1->dmx * rw), p1->y - (p1->dmy * rw), ru,1); dst++;
+					int n = nvg__miterRun(p1, path->count - j);
+					dst = ctx->kernels->extrudePoints(dst, p1, n, lw, rw, lu, ru);
+					p1 += n;
+					p0 = p1 - 1;
+					j += n;
 				}
-				p0 = p1++;
 			}
 
 			// Loop it
@@ -1841,11 +2514,168 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 	return 1;
 }
 
+static void nvg__runTessJob(void* data, int index)
+{
+	NVGcontext* ctx = (NVGcontext*)data;
+	NVGtessJob* job = &ctx->jobs[index];
+	NVGtessParams* p = &ctx->tessParams;
+
+	switch (p->op) {
+	case NVG_TESS_FLATTEN:
+		nvg__flattenCommands(ctx, job->cache, job->begin, job->end);
+		break;
+	case NVG_TESS_FILL:
+		nvg__expandFill(ctx, job->cache, p->w, p->lineJoin, p->miterLimit, 0);
+		break;
+	case NVG_TESS_STROKE:
+		nvg__expandStroke(ctx, job->cache, p->w, p->lineCap, p->lineJoin, p->miterLimit);
+		break;
+	}
+}
+
+// Runs the current operation on all jobs and gathers their paths in order
+// into the context cache. The gathered paths keep pointing into the vertices
+// and points of the job caches, which stay owned by the jobs.
+static void nvg__runTessJobs(NVGcontext* ctx)
+{
+	NVGpathCache* cache = ctx->cache;
+	int i, npaths = 0;
+
+	ctx->dispatch(ctx->dispatchPtr, ctx->njobs, nvg__runTessJob, ctx);
+
+	for (i = 0; i < ctx->njobs; i++)
+		npaths += ctx->jobs[i].cache->npaths;
+
+	if (npaths > cache->cpaths) {
+		NVGpath* paths = (NVGpath*)realloc(cache->paths, sizeof(NVGpath)*npaths);
+		if (paths == NULL) return;
+		cache->paths = paths;
+		cache->cpaths = npaths;
+	}
+
+	cache->npaths = 0;
+	cache->bounds[0] = cache->bounds[1] = 1e6f;
+	cache->bounds[2] = cache->bounds[3] = -1e6f;
+	for (i = 0; i < ctx->njobs; i++) {
+		NVGpathCache* jc = ctx->jobs[i].cache;
+		if (jc->npaths == 0) continue;
+		memcpy(&cache->paths[cache->npaths], jc->paths, sizeof(NVGpath)*jc->npaths);
+		cache->npaths += jc->npaths;
+		cache->bounds[0] = nvg__minf(cache->bounds[0], jc->bounds[0]);
+		cache->bounds[1] = nvg__minf(cache->bounds[1], jc->bounds[1]);
+		cache->bounds[2] = nvg__maxf(cache->bounds[2], jc->bounds[2]);
+		cache->bounds[3] = nvg__maxf(cache->bounds[3], jc->bounds[3]);
+	}
+}
+
+// Splits the commands at sub-path boundaries into jobs of roughly equal
+// command count. Returns the number of jobs, 0 if the path should be
+// tessellated serially.
+static int nvg__splitTessJobs(NVGcontext* ctx)
+{
+	int i, njobs, begin, target;
+
+	if (ctx->dispatch == NULL || ctx->maxJobs < 2 || ctx->ncommands < ctx->minJobCommands)
+		return 0;
+
+	if (ctx->maxJobs > ctx->cjobs) {
+		NVGtessJob* jobs = (NVGtessJob*)realloc(ctx->jobs, sizeof(NVGtessJob)*ctx->maxJobs);
+		if (jobs == NULL) return 0;
+		ctx->jobs = jobs;
+		for (i = ctx->cjobs; i < ctx->maxJobs; i++) {
+			ctx->jobs[i].cache = nvg__allocPathCache();
+			if (ctx->jobs[i].cache == NULL) {
+				ctx->cjobs = i;
+				return 0;
+			}
+		}
+		ctx->cjobs = ctx->maxJobs;
+	}
+
+	target = ctx->ncommands / ctx->maxJobs;
+	njobs = 0;
+	begin = 0;
+	i = 0;
+	while (i < ctx->ncommands) {
+		int cmd = (int)ctx->commands[i];
+		if (cmd == NVG_MOVETO && i - begin >= target && njobs+1 < ctx->maxJobs) {
+			ctx->jobs[njobs].begin = begin;
+			ctx->jobs[njobs].end = i;
+			njobs++;
+			begin = i;
+		}
+		switch (cmd) {
+		case NVG_MOVETO:
+		case NVG_LINETO:
+			i += 3;
+			break;
+		case NVG_BEZIERTO:
+			i += 7;
+			break;
+		case NVG_WINDING:
+			i += 2;
+			break;
+		default:
+			i++;
+		}
+	}
+	ctx->jobs[njobs].begin = begin;
+	ctx->jobs[njobs].end = ctx->ncommands;
+	njobs++;
+
+	return njobs > 1 ? njobs : 0;
+}
+
+static void nvg__flattenPaths(NVGcontext* ctx)
+{
+	if (ctx->cache->npaths > 0 || ctx->njobs > 0)
+		return;
+
+	ctx->njobs = nvg__splitTessJobs(ctx);
+	if (ctx->njobs == 0) {
+		nvg__flattenCommands(ctx, ctx->cache, 0, ctx->ncommands);
+		return;
+	}
+
+	ctx->tessParams.op = NVG_TESS_FLATTEN;
+	nvg__runTessJobs(ctx);
+}
+
+static void nvg__expandFillPaths(NVGcontext* ctx, float w, int lineJoin, float miterLimit)
+{
+	if (ctx->njobs == 0) {
+		nvg__expandFill(ctx, ctx->cache, w, lineJoin, miterLimit, 1);
+		return;
+	}
+
+	ctx->tessParams.op = NVG_TESS_FILL;
+	ctx->tessParams.w = w;
+	ctx->tessParams.lineJoin = lineJoin;
+	ctx->tessParams.miterLimit = miterLimit;
+	nvg__runTessJobs(ctx);
+}
+
+static void nvg__expandStrokePaths(NVGcontext* ctx, float w, int lineCap, int lineJoin, float miterLimit)
+{
+	if (ctx->njobs == 0) {
+		nvg__expandStroke(ctx, ctx->cache, w, lineCap, lineJoin, miterLimit);
+		return;
+	}
+
+	ctx->tessParams.op = NVG_TESS_STROKE;
+	ctx->tessParams.w = w;
+	ctx->tessParams.lineCap = lineCap;
+	ctx->tessParams.lineJoin = lineJoin;
+	ctx->tessParams.miterLimit = miterLimit;
+	nvg__runTessJobs(ctx);
+}
+
 
 // Draw
 void nvgBeginPath(NVGcontext* ctx)
 {
 	ctx->ncommands = 0;
+	ctx->shapeValid = 0;
 	nvg__clearPathCache(ctx);
 }
 
@@ -1861,6 +2691,45 @@ void nvgLineTo(NVGcontext* ctx, float x, float y)
 	nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
 }
 
+void nvgPolyline(NVGcontext* ctx, const float* points, int npoints)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float xy[128];
+	float* dst;
+	int i, j, n;
+
+	if (npoints <= 0) return;
+
+	if (ctx->ncommands+npoints*3 > ctx->ccommands) {
+		float* commands;
+		int ccommands = ctx->ncommands+npoints*3 + ctx->ccommands/2;
+		commands = (float*)realloc(ctx->commands, sizeof(float)*ccommands);
+		if (commands == NULL) return;
+		ctx->commands = commands;
+		ctx->ccommands = ccommands;
+	}
+
+	ctx->commandx = points[npoints*2-2];
+	ctx->commandy = points[npoints*2-1];
+	ctx->shapeValid = 0;
+
+	// Transform the points in batches and write them as commands.
+	dst = &ctx->commands[ctx->ncommands];
+	for (i = 0; i < npoints; i += n) {
+		n = nvg__mini(npoints - i, (int)NVG_COUNTOF(xy) / 2);
+		ctx->kernels->transformPoints(xy, &points[i*2], n, state->xform);
+		for (j = 0; j < n; j++) {
+			dst[0] = (float)NVG_LINETO;
+			dst[1] = xy[j*2];
+			dst[2] = xy[j*2+1];
+			dst += 3;
+		}
+	}
+
+	ctx->commands[ctx->ncommands] = (float)NVG_MOVETO;
+	ctx->ncommands += npoints*3;
+}
+
 void nvgBezierTo(NVGcontext* ctx, float c1x, float c1y, float c2x, float c2y, float x, float y)
 {
 	float vals[] = { NVG_BEZIERTO, c1x, c1y, c2x, c2y, x, y };
@@ -2011,8 +2880,33 @@ void nvgArc(NVGcontext* ctx, float cx, float cy, float r, float a0, float a1, in
 	nvg__appendCommands(ctx, vals, nvals);
 }
 
+static int nvg__isSimilarity(const float* t)
+{
+	return nvg__absf(t[0] - t[3]) < 1e-5f && nvg__absf(t[1] + t[2]) < 1e-5f;
+}
+
+// Remembers a single rounded rect as the whole current path, so that nvgFill can hand
+// it to renderFillShape instead of tessellating. Only rotation and uniform scale keep
+// the local distance field proportional to the screen one, so other transforms skip it.
+static void nvg__recordShape(NVGcontext* ctx, int ncommands, float cx, float cy, float hw, float hh, float r)
+{
+	NVGstate* state = nvg__getState(ctx);
+
+	if (ncommands != 0 || ctx->params.renderFillShape == NULL) return;
+	if (!nvg__isSimilarity(state->xform)) return;
+
+	memcpy(ctx->shape.xform, state->xform, sizeof(float)*6);
+	ctx->shape.center[0] = cx;
+	ctx->shape.center[1] = cy;
+	ctx->shape.extent[0] = nvg__absf(hw);
+	ctx->shape.extent[1] = nvg__absf(hh);
+	ctx->shape.radius = r;
+	ctx->shapeValid = 1;
+}
+
 void nvgRect(NVGcontext* ctx, float x, float y, float w, float h)
 {
+	int ncommands = ctx->ncommands;
 	float vals[] = {
 		NVG_MOVETO, x,y,
 		NVG_LINETO, x,y+h,
@@ -2021,6 +2915,7 @@ void nvgRect(NVGcontext* ctx, float x, float y, float w, float h)
 		NVG_CLOSE
 	};
 	nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
+	nvg__recordShape(ctx, ncommands, x+w*0.5f, y+h*0.5f, w*0.5f, h*0.5f, 0.0f);
 }
 
 void nvgRoundedRect(NVGcontext* ctx, float x, float y, float w, float h, float r)
@@ -2030,6 +2925,7 @@ void nvgRoundedRect(NVGcontext* ctx, float x, float y, float w, float h, float r
 		return;
 	}
 	else {
+		int ncommands = ctx->ncommands;
 		float rx = nvg__minf(r, nvg__absf(w)*0.5f) * nvg__signf(w), ry = nvg__minf(r, nvg__absf(h)*0.5f) * nvg__signf(h);
 		float vals[] = {
 			NVG_MOVETO, x, y+ry,
@@ -2044,11 +2940,15 @@ void nvgRoundedRect(NVGcontext* ctx, float x, float y, float w, float h, float r
 			NVG_CLOSE
 		};
 		nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
+		// The corners are only circular when the radius isn't clamped on one axis.
+		if (nvg__absf(rx) == nvg__absf(ry))
+			nvg__recordShape(ctx, ncommands, x+w*0.5f, y+h*0.5f, w*0.5f, h*0.5f, nvg__absf(rx));
 	}
 }
 
 void nvgEllipse(NVGcontext* ctx, float cx, float cy, float rx, float ry)
 {
+	int ncommands = ctx->ncommands;
 	float vals[] = {
 		NVG_MOVETO, cx-rx, cy,
 		NVG_BEZIERTO, cx-rx, cy+ry*NVG_KAPPA90, cx-rx*NVG_KAPPA90, cy+ry, cx, cy+ry,
@@ -2058,6 +2958,8 @@ void nvgEllipse(NVGcontext* ctx, float cx, float cy, float rx, float ry)
 		NVG_CLOSE
 	};
 	nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
+	if (nvg__absf(rx) == nvg__absf(ry))
+		nvg__recordShape(ctx, ncommands, cx, cy, rx, ry, nvg__absf(rx));
 }
 
 void nvgCircle(NVGcontext* ctx, float cx, float cy, float r)
@@ -2094,16 +2996,23 @@ void nvgFill(NVGcontext* ctx)
 	NVGpaint fillPaint = state->fill;
 	int i;
 
-	nvg__flattenPaths(ctx);
-	if (ctx->params.edgeAntiAlias)
-		nvg__expandFill(ctx, ctx->fringeWidth, NVG_MITER, 2.4f);
-	else
-		nvg__expandFill(ctx, 0.0f, NVG_MITER, 2.4f);
-
 	// Apply global alpha
 	fillPaint.innerColor.a *= state->alpha;
 	fillPaint.outerColor.a *= state->alpha;
 
+	if (ctx->shapeValid && ctx->params.renderFillShape(ctx->params.userPtr, &fillPaint, &state->scissor,
+			ctx->fringeWidth, &ctx->shape)) {
+		ctx->fillTriCount += 2;
+		ctx->drawCallCount++;
+		return;
+	}
+
+	nvg__flattenPaths(ctx);
+	if (ctx->params.edgeAntiAlias)
+		nvg__expandFillPaths(ctx, ctx->fringeWidth, NVG_MITER, 2.4f);
+	else
+		nvg__expandFillPaths(ctx, 0.0f, NVG_MITER, 2.4f);
+
 	ctx->params.renderFill(ctx->params.userPtr, &fillPaint, &state->scissor, ctx->fringeWidth,
 						   ctx->cache->bounds, ctx->cache->paths, ctx->cache->npaths);
 
@@ -2141,9 +3050,9 @@ void nvgStroke(NVGcontext* ctx)
 	nvg__flattenPaths(ctx);
 
 	if (ctx->params.edgeAntiAlias)
-		nvg__expandStroke(ctx, strokeWidth*0.5f + ctx->fringeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
+		nvg__expandStrokePaths(ctx, strokeWidth*0.5f + ctx->fringeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
 	else
-		nvg__expandStroke(ctx, strokeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
+		nvg__expandStrokePaths(ctx, strokeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
 
 	ctx->params.renderStroke(ctx->params.userPtr, &strokePaint, &state->scissor, ctx->fringeWidth,
 							 strokeWidth, ctx->cache->paths, ctx->cache->npaths);
@@ -2156,6 +3065,15 @@ void nvgStroke(NVGcontext* ctx)
 	}
 }
 
+void nvgParallelTessellation(NVGcontext* ctx, NVGdispatchFunc dispatch, void* uptr, int njobs, int minCommands)
+{
+	ctx->dispatch = dispatch;
+	ctx->dispatchPtr = uptr;
+	ctx->maxJobs = nvg__maxi(njobs, 0);
+	ctx->minJobCommands = minCommands;
+	nvg__clearPathCache(ctx);
+}
+
 // Add fonts
 int nvgCreateFont(NVGcontext* ctx, const char* name, const char* path)
 {
@@ -2262,7 +3180,7 @@ static int nvg__allocTextAtlas(NVGcontext* ctx)
 			iw *= 2;
 		if (iw > NVG_MAX_FONTIMAGE_SIZE || ih > NVG_MAX_FONTIMAGE_SIZE)
 			iw = ih = NVG_MAX_FONTIMAGE_SIZE;
-		ctx->fontImages[ctx->fontImageIdx+1] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, 0, NULL);
+		ctx->fontImages[ctx->fontImageIdx+1] = ctx->params.renderCreateTexture(ctx->params.userPtr, nvg__fontTextureType(ctx), iw, ih, 0, NULL);
 	}
 	++ctx->fontImageIdx;
 	fonsResetAtlas(ctx->fs, iw, ih);
@@ -2277,6 +3195,14 @@ static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts)
 	// Render triangles.
 	paint.image = ctx->fontImages[ctx->fontImageIdx];
 
+	// Distance field glyphs are blurred when rendering, the feather is the blur
+	// in units of the stored distance.
+	if (ctx->params.sdfText) {
+		float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+		float size = nvg__maxf(state->fontSize*scale, 1.0f);
+		paint.feather = state->fontBlur*scale * FONS_SDF_SIZE / (size * FONS_SDF_SPREAD);
+	}
+
 	// Apply global alpha
 	paint.innerColor.a *= state->alpha;
 	paint.outerColor.a *= state->alpha;
@@ -2310,7 +3236,7 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
 	fonsSetFont(ctx->fs, state->fontId);
 
 	cverts = nvg__maxi(2, (int)(end - string)) * 6; // conservative estimate.
-	verts = nvg__allocTempVerts(ctx, cverts);
+	verts = nvg__allocTempVerts(ctx->cache, cverts);
 	if (verts == NULL) return x;
 
 	fonsTextIterInit(ctx->fs, &iter, x*scale, y*scale, string, end);
@@ -105,6 +105,7 @@ enum NVGimageFlags {
 	NVG_IMAGE_REPEATY			= 1<<2,		// Repeat image in Y direction.
 	NVG_IMAGE_FLIPY				= 1<<3,		// Flips (inverses) image in Y direction when rendered.
 	NVG_IMAGE_PREMULTIPLIED		= 1<<4,		// Image data has premultiplied alpha.
+	NVG_IMAGE_NEAREST			= 1<<5,		// Image interpolation is Nearest instead Linear
 };
 
 // Begin drawing a new frame
@@ -411,6 +412,10 @@ void nvgMoveTo(NVGcontext* ctx, float x, float y);
 // Adds line segment from the last point in the path to the specified point.
 void nvgLineTo(NVGcontext* ctx, float x, float y);
 
+// Starts new sub-path at the first of the given points and adds line segments to the others.
+// The points are given as npoints x,y pairs. Faster than separate nvgMoveTo and nvgLineTo calls.
+void nvgPolyline(NVGcontext* ctx, const float* points, int npoints);
+
 // Adds cubic bezier segment from last point in the path via two control points to the specified point.
 void nvgBezierTo(NVGcontext* ctx, float c1x, float c1y, float c2x, float c2y, float x, float y);
 
@@ -449,6 +454,16 @@ void nvgFill(NVGcontext* ctx);
 // Fills the current path with current stroke style.
 void nvgStroke(NVGcontext* ctx);
 
+// Function that calls func(data, i) for each i in [0..count) and returns once all calls
+// have finished. The calls can be made in parallel on multiple threads.
+typedef void (*NVGdispatchFunc)(void* uptr, int count, void (*func)(void* data, int index), void* data);
+
+// Enables parallel tessellation of large paths. Paths made of at least minCommands commands
+// are split at their sub-paths into up to njobs jobs which are flattened and expanded in
+// parallel using the given dispatch function. The results are merged in sub-path order, so
+// the output is the same as without it. Pass NULL as dispatch function to disable it.
+void nvgParallelTessellation(NVGcontext* ctx, NVGdispatchFunc dispatch, void* uptr, int njobs, int minCommands);
+
 
 //
 // Text
@@ -553,6 +568,7 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 enum NVGtexture {
 	NVG_TEXTURE_ALPHA = 0x01,
 	NVG_TEXTURE_RGBA = 0x02,
+	NVG_TEXTURE_SDF = 0x04, // single channel signed distance field, see sdfText
 };
 
 struct NVGscissor {
@@ -580,6 +596,16 @@ struct NVGpath {
 };
 typedef struct NVGpath NVGpath;
 
+// A filled rounded rectangle, given in local coordinates together with the transform
+// it was drawn with. Plain rectangles have zero radius, circles have radius == extent.
+struct NVGshape {
+	float xform[6];
+	float center[2];
+	float extent[2];
+	float radius;
+};
+typedef struct NVGshape NVGshape;
+
 struct NVGparams {
 	void* userPtr;
 	int edgeAntiAlias;
@@ -595,6 +621,12 @@ struct NVGparams {
 	void (*renderStroke)(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths);
 	void (*renderTriangles)(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts);
 	void (*renderDelete)(void* uptr);
+	// Optional. Draws a path that consists of a single NVGshape without tessellating it.
+	// Returns 0 if the back-end can't, in which case the path is filled as usual.
+	int (*renderFillShape)(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, const NVGshape* shape);
+	// Whether the font atlas stores one signed distance field per glyph (FONS_SDF)
+	// that is scaled and blurred by the renderer, instead of one bitmap per size and blur.
+	int sdfText;
 };
 typedef struct NVGparams NVGparams;
 
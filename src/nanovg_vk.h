@@ -1,16 +1,16 @@
 #ifndef VVG_INCLUDE_NANOVG_VK_H
-#define VVG_INCLUDE_NANOVG_VK_H
-
+#define VVG_INCLUDE_NANOVG_VK_H
+
 #pragma once
 
 #include <vulkan/vulkan.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-typedef struct NVGcontext NVGcontext;
-
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct NVGcontext NVGcontext;
+
 /// Description for a vulkan nanovg context.
 typedef struct VVGContextDescription {
 	VkInstance instance; // the instance to create the context for
@@ -21,40 +21,51 @@ typedef struct VVGContextDescription {
 	VkSwapchainKHR swapchain; // the swapchain on which should be rendered.
 	VkExtent2D swapchainSize; // the size of the given swapchain
 	VkFormat swapchainFormat; // the format of the given swapchain
-} VVGContextDescription;
-
+} VVGContextDescription;
+
 /// This function can be called to create a new nanovg vulkan context that will render
 /// on the given swapchain.
-NVGcontext* vvgCreate(const VVGContextDescription* description);
-
+NVGcontext* vvgCreate(const VVGContextDescription* description);
+
+/// Must be called after the swapchain of the given context was recreated, e.g. because
+/// the window was resized (see vvgOutOfDate) or another present mode should be used.
+/// Waits for the frames in flight, afterwards the old swapchain can be destroyed.
+/// Keeps the textures and pipelines of the context.
+void vvgResize(NVGcontext* ctx, VkSwapchainKHR swapchain, VkExtent2D size, VkFormat format);
+
+/// Returns whether the swapchain of the given context was reported out of date or
+/// suboptimal since it was created or last resized. Frames are discarded while it is
+/// out of date.
+int vvgOutOfDate(const NVGcontext* ctx);
+
 /// Destroys the given nanovg context.
-void vvgDestroy(const NVGcontext* ctx);
-
-#ifdef __cplusplus
-} //extern C
-#endif
-
+void vvgDestroy(const NVGcontext* ctx);
+
+#ifdef __cplusplus
+} //extern C
+#endif
+
 #endif // header guard
-
-// Copyright © 2016 nyorain
-//
-// Permission is hereby granted, free of charge, to any person
-// obtaining a copy of this software and associated documentation
-// files (the “Software”), to deal in the Software without
-// restriction, including without limitation the rights to use,
-// copy, modify, merge, publish, distribute, sublicense, and/or sell
-// copies of the Software, and to permit persons to whom the
-// Software is furnished to do so, subject to the following
-// conditions:
-//
-// The above copyright notice and this permission notice shall be
-// included in all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
-// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
-// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
-// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
-// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
-// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
-// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
-// OTHER DEALINGS IN THE SOFTWARE.
+
+// Copyright © 2016 nyorain
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the “Software”), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
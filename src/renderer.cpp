@@ -7,9 +7,11 @@
 #include <vpp/pipeline.hpp>
 #include <vpp/swapchain.hpp>
 #include <vpp/framebuffer.hpp>
+#include <vpp/image.hpp>
 #include <vpp/surface.hpp>
 #include <vpp/queue.hpp>
 #include <vpp/submit.hpp>
+#include <vpp/sync.hpp>
 #include <vpp/vk.hpp>
 #include <vpp/util/file.hpp>
 
@@ -18,12 +20,30 @@
 // stl
 #include <stdexcept>
 #include <cstring>
+#include <cmath>
+#include <cstdint>
 #include <algorithm>
 #include <iterator>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <atomic>
+#include <limits>
+#include <array>
+#include <cstddef>
+#include <fstream>
+#include <chrono>
 
 // shader header
 #include "shader/fill.frag.h"
 #include "shader/fill.vert.h"
+#include "shader/fill_compact.vert.h"
+#include "shader/shape.vert.h"
+#include "shader/shape.frag.h"
 
 namespace vvg {
 
@@ -48,6 +68,8 @@ struct UniformData {
 	Mat4 paintMat;
 };
 
+constexpr auto infinity = std::numeric_limits<float>::infinity();
+
 struct Path {
 	std::size_t fillOffset = 0;
 	std::size_t fillCount = 0;
@@ -55,24 +77,456 @@ struct Path {
 	std::size_t strokeCount = 0;
 };
 
+// The paths of all draws of a frame are stored in one array that keeps its memory
+// between frames, so recording draws does not allocate.
 struct DrawData {
-	vpp::DescriptorSet descriptorSet;
-	UniformData uniformData;
+	std::size_t uniformOffset = 0; // offset of the UniformData in the uniform stream
 	unsigned int texture = 0;
+	std::uint8_t variant = 0; // the paint variant of the pipeline
 
-	std::vector<Path> paths;
+	std::size_t pathOffset = 0; // the first path in the path array of the frame
+	std::size_t pathCount = 0;
 	std::size_t triangleOffset = 0;
 	std::size_t triangleCount = 0;
+
+	// for concave fills: the paths are rendered into the stencil buffer and then
+	// covered with the bounds quad (4 vertices)
+	bool stencilFill = false;
+	std::size_t coverOffset = 0;
+
+	// instanced shapes (see ShapeInstance), the index of the first one in the vertex stream
+	std::size_t shapeOffset = 0;
+	std::size_t shapeCount = 0;
+
+	// the bounds of the draw in view coordinates (min x, min y, max x, max y).
+	// Only computed when using dirty regions, unbounded otherwise
+	std::array<float, 4> bounds = {-infinity, -infinity, infinity, infinity};
+};
+
+// Returns the paths of the given draw in the given path array.
+inline nytl::Span<const Path> drawPaths(const std::vector<Path>& paths, const DrawData& data)
+{
+	return {paths.data() + data.pathOffset, data.pathCount};
+}
+
+// The pipeline a DrawCall uses.
+enum class PipelineType : std::uint8_t {
+	list, // plain triangle list
+	fillStencil, // writes the fill winding into the stencil buffer, no color output
+	fillFringe, // antialiased fringes where the stencil buffer is 0
+	fillCover, // covers the filled area where the stencil is not 0 and resets it
+	shape, // instanced shapes, one quad per instance without index buffer
+};
+
+// There is one pipeline per PipelineType and paint variant. The fragment shaders are
+// specialized for the paint type (bits 0-1), the texture type (bits 2-3) and whether
+// the draw is scissored (variantScissor) so common paints skip the branches and the
+// scissor math, see fill.frag. The pipelines are created when first used.
+constexpr std::uint8_t variantScissor = 1u << 4;
+
+// The paint and texture types of fill.frag (TYPE_* and TEXTYPE_* macros).
+constexpr auto typeColor = 1u;
+constexpr auto typeGradient = 2u;
+constexpr auto typeTexture = 3u;
+
+constexpr auto texTypeRGBA = 1u;
+constexpr auto texTypeA = 2u;
+constexpr auto texTypeSDF = 3u;
+constexpr auto texTypePremultiplied = 4u;
+
+// Returns the paint bits of the variant for the given paint and texture type.
+// There are only 2 bits for the texture type, premultiplied textures use the variant
+// that reads it from the paint.
+constexpr std::uint8_t paintBits(unsigned int type, unsigned int texType)
+{
+	return type | ((texType <= 3u ? texType : 0u) << 2);
+}
+
+// One indexed triangle list draw, the result of the batching pass.
+// Adjacent DrawDatas with the same texture and paint are merged into one DrawCall.
+// For shape draws the first index and index count are the first instance and
+// instance count instead.
+struct DrawCall {
+	PipelineType pipeline;
+	unsigned int texture; // the texture id the descriptor set was created for
+	vk::DescriptorSet descriptorSet;
+	std::uint32_t uniformOffset;
+	std::uint32_t firstIndex;
+	std::uint32_t indexCount;
+	vk::Pipeline vkPipeline; // the pipeline for the type and paint variant
+};
+
+// The per instance data of the shape pipeline: a filled rounded rect (see NVGshape).
+// Stored in the vertex stream and read with instance rate, see shape.vert.
+struct ShapeInstance {
+	Vec4 rect; // center in screen space, half extent in local space
+	Vec4 xform; // linear part of the local to screen transform
+	Vec2 params; // corner radius in local space, fringe in pixels
+	std::uint32_t paint; // index of the paint if reading them from the storage buffer
+	std::uint32_t padding;
+};
+
+static_assert(sizeof(ShapeInstance) == 48, "ShapeInstance must be tightly packed");
+
+// The content hash and bounds (in render target pixels) of one draw of the last rendered
+// frame, used to find the regions that changed, see Renderer::trackDamage.
+struct DrawRecord {
+	std::uint64_t hash;
+	vk::Rect2D bounds;
+};
+
+// The vertex layout used with RendererSettings::compactVertices.
+struct CompactVertex {
+	std::int16_t x, y; // fixed point position relative to the VertexOrigin of the draw
+	std::uint16_t u, v; // unorm
+};
+
+// What the compact vertices of one draw are relative to. Stored in the free members
+// of the paint matrix, see fill.frag.
+// The texture coordinates of draws of atlas textures are mapped into their region of the
+// page when writing the vertices.
+struct VertexOrigin {
+	Vec2 origin {};
+	float step = 1.f; // the size of one fixed point unit in pixels
+	Vec2 uvOffset {0.f, 0.f};
+	Vec2 uvScale {1.f, 1.f};
+};
+
+// One row of images in an atlas page.
+struct AtlasShelf {
+	unsigned int y;
+	unsigned int height;
+	unsigned int width; // the used width
+};
+
+// A texture small textures are packed into with a shelf packer, see RendererSettings::atlasSize.
+struct AtlasPage {
+	unsigned int texture; // the id of the page texture
+	unsigned int entries {}; // the number of textures stored in it
+	std::vector<AtlasShelf> shelves;
+};
+
+// The padding around every atlas texture, filled with the border texels.
+constexpr auto atlasPadding = 1u;
+
+// The finest step of compact vertex positions.
+constexpr auto compactStep = 1.f / 16.f;
+
+// The minimal number of draw calls recorded by one thread when recording in parallel.
+constexpr auto minChunkCalls = 64u;
+
+// The minimal number of path commands for which nanovg tessellates in parallel.
+constexpr auto minTessCommands = 4096;
+
+// Returns the size of one texel of the given texture format.
+inline std::size_t formatSize(vk::Format format)
+{
+	return (format == vk::Format::r8Unorm || format == vk::Format::r8Snorm) ? 1u : 4u;
+}
+
+// Continues the given 64 bit fnv-1a hash with the given bytes.
+constexpr std::uint64_t hashBasis = 14695981039346656037ull;
+inline std::uint64_t hashBytes(std::uint64_t hash, const void* data, std::size_t size)
+{
+	auto bytes = static_cast<const std::uint8_t*>(data);
+	for(auto i = 0u; i < size; ++i)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	return hash;
+}
+
+// Hashes and compares UniformData bytewise, used to deduplicate paints in a frame.
+struct PaintHash {
+	std::size_t operator()(const UniformData& data) const
+	{
+		// fnv-1a
+		auto bytes = reinterpret_cast<const std::uint8_t*>(&data);
+		std::size_t hash = 2166136261u;
+		for(auto i = 0u; i < sizeof(data); ++i)
+			hash = (hash ^ bytes[i]) * 16777619u;
+		return hash;
+	}
+};
+
+struct PaintEqual {
+	bool operator()(const UniformData& a, const UniformData& b) const
+		{ return std::memcmp(&a, &b, sizeof(a)) == 0; }
+};
+
+// Persistently mapped host coherent buffer used as linear allocator for the data
+// of one frame. Grows geometrically if it is too small and never shrinks, the allocated
+// data is copied over to the new buffer so previously returned offsets stay valid.
+// Must only be written if the device is not reading it, i.e. reset() is called
+// when the frame slot it belongs to is free again.
+class StreamBuffer {
+public:
+	StreamBuffer() = default;
+	StreamBuffer(const vpp::Device& dev, vk::BufferUsageFlags usage, std::size_t size);
+
+	/// Allocates the given size with the given alignment and returns its offset.
+	std::size_t allocate(std::size_t size, std::size_t alignment = 4);
+
+	/// Allocates space for the given data, copies it and returns its offset.
+	std::size_t write(const void* data, std::size_t size, std::size_t alignment = 4);
+
+	/// Discards all allocations.
+	void reset() { offset_ = 0; }
+
+	std::uint8_t* data(std::size_t offset = 0) const { return data_ + offset; }
+	std::size_t offset() const { return offset_; }
+	std::size_t size() const { return size_; }
+	const vpp::Buffer& buffer() const { return buffer_; }
+
+	/// Will be increased every time the underlaying buffer is recreated.
+	unsigned int generation() const { return generation_; }
+
+protected:
+	void grow(std::size_t needed);
+
+protected:
+	vk::BufferUsageFlags usage_ {};
+	vpp::Buffer buffer_;
+	vpp::MemoryMapView map_;
+	std::uint8_t* data_ {};
+	std::size_t offset_ {};
+	std::size_t size_ {};
+	unsigned int generation_ {};
+};
+
+// A pending texture upload from the staging buffer of a frame.
+// Recorded before the render pass of the frame.
+struct Upload {
+	unsigned int texture; // the texture id
+	bool initial; // whether this is the first upload, i.e. the contents are undefined
+	bool copy; // whether data is copied or only the layout is initialized
+	vk::BufferImageCopy region; // relative to the staging buffer
+};
+
+// The retained draws of one part of a Scene.
+// Immutable once captured, recapturing a part creates a new ScenePart so frames in
+// flight can keep using the old one. The buffers are device local and filled from the
+// staging buffer of the frame that captured them.
+struct ScenePart {
+	vpp::Buffer vertices;
+	vpp::Buffer indices;
+	vpp::Buffer uniforms;
+
+	vpp::DescriptorPool descriptorPool;
+	std::unordered_map<unsigned int, vpp::DescriptorSet> descriptorSets;
+	std::vector<DrawCall> drawCalls;
+
+	// secondary command buffer replaying the draw calls, recorded when captured
+	vpp::CommandBuffer commandBuffer;
+};
+
+// Pending copy of captured scene data from the staging buffer of a frame.
+struct SceneUpload {
+	std::shared_ptr<ScenePart> part;
+	vk::BufferCopy vertices;
+	vk::BufferCopy indices;
+	vk::BufferCopy uniforms;
+};
+
+// Minimal pool of worker threads, used to record command buffers in parallel.
+// The calling thread of run takes part in the work.
+class WorkerPool {
+public:
+	/// Starts the given number of additional threads.
+	WorkerPool(unsigned int threads);
+	~WorkerPool();
+
+	/// Calls the given function for every index in [0, count) and blocks until all
+	/// calls have finished. Rethrows the first exception thrown by a call.
+	void run(unsigned int count, const std::function<void(unsigned int)>& func);
+
+protected:
+	void work();
+	void call(std::unique_lock<std::mutex>& lock);
+
+protected:
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable workCv_;
+	std::condition_variable doneCv_;
+
+	const std::function<void(unsigned int)>* func_ {};
+	unsigned int count_ {};
+	unsigned int next_ {}; // next index to call
+	unsigned int done_ {}; // number of finished calls
+	std::exception_ptr exception_;
+	bool exit_ = false;
+};
+
+// The draws recorded by a shared context for one frame.
+// Stored like the DrawDatas of the Renderer, but the offsets are relative to the own
+// vertices and the uniformOffset is the index of the paint.
+// Only one of the vertex vectors is used, depending on the vertex format of the Renderer.
+// The nodes are recycled by the Renderer once appended, so the vectors keep their memory.
+struct DrawListData {
+	std::vector<NVGvertex> vertices;
+	std::vector<CompactVertex> compactVertices;
+	std::vector<ShapeInstance> shapes;
+	std::vector<UniformData> paints;
+	std::vector<DrawData> draws;
+	std::vector<Path> paths;
+
+	int order {}; // the order of the context
+	std::uint64_t sequence {}; // the submission number
+	DrawListData* next {}; // next node in the submission stack
+};
+
+// State of the Renderer that is accessed by the shared contexts on other threads.
+struct RendererShared {
+	// guards the textures and the frame slots since textures can be created, updated
+	// and deleted by shared contexts
+	std::recursive_mutex mutex;
+
+	std::atomic<DrawListData*> submissions {}; // lock-free stack of submitted draw lists
+	std::atomic<std::uint64_t> sequence {};
+
+	// appended draw lists, reused by the next started ones
+	std::mutex recycledMutex;
+	std::vector<std::unique_ptr<DrawListData>> recycled;
+
+	// guards the pipeline variants which are also created by the prewarm thread
+	std::mutex pipelineMutex;
+	std::thread prewarmThread;
+	std::atomic<bool> stopPrewarm {};
+};
+
+// The backend of a shared context. Records the draws of one frame of the context on its
+// own thread and submits them to the Renderer, which renders them in its next flush.
+class DrawList {
+public:
+	DrawList(Renderer& renderer, int order) : renderer_(renderer), order_(order) {}
+
+	void start(unsigned int width, unsigned int height);
+	void cancel();
+	void submit();
+
+	void fill(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+		const float* bounds, nytl::Span<const NVGpath> paths);
+	void stroke(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+		float strokeWidth, nytl::Span<const NVGpath> paths);
+	void triangles(const NVGpaint& paint, const NVGscissor& scissor,
+		nytl::Span<const NVGvertex> verts);
+	bool fillShape(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+		const NVGshape& shape);
+
+	Renderer& renderer() const { return renderer_; }
+	std::unique_lock<std::recursive_mutex> lock() const
+		{ return std::unique_lock<std::recursive_mutex>(renderer_.shared_->mutex); }
+
+protected:
+	DrawData& parsePaint(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+		float strokeWidth, VertexOrigin& origin, bool vertexTexCoords = false);
+	std::size_t writeVertices(nytl::Span<const NVGvertex> verts, const VertexOrigin& origin);
+
+protected:
+	Renderer& renderer_;
+	int order_;
+	unsigned int width_ {};
+	unsigned int height_ {};
+	std::unique_ptr<DrawListData> data_;
+};
+
+// A vulkan query pool, destroyed with the object.
+class QueryPool {
+public:
+	QueryPool() = default;
+	QueryPool(vk::Device dev, const vk::QueryPoolCreateInfo& info)
+		: device_(dev), pool_(vk::createQueryPool(dev, info)) {}
+	~QueryPool() { if(*this) vk::destroyQueryPool(device_, pool_); }
+
+	QueryPool(QueryPool&& other) noexcept { swap(other); }
+	QueryPool& operator=(QueryPool&& other) noexcept { swap(other); return *this; }
+
+	void swap(QueryPool& other) noexcept
+	{
+		std::swap(device_, other.device_);
+		std::swap(pool_, other.pool_);
+	}
+
+	operator vk::QueryPool() const { return pool_; }
+	explicit operator bool() const { return pool_ != vk::QueryPool {}; }
+
+protected:
+	vk::Device device_ {};
+	vk::QueryPool pool_ {};
 };
 
-// The RenderBuilder implementation used to render on a swapchain.
-struct RenderImpl : public vpp::RendererBuilder {
-	std::vector<vk::ClearValue> clearValues(unsigned int id) override;
-	void build(unsigned int id, const vpp::RenderPassInstance& ini) override;
-	void frame(unsigned int id) override;
+// Collects the FrameStats, see RendererSettings::profiling.
+struct Profiler {
+	std::ofstream trace; // if a trace file was given
+	double timestampPeriod {}; // milliseconds per timestamp tick, 0 if not supported
+	std::uint64_t timestampMask {}; // the valid bits of the timestamps
+};
+
+// The resources of one frame that may be in flight.
+// Every frame slot has its own buffers and descriptors so the next frame can be built
+// while the device is still rendering the previous ones.
+struct Frame {
+	StreamBuffer uniforms;
+	StreamBuffer vertices;
+	StreamBuffer indices; // generated by the batching pass
+	StreamBuffer staging; // texture data for uploads, reset when the frame has finished
+
+	std::vector<Upload> uploads;
+
+	// initial uploads done on the transfer queue, if there is one.
+	// The frame waits for the upload semaphore before sampling the textures.
+	std::vector<Upload> transferUploads;
+	vpp::CommandBuffer uploadCommandBuffer;
+	vpp::Semaphore uploadSemaphore;
+
+	// captured scene data to copy and the scene parts drawn this frame.
+	// Kept alive until the frame has finished.
+	std::vector<SceneUpload> sceneUploads;
+	std::vector<std::shared_ptr<ScenePart>> uploadedScenes;
+	std::vector<std::shared_ptr<ScenePart>> scenes;
+	vpp::CommandBuffer secondaryCommandBuffer; // the draws of the frame if scenes are drawn
+
+	// secondary command buffers for parallel recording, each one has its own pool since
+	// they are recorded at the same time
+	std::vector<vpp::CommandPool> recordPools;
+	std::vector<vpp::CommandBuffer> recordBuffers;
+
+	vpp::DescriptorPool descriptorPool;
+	unsigned int descriptorPoolSize {}; // maximal number of sets in the pool
+	unsigned int descriptorCount {}; // number of sets allocated from the pool
+
+	// descriptor set for every used texture id (0 for no texture), the uniform data is
+	// bound as dynamic buffer so they stay valid until the uniform buffer is recreated
+	std::unordered_map<unsigned int, vpp::DescriptorSet> descriptorSets;
+	unsigned int descriptorGeneration {}; // the uniform stream generation they were made for
+
+	// offsets of the paints already written into the uniform stream this frame
+	std::unordered_map<UniformData, std::size_t, PaintHash, PaintEqual> paints;
+
+	vpp::CommandBuffer commandBuffer;
+	vpp::Fence fence; // signaled when the device has finished the frame
+	bool pending = false; // whether the fence was submitted and was not waited for yet
+	std::uint64_t number {}; // the number of the last frame submitted from this slot
+
+	// only used when rendering on a swapchain
+	vpp::Semaphore acquireSemaphore;
+	vpp::Semaphore renderSemaphore;
+
+	// only used when rendering offscreen: the pixels of the frame, copied after rendering
+	StreamBuffer readback;
+
+	// only used when profiling: the stats of the frame until it has finished and the
+	// timestamps written before and after its commands
+	FrameStats stats;
+	QueryPool timestamps;
+	std::chrono::steady_clock::time_point started;
+};
 
-	Renderer* renderer;
-	vpp::SwapchainRenderer* swapchainRenderer;
+// The framebuffer for one swapchain image or offscreen frame slot.
+struct RenderTarget {
+	vpp::ImageView imageView; // the swapchain image view
+	vpp::Framebuffer framebuffer;
+	vk::Image image {}; // offscreen: the (resolved) image copied into the readback buffer
+	std::uint64_t frame {}; // the number of the frame last rendered into it, for dirtyRegions
 };
 
 } // namespace vvg
@@ -105,45 +559,215 @@ template<> struct VulkanType<vvg::UniformData> {
 
 
 namespace vvg {
+namespace {
+
+// Sets the dynamic viewport and scissor state to the whole given target size.
+// The scissor is restricted to the given area, unless its extent is empty.
+void setViewport(vk::CommandBuffer cmdBuffer, const vk::Extent2D& size,
+	const vk::Rect2D& area = {})
+{
+	vk::Viewport viewport;
+	viewport.width = size.width;
+	viewport.height = size.height;
+	viewport.minDepth = 0.f;
+	viewport.maxDepth = 1.f;
+	vk::cmdSetViewport(cmdBuffer, 0, 1, viewport);
+
+	//Update dynamic scissor state
+	vk::Rect2D scissor;
+	scissor.extent = {size.width, size.height};
+	scissor.offset = {0, 0};
+	if(area.extent.width && area.extent.height)
+		scissor = area;
+	vk::cmdSetScissor(cmdBuffer, 0, 1, scissor);
+}
+
+// Returns the smallest rect containing both given ones, empty rects are ignored.
+vk::Rect2D unite(const vk::Rect2D& a, const vk::Rect2D& b)
+{
+	if(!a.extent.width || !a.extent.height) return b;
+	if(!b.extent.width || !b.extent.height) return a;
+
+	auto x0 = std::min(a.offset.x, b.offset.x);
+	auto y0 = std::min(a.offset.y, b.offset.y);
+	auto x1 = std::max(a.offset.x + int(a.extent.width), b.offset.x + int(b.extent.width));
+	auto y1 = std::max(a.offset.y + int(a.extent.height), b.offset.y + int(b.extent.height));
+	return {{x0, y0}, {unsigned(x1 - x0), unsigned(y1 - y0)}};
+}
+
+// Begins a secondary command buffer that is executed inside the given render pass.
+// The framebuffer can be null if it is not known.
+void beginSecondary(vk::CommandBuffer cmdBuffer, vk::RenderPass rp, vk::Framebuffer fb,
+	vk::CommandBufferUsageFlags flags)
+{
+	vk::CommandBufferInheritanceInfo inheritance;
+	inheritance.renderPass = rp;
+	inheritance.subpass = 0;
+	inheritance.framebuffer = fb;
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = flags | vk::CommandBufferUsageBits::renderPassContinue;
+	beginInfo.pInheritanceInfo = &inheritance;
+	vk::beginCommandBuffer(cmdBuffer, beginInfo);
+}
+
+// Returns the given sample count as vulkan flag bit. Throws if the device does not
+// support it for color and stencil attachments.
+vk::SampleCountBits sampleCount(const vpp::Device& dev, unsigned int samples)
+{
+	auto& limits = dev.properties().limits;
+	auto supported = limits.framebufferColorSampleCounts & limits.framebufferStencilSampleCounts;
+	auto bits = vk::SampleCountBits(samples);
+	if(!samples || (samples & (samples - 1)) || !(supported & bits))
+		throw std::invalid_argument("vvg::Renderer: unsupported sample count");
+
+	return bits;
+}
+
+// The image flags that select the sampler of a texture.
+constexpr auto samplerFlags = NVG_IMAGE_GENERATE_MIPMAPS | NVG_IMAGE_REPEATX |
+	NVG_IMAGE_REPEATY | NVG_IMAGE_NEAREST;
+
+// Returns the sampler parameters for textures with the given image flags.
+// Repeat and the mip level only have an effect for the pattern coordinates computed in
+// fill.frag, the vertex texture coordinates of fills stay constant.
+vk::SamplerCreateInfo samplerInfo(int imageFlags)
+{
+	auto filter = (imageFlags & NVG_IMAGE_NEAREST) ? vk::Filter::nearest : vk::Filter::linear;
+	auto address = [&](int repeat) {
+		return (imageFlags & repeat) ? vk::SamplerAddressMode::repeat :
+			vk::SamplerAddressMode::clampToEdge;
+	};
+
+	vk::SamplerCreateInfo info;
+	info.magFilter = filter;
+	info.minFilter = filter;
+	info.mipmapMode = (imageFlags & NVG_IMAGE_NEAREST) ? vk::SamplerMipmapMode::nearest :
+		vk::SamplerMipmapMode::linear;
+	info.addressModeU = address(NVG_IMAGE_REPEATX);
+	info.addressModeV = address(NVG_IMAGE_REPEATY);
+	info.addressModeW = vk::SamplerAddressMode::clampToEdge;
+	info.mipLodBias = 0;
+	info.anisotropyEnable = true;
+	info.maxAnisotropy = 1;
+	info.compareEnable = false;
+	info.compareOp = {};
+	info.minLod = 0;
+	info.maxLod = (imageFlags & NVG_IMAGE_GENERATE_MIPMAPS) ? VK_LOD_CLAMP_NONE : 0.f;
+	info.borderColor = vk::BorderColor::floatTransparentBlack;
+	info.unnormalizedCoordinates = false;
+	return info;
+}
+
+// Returns the contents of the given file or an empty vector if it cannot be read.
+std::vector<std::uint8_t> readFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if(!file)
+		return {};
+
+	return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+// Saves the pipeline cache of the renderer to its pipelineCachePath, if any.
+// Only warns on failure since this is called on destruction and the cache is optional,
+// e.g. the working directory of the application might be read-only.
+void savePipelineCache(const Renderer& renderer)
+{
+	auto& path = renderer.settings().pipelineCachePath;
+	if(path.empty())
+		return;
+
+	try {
+		auto data = renderer.pipelineCacheData();
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		if(!file)
+			dlg_warn("vvg::Renderer: failed to write the pipeline cache to {}", path);
+	} catch(const std::exception& err) {
+		dlg_warn("vvg::Renderer: failed to save the pipeline cache: {}", err.what());
+	}
+}
+
+} // anonymous util namespace
 
 //Renderer
-Renderer::Renderer(const vpp::Swapchain& swapchain, const vpp::Queue* presentQueue)
-	: vpp::Resource(swapchain.device()), swapchain_(&swapchain), presentQueue_(presentQueue)
+Renderer::Renderer(const vpp::Swapchain& swapchain, const vpp::Queue* presentQueue,
+	const RendererSettings& settings) : vpp::Resource(swapchain.device()),
+		swapchain_(&swapchain), presentQueue_(presentQueue), settings_(settings)
 {
 	initRenderPass(swapchain.device(), swapchain.format());
 	init();
+	initRenderTargets();
+}
 
-	auto impl = std::make_unique<RenderImpl>();
-	impl->renderer = this;
-	impl->swapchainRenderer = &renderer_;
-
-	auto attachmentInfo = vpp::ViewableImage::defaultDepth2D();
-	attachmentInfo.imgInfo.format = vk::Format::s8Uint;
-	attachmentInfo.viewInfo.format = vk::Format::s8Uint;
-	attachmentInfo.viewInfo.subresourceRange.aspectMask = vk::ImageAspectBits::stencil;
-
-	vpp::SwapchainRenderer::CreateInfo info {renderPass_, 0, {{attachmentInfo}}};
-	renderer_ = {swapchain, info, std::move(impl)};
+Renderer::Renderer(const vpp::Framebuffer& framebuffer, vk::RenderPass rp,
+	const RendererSettings& settings) : vpp::Resource(framebuffer.device()),
+		framebuffer_(&framebuffer), renderPassHandle_(rp), settings_(settings)
+{
+	init();
 }
 
-Renderer::Renderer(const vpp::Framebuffer& framebuffer, vk::RenderPass rp)
-	: vpp::Resource(framebuffer.device()), framebuffer_(&framebuffer), renderPassHandle_(rp)
+Renderer::Renderer(const vpp::Device& dev, vk::Format format, const vk::Extent2D& size,
+	const RendererSettings& settings) : vpp::Resource(dev), offscreen_(true),
+		offscreenFormat_(format), offscreenSize_(size), settings_(settings)
 {
+	// the rendered images are only copied, never presented
+	initRenderPass(dev, format, vk::ImageLayout::transferSrcOptimal);
 	init();
-	commandBuffer_ = framebuffer.device().commandProvider().get(renderQueue_->family());
+	initRenderTargets();
 }
 
 
 Renderer::~Renderer()
 {
-
+	// the prewarm thread uses the pipeline cache and the shader modules
+	stopPrewarm();
+
+	// the device might still use the resources of the frames in flight
+	wait();
+
+	// save the pipelines created meanwhile to the file we tried to load the cache from
+	if(pipelineCache_.vkHandle())
+		savePipelineCache(*this);
+
+	// draw lists that were submitted but never flushed
+	if(shared_) {
+		auto node = shared_->submissions.exchange(nullptr);
+		while(node) {
+			auto next = node->next;
+			delete node;
+			node = next;
+		}
+	}
 }
 
 void Renderer::init()
 {
+	shared_ = std::make_unique<RendererShared>();
+
+	// throws for unsupported sample counts, also when rendering into a framebuffer
+	sampleCount(device(), settings_.samples);
+
+	// multisampling antialiases the edges, the fringes would only blur them
+	edgeAA_ = settings_.edgeAntiAlias && settings_.samples <= 1;
+
 	// queues
 	renderQueue_ = device().queue(vk::QueueBits::graphics);
 
+	// a queue of another family that supports transfer operations, used to upload
+	// the textures asynchronously
+	transferQueue_ = nullptr;
+	if(settings_.asyncUploads) {
+		for(auto& queue : device().queues()) {
+			if(queue->family() != renderQueue_->family() &&
+					(queue->properties().queueFlags & vk::QueueBits::transfer)) {
+				transferQueue_ = queue.get();
+				break;
+			}
+		}
+	}
+
 	if(swapchain_ && !presentQueue_) {
 		auto surface = swapchain_->vkSurface();
 		auto supported = vpp::supportedQueueFamilies(vkInstance(), surface, vkPhysicalDevice());
@@ -155,35 +779,33 @@ void Renderer::init()
 			throw std::runtime_error("vvg::Renderer::init: cannot find present queue");
 	}
 
-	// sampler
-	vk::SamplerCreateInfo samplerInfo;
-	samplerInfo.magFilter = vk::Filter::linear;
-	samplerInfo.minFilter = vk::Filter::linear;
-	samplerInfo.mipmapMode = vk::SamplerMipmapMode::linear;
-	samplerInfo.addressModeU = vk::SamplerAddressMode::clampToEdge;
-	samplerInfo.addressModeV = vk::SamplerAddressMode::clampToEdge;
-	samplerInfo.addressModeW = vk::SamplerAddressMode::clampToEdge;
-	samplerInfo.mipLodBias = 0;
-	samplerInfo.anisotropyEnable = true;
-	samplerInfo.maxAnisotropy = 1;
-	samplerInfo.compareEnable = false;
-	samplerInfo.compareOp = {};
-	samplerInfo.minLod = 0;
-	samplerInfo.maxLod = 0;
-	samplerInfo.borderColor = vk::BorderColor::floatTransparentBlack;
-	samplerInfo.unnormalizedCoordinates = false;
-	sampler_ = {device(), samplerInfo};
+	// uniform buffer offsets must respect the device limits
+	auto& limits = device().properties().limits;
+	uniformAlignment_ = std::max<std::size_t>(limits.minUniformBufferOffsetAlignment, 16u);
+
+	// sampler of the textures without image flags, the others are created when needed
+	sampler_ = {device(), samplerInfo(0)};
+	samplers_.clear();
 
 	// descLayout
 	auto descriptorBindings  = {
-		vpp::descriptorBinding(vk::DescriptorType::uniformBuffer,
+		vpp::descriptorBinding(vk::DescriptorType::uniformBufferDynamic,
 			vk::ShaderStageBits::vertex | vk::ShaderStageBits::fragment),
 		vpp::descriptorBinding(vk::DescriptorType::combinedImageSampler,
-			vk::ShaderStageBits::fragment, -1, 1, &sampler_.vkHandle())
+			vk::ShaderStageBits::fragment),
+		vpp::descriptorBinding(vk::DescriptorType::storageBuffer,
+			vk::ShaderStageBits::vertex | vk::ShaderStageBits::fragment)
 	};
 
+	// the push constant holds the paint index if the paints are read from the
+	// storage buffer
+	vk::PushConstantRange pushConstantRange;
+	pushConstantRange.stageFlags = vk::ShaderStageBits::vertex | vk::ShaderStageBits::fragment;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(std::uint32_t);
+
 	descriptorLayout_ = {device(), descriptorBindings};
-	pipelineLayout_ = {device(), {descriptorLayout_}, {}};
+	pipelineLayout_ = {device(), {descriptorLayout_}, {pushConstantRange}};
 
 	//create the graphics pipeline
 	// vpp::GraphicsPipelineBuilder builder(device(), vkRenderPass());
@@ -225,21 +847,232 @@ void Renderer::init()
 	// listPipeline_ = builder.build();
 
 
-	std::uint32_t antiAliasing = edgeAA_;
-	vk::SpecializationMapEntry entry {0, 0, 4};
+	// compact vertices need the shader that decodes the fixed point positions
+	vertexShader_ = vpp::ShaderModule(device(), settings_.compactVertices ?
+		nytl::Span<const std::uint32_t>(fill_compact_vert_data) :
+		nytl::Span<const std::uint32_t>(fill_vert_data));
+	fragmentShader_ = vpp::ShaderModule(device(), fill_frag_data);
+	shapeVertexShader_ = vpp::ShaderModule(device(), shape_vert_data);
+	shapeFragmentShader_ = vpp::ShaderModule(device(), shape_frag_data);
+
+	// the pipelines of the paint variants are created when they are first used
+	// unless they are prewarmed here
+	initPipelineCache();
+	if(settings_.prewarmPipelines && settings_.asyncPipelines) {
+		shared_->prewarmThread = std::thread([this]{
+			try {
+				prewarmPipelines();
+			} catch(const std::exception& err) {
+				// the draws create the missing pipelines themselves
+				dlg_warn("vvg::Renderer: prewarming the pipelines failed: {}", err.what());
+			}
+		});
+	} else if(settings_.prewarmPipelines) {
+		prewarmPipelines();
+	}
 
-	vk::SpecializationInfo specInfo;
-	specInfo.mapEntryCount = 1;
-	specInfo.pMapEntries = &entry;
-	specInfo.dataSize = 4;
-	specInfo.pData = &antiAliasing;
+	// create a dummy image used for unbound image descriptors
+	// TODO: find out if this is actually needed or a bug in the layers
+	dummyTexture_ = {device(), (unsigned int) -1, {2, 2}, vk::Format::r8g8b8a8Unorm};
+	vpp::changeLayout(dummyTexture_.viewableImage().image(), vk::ImageLayout::undefined,
+		vk::ImageLayout::shaderReadOnlyOptimal, {vk::ImageAspectBits::color, 0, 1, 0, 1})->finish();
+
+	// frame slots
+	if(!settings_.framesInFlight)
+		throw std::invalid_argument("vvg::Renderer::init: framesInFlight must not be 0");
+
+	constexpr auto initialUniformSize = 64 * 1024;
+	constexpr auto initialVertexSize = 256 * 1024;
+	constexpr auto initialIndexSize = 256 * 1024;
+	constexpr auto initialStagingSize = 1024 * 1024;
+
+	// profiling, the timestamps are only supported by some queue families
+	if(settings_.profiling) {
+		profiler_ = std::make_unique<Profiler>();
+		auto bits = renderQueue_->properties().timestampValidBits;
+		if(bits) {
+			profiler_->timestampPeriod = limits.timestampPeriod / 1000000.0;
+			profiler_->timestampMask = (bits >= 64) ? ~std::uint64_t(0) :
+				(std::uint64_t(1) << bits) - 1;
+		}
+
+		if(!settings_.profilingTrace.empty()) {
+			// no lines are written to a trace that could not be opened
+			profiler_->trace.open(settings_.profilingTrace);
+			if(!profiler_->trace.is_open())
+				dlg_warn("vvg: cannot open profiling trace {}", settings_.profilingTrace);
+			else
+				profiler_->trace << "frame,draws,drawCalls,pipelineBinds,descriptorSets,"
+					"vertexBytes,indexBytes,uniformBytes,uploadBytes,buildTime,flushTime,"
+					"gpuTime\n";
+		}
+	}
+
+	frames_.resize(settings_.framesInFlight);
+	for(auto& frame : frames_) {
+		frame.uniforms = {device(), vk::BufferUsageBits::uniformBuffer |
+			vk::BufferUsageBits::storageBuffer, initialUniformSize};
+		frame.vertices = {device(), vk::BufferUsageBits::vertexBuffer, initialVertexSize};
+		frame.indices = {device(), vk::BufferUsageBits::indexBuffer, initialIndexSize};
+		frame.staging = {device(), vk::BufferUsageBits::transferSrc, initialStagingSize};
+		frame.commandBuffer = device().commandProvider().get(renderQueue_->family());
+		frame.fence = {device()};
+
+		if(swapchain_) {
+			frame.acquireSemaphore = {device()};
+			frame.renderSemaphore = {device()};
+		}
+
+		if(offscreen_) {
+			auto size = std::size_t(offscreenSize_.width) * offscreenSize_.height;
+			frame.readback = {device(), vk::BufferUsageBits::transferDst,
+				size * formatSize(offscreenFormat_)};
+		}
+
+		if(profiler_ && profiler_->timestampPeriod) {
+			vk::QueryPoolCreateInfo queryInfo;
+			queryInfo.queryType = vk::QueryType::timestamp;
+			queryInfo.queryCount = 2;
+			frame.timestamps = {device(), queryInfo};
+		}
+
+		if(transferQueue_) {
+			auto family = transferQueue_->family();
+			frame.uploadCommandBuffer = device().commandProvider().get(family);
+			frame.uploadSemaphore = {device()};
+		}
+
+		// one secondary command buffer per recording thread
+		auto recordBuffers = (settings_.recordThreads > 1) ? settings_.recordThreads : 0u;
+		frame.recordPools.reserve(recordBuffers);
+		for(auto i = 0u; i < recordBuffers; ++i) {
+			frame.recordPools.emplace_back(device(), renderQueue_->family(),
+				vk::CommandPoolCreateBits::resetCommandBuffer);
+			frame.recordBuffers.push_back(
+				frame.recordPools.back().allocate(vk::CommandBufferLevel::secondary));
+		}
+	}
+
+	// the calling thread records one of the chunks itself
+	if(settings_.recordThreads > 1)
+		workers_ = std::make_unique<WorkerPool>(settings_.recordThreads - 1);
+}
+
+vk::Pipeline Renderer::pipelineVariant(PipelineType type, std::uint8_t variant)
+{
+	// the stencil pass writes no color so its fragment shader does not matter
+	if(type == PipelineType::fillStencil)
+		variant = 0u;
+
+	auto key = (std::uint32_t(type) << 8) | variant;
+	{
+		std::lock_guard<std::mutex> lock(shared_->pipelineMutex);
+		auto it = pipelines_.find(key);
+		if(it != pipelines_.end())
+			return it->second;
+	}
+
+	// created without holding the lock so a draw does not have to wait for the prewarm
+	// thread compiling other variants. If both created this one, the first one is kept.
+	auto pipeline = createPipeline(type, variant);
+	std::lock_guard<std::mutex> lock(shared_->pipelineMutex);
+	return pipelines_.emplace(key, std::move(pipeline)).first->second;
+}
+
+void Renderer::prewarmPipelines()
+{
+	// the paint variants parsePaint can produce: color, gradient and the image
+	// texture types, each with and without scissor
+	std::vector<std::uint8_t> paints = {paintBits(typeColor, 0u), paintBits(typeGradient, 0u),
+		paintBits(typeTexture, texTypeRGBA), paintBits(typeTexture, texTypeA),
+		paintBits(typeTexture, texTypePremultiplied)};
+	if(settings_.sdfText)
+		paints.push_back(paintBits(typeTexture, texTypeSDF));
+
+	std::vector<std::pair<PipelineType, std::uint8_t>> variants;
+	for(auto scissor : {std::uint8_t(0u), variantScissor}) {
+		for(auto paint : paints) {
+			auto variant = std::uint8_t(paint | scissor);
+			variants.push_back({PipelineType::list, variant});
+			if(settings_.stencilFills) {
+				if(edgeAA_)
+					variants.push_back({PipelineType::fillFringe, variant});
+				variants.push_back({PipelineType::fillCover, variant});
+			}
+
+			// shapes are only drawn with color and gradient paints, see fillShape
+			if(paint <= typeGradient)
+				variants.push_back({PipelineType::shape, variant});
+		}
+	}
+
+	if(settings_.stencilFills)
+		variants.push_back({PipelineType::fillStencil, 0u});
+
+	for(auto& variant : variants) {
+		if(shared_->stopPrewarm.load())
+			return;
+
+		pipelineVariant(variant.first, variant.second);
+	}
+}
+
+void Renderer::stopPrewarm()
+{
+	if(!shared_ || !shared_->prewarmThread.joinable())
+		return;
+
+	shared_->stopPrewarm.store(true);
+	shared_->prewarmThread.join();
+}
+
+void Renderer::initPipelineCache()
+{
+	// explicitly given data takes precedence over the file
+	auto data = settings_.pipelineCacheData;
+	if(data.empty() && !settings_.pipelineCachePath.empty())
+		data = readFile(settings_.pipelineCachePath);
+
+	vk::PipelineCacheCreateInfo info;
+	info.initialDataSize = data.size();
+	info.pInitialData = data.empty() ? nullptr : data.data();
+	pipelineCache_ = {device(), vk::createPipelineCache(device(), info)};
+}
+
+std::vector<std::uint8_t> Renderer::pipelineCacheData() const
+{
+	std::size_t size {};
+	vk::getPipelineCacheData(device(), pipelineCache_, size, nullptr);
+
+	std::vector<std::uint8_t> data(size);
+	vk::getPipelineCacheData(device(), pipelineCache_, size, data.data());
+	data.resize(size);
+	return data;
+}
+
+vpp::Pipeline Renderer::createPipeline(PipelineType type, std::uint8_t variant)
+{
+	// constant 0: antiAliasing, constant 1: storagePaints,
+	// constants 2 to 4: paint type, texture type and scissor of the variant, see paintVariant
+	// shapes keep the coverage of their distance field when multisampling, the samples
+	// only antialias the straight edges of their quads
+	auto shape = (type == PipelineType::shape);
+	auto antiAliasing = shape ? settings_.edgeAntiAlias : edgeAA_;
+	auto scissor = (variant & variantScissor) != 0;
+	std::uint32_t constants[] = {antiAliasing, settings_.storagePaints,
+		variant & 3u, (variant >> 2) & 3u, scissor};
+	vk::SpecializationMapEntry entries[] = {{0, 0, 4}, {1, 4, 4}, {2, 8, 4}, {3, 12, 4},
+		{4, 16, 4}};
 
-	vpp::ShaderModule vertexShader(device(), fill_vert_data);
-	vpp::ShaderModule fragmentShader(device(), fill_frag_data);
+	vk::SpecializationInfo specInfo;
+	specInfo.mapEntryCount = 5;
+	specInfo.pMapEntries = entries;
+	specInfo.dataSize = sizeof(constants);
+	specInfo.pData = constants;
 
 	vpp::ShaderProgram shaderStages({
-		{vertexShader, vk::ShaderStageBits::vertex},
-		{fragmentShader, vk::ShaderStageBits::fragment, &specInfo}
+		{shape ? shapeVertexShader_ : vertexShader_, vk::ShaderStageBits::vertex, &specInfo},
+		{shape ? shapeFragmentShader_ : fragmentShader_, vk::ShaderStageBits::fragment, &specInfo}
 	});
 
 	vk::GraphicsPipelineCreateInfo pipelineInfo;
@@ -249,7 +1082,8 @@ void Renderer::init()
 	pipelineInfo.stageCount = shaderStages.vkStageInfos().size();
 	pipelineInfo.pStages = shaderStages.vkStageInfos().data();
 
-	constexpr auto stride = (2 * 4) * 2; // 2 pos floats, 2 uv floats
+	// 2 pos floats, 2 uv floats or 2 pos shorts, 2 uv shorts for compact vertices
+	std::uint32_t stride = vertexSize();
 	vk::VertexInputBindingDescription bufferBinding {0, stride, vk::VertexInputRate::vertex};
 
 	// vertex position, uv attributes
@@ -260,6 +1094,12 @@ void Renderer::init()
 	attributes[1].format = vk::Format::r32g32Sfloat;
 	attributes[1].offset = 2 * 4; // offset pos (vec2f)
 
+	if(settings_.compactVertices) {
+		attributes[0].format = vk::Format::r16g16Sint;
+		attributes[1].format = vk::Format::r16g16Unorm;
+		attributes[1].offset = 2 * 2; // offset pos (2 shorts)
+	}
+
 	vk::PipelineVertexInputStateCreateInfo vertexInfo;
 	vertexInfo.vertexBindingDescriptionCount = 1;
 	vertexInfo.pVertexBindingDescriptions = &bufferBinding;
@@ -267,10 +1107,41 @@ void Renderer::init()
 	vertexInfo.pVertexAttributeDescriptions = attributes;
 	pipelineInfo.pVertexInputState = &vertexInfo;
 
+	// fans and strips are converted to indexed triangle lists when batching so
+	// only list pipelines are needed.
 	vk::PipelineInputAssemblyStateCreateInfo assemblyInfo;
 	assemblyInfo.topology = vk::PrimitiveTopology::triangleList;
 	pipelineInfo.pInputAssemblyState = &assemblyInfo;
 
+	// shapes: the quads are generated from the instance data, no vertex input per vertex
+	vk::VertexInputBindingDescription shapeBinding {0, sizeof(ShapeInstance),
+		vk::VertexInputRate::instance};
+
+	// rect, xform, params, paint
+	vk::VertexInputAttributeDescription shapeAttributes[4];
+	shapeAttributes[0].location = 0;
+	shapeAttributes[0].format = vk::Format::r32g32b32a32Sfloat;
+	shapeAttributes[0].offset = offsetof(ShapeInstance, rect);
+
+	shapeAttributes[1].location = 1;
+	shapeAttributes[1].format = vk::Format::r32g32b32a32Sfloat;
+	shapeAttributes[1].offset = offsetof(ShapeInstance, xform);
+
+	shapeAttributes[2].location = 2;
+	shapeAttributes[2].format = vk::Format::r32g32Sfloat;
+	shapeAttributes[2].offset = offsetof(ShapeInstance, params);
+
+	shapeAttributes[3].location = 3;
+	shapeAttributes[3].format = vk::Format::r32Uint;
+	shapeAttributes[3].offset = offsetof(ShapeInstance, paint);
+
+	if(shape) {
+		vertexInfo.pVertexBindingDescriptions = &shapeBinding;
+		vertexInfo.vertexAttributeDescriptionCount = 4;
+		vertexInfo.pVertexAttributeDescriptions = shapeAttributes;
+		assemblyInfo.topology = vk::PrimitiveTopology::triangleStrip;
+	}
+
 	vk::PipelineRasterizationStateCreateInfo rasterizationInfo;
 	rasterizationInfo.polygonMode = vk::PolygonMode::fill;
 	rasterizationInfo.cullMode = vk::CullModeBits::none;
@@ -282,7 +1153,7 @@ void Renderer::init()
 	pipelineInfo.pRasterizationState = &rasterizationInfo;
 
 	vk::PipelineMultisampleStateCreateInfo multisampleInfo;
-	multisampleInfo.rasterizationSamples = vk::SampleCountBits::e1;
+	multisampleInfo.rasterizationSamples = vk::SampleCountBits(settings_.samples);
 	pipelineInfo.pMultisampleState = &multisampleInfo;
 
 	vk::PipelineColorBlendAttachmentState blendAttachment;
@@ -319,419 +1190,2473 @@ void Renderer::init()
 	dynamicInfo.pDynamicStates = dynStates.begin();
 	pipelineInfo.pDynamicState = &dynamicInfo;
 
-	// copy for strip pipeline
-	auto stripInfo = pipelineInfo;
-	auto stripAssembly = assemblyInfo;
-	stripAssembly.topology = vk::PrimitiveTopology::triangleStrip;
-	stripInfo.pInputAssemblyState = &stripAssembly;
-	stripInfo.basePipelineIndex = 0;
+	// stencil-then-cover fill pipelines, the same states as the nanovg gl implementation
+	vk::StencilOpState stencilOp;
+	stencilOp.compareMask = 0xff;
+	stencilOp.writeMask = 0xff;
+	stencilOp.reference = 0;
+
+	switch(type) {
+		case PipelineType::fillStencil:
+			// stencil: count the winding, front faces increment, back faces decrement
+			depthStencilInfo.stencilTestEnable = true;
+			depthStencilInfo.front = stencilOp;
+			depthStencilInfo.front.compareOp = vk::CompareOp::always;
+			depthStencilInfo.front.failOp = vk::StencilOp::keep;
+			depthStencilInfo.front.depthFailOp = vk::StencilOp::keep;
+			depthStencilInfo.front.passOp = vk::StencilOp::incrementAndWrap;
+			depthStencilInfo.back = depthStencilInfo.front;
+			depthStencilInfo.back.passOp = vk::StencilOp::decrementAndWrap;
+
+			blendAttachment.blendEnable = false;
+			blendAttachment.colorWriteMask = {};
+			break;
+		case PipelineType::fillFringe:
+			// fringe: only outside of the filled area
+			depthStencilInfo.stencilTestEnable = true;
+			depthStencilInfo.front = stencilOp;
+			depthStencilInfo.front.compareOp = vk::CompareOp::equal;
+			depthStencilInfo.front.failOp = vk::StencilOp::keep;
+			depthStencilInfo.front.depthFailOp = vk::StencilOp::keep;
+			depthStencilInfo.front.passOp = vk::StencilOp::keep;
+			depthStencilInfo.back = depthStencilInfo.front;
+			break;
+		case PipelineType::fillCover:
+			// cover: only the filled area, resets the stencil buffer
+			depthStencilInfo.stencilTestEnable = true;
+			depthStencilInfo.front = stencilOp;
+			depthStencilInfo.front.compareOp = vk::CompareOp::notEqual;
+			depthStencilInfo.front.failOp = vk::StencilOp::zero;
+			depthStencilInfo.front.depthFailOp = vk::StencilOp::zero;
+			depthStencilInfo.front.passOp = vk::StencilOp::zero;
+			depthStencilInfo.back = depthStencilInfo.front;
+			break;
+		default:
+			break;
+	}
+
+	auto pipelines = vk::createGraphicsPipelines(device(), pipelineCache_, {pipelineInfo});
+	return {device(), pipelines[0]};
+}
+
+void Renderer::initRenderTargets()
+{
+	auto size = swapchain_ ? swapchain_->size() : offscreenSize_;
+	auto format = swapchain_ ? swapchain_->format() : offscreenFormat_;
+
+	auto stencilInfo = vpp::ViewableImage::defaultDepth2D();
+	stencilInfo.imgInfo.format = vk::Format::s8Uint;
+	stencilInfo.viewInfo.format = vk::Format::s8Uint;
+	stencilInfo.viewInfo.subresourceRange.aspectMask = vk::ImageAspectBits::stencil;
+
+	// the multisampled attachments never leave the render pass (see initRenderPass) so
+	// tilers can keep them in tile memory without backing them
+	auto multisampled = settings_.samples > 1;
+	auto colorInfo = vpp::ViewableImage::defaultColor2D();
+	if(multisampled) {
+		auto samples = vk::SampleCountBits(settings_.samples);
+		auto memBits = device().memoryTypeBits(vk::MemoryPropertyBits::lazilyAllocated);
+		if(!memBits)
+			memBits = device().memoryTypeBits(vk::MemoryPropertyBits::deviceLocal);
+
+		colorInfo.imgInfo.format = format;
+		colorInfo.viewInfo.format = format;
+		colorInfo.imgInfo.samples = samples;
+		colorInfo.imgInfo.usage = vk::ImageUsageBits::colorAttachment |
+			vk::ImageUsageBits::transientAttachment;
+		colorInfo.memoryTypeBits = memBits;
+
+		stencilInfo.imgInfo.samples = samples;
+		stencilInfo.imgInfo.usage = vk::ImageUsageBits::depthStencilAttachment |
+			vk::ImageUsageBits::transientAttachment;
+		stencilInfo.memoryTypeBits = memBits;
+	}
 
-	// copy for fan pipelien
-	auto fanInfo = pipelineInfo;
-	auto fanAssembly = assemblyInfo;
-	fanAssembly.topology = vk::PrimitiveTopology::triangleFan;
-	fanInfo.pInputAssemblyState = &fanAssembly;
-	fanInfo.basePipelineIndex = 0;
+	// offscreen every frame slot has its own images so the frames in flight do
+	// not have to wait for each other. They are created with the framebuffers
+	if(offscreen_) {
+		auto imageInfo = vpp::ViewableImage::defaultColor2D();
+		imageInfo.imgInfo.format = format;
+		imageInfo.viewInfo.format = format;
+		imageInfo.imgInfo.usage = vk::ImageUsageBits::colorAttachment |
+			vk::ImageUsageBits::transferSrc;
+
+		renderTargets_.resize(frames_.size());
+		for(auto& target : renderTargets_) {
+			if(multisampled) {
+				target.framebuffer = {device(), renderPass_, size,
+					{colorInfo, stencilInfo, imageInfo}};
+				target.image = target.framebuffer.attachments()[2].image().vkHandle();
+			} else {
+				target.framebuffer = {device(), renderPass_, size, {imageInfo, stencilInfo}};
+				target.image = target.framebuffer.attachments()[0].image().vkHandle();
+			}
+		}
 
-	constexpr auto cacheName = "grapihcsPipelineCache.bin";
+		return;
+	}
 
-	vpp::PipelineCache cache;
-	if(vpp::fileExists(cacheName)) cache = {device(), cacheName};
-	else cache = {device()};
-	auto pipelines = vk::createGraphicsPipelines(device(), cache,
-		{pipelineInfo, stripInfo, fanInfo});
+	auto images = vk::getSwapchainImagesKHR(device(), *swapchain_);
+	renderTargets_.resize(images.size());
+	for(auto i = 0u; i < images.size(); ++i) {
+		vk::ImageViewCreateInfo viewInfo;
+		viewInfo.image = images[i];
+		viewInfo.viewType = vk::ImageViewType::e2d;
+		viewInfo.format = swapchain_->format();
+		viewInfo.subresourceRange = {vk::ImageAspectBits::color, 0, 1, 0, 1};
+
+		auto& target = renderTargets_[i];
+		target.imageView = {device(), vk::createImageView(device(), viewInfo)};
+
+		// attachment 0 is the swapchain image, the stencil attachment is created.
+		// When multisampling the swapchain image is the resolve attachment 2 instead
+		if(multisampled) {
+			target.framebuffer = {device(), renderPass_, size, {colorInfo, stencilInfo},
+				{{2, target.imageView.vkHandle()}}};
+		} else {
+			target.framebuffer = {device(), renderPass_, size, {stencilInfo},
+				{{0, target.imageView.vkHandle()}}};
+		}
+	}
+}
 
-	listPipeline_ = {device(), pipelines[0]};
-	stripPipeline_ = {device(), pipelines[1]};
-	fanPipeline_ = {device(), pipelines[2]};
+Frame& Renderer::currentFrame(std::unique_lock<std::recursive_mutex>& lock)
+{
+	// the slot might change while the lock is released
+	while(true) {
+		auto& frame = frames_[frameIndex_];
+		if(!frame.pending)
+			return frame;
 
-	// save the cache to the file we tried to load it from
-	vpp::save(cache, cacheName);
+		waitFrame(frame, lock);
+	}
+}
 
-	// create a dummy image used for unbound image descriptors
-	// TODO: find out if this is actually needed or a bug in the layers
-	dummyTexture_ = {device(), (unsigned int) -1, {2, 2}, vk::Format::r8g8b8a8Unorm};
+Frame& Renderer::currentFrame()
+{
+	std::unique_lock<std::recursive_mutex> lock(shared_->mutex);
+	return currentFrame(lock);
 }
 
-unsigned int Renderer::createTexture(vk::Format format, unsigned int w, unsigned int h,
-	const std::uint8_t* data)
+void Renderer::waitFrame(Frame& frame)
 {
-	++texID_;
-	textures_.emplace_back(device(), texID_, vk::Extent2D{w, h}, format, data);
-	return texID_;
+	std::unique_lock<std::recursive_mutex> lock(shared_->mutex);
+	waitFrame(frame, lock);
 }
 
-bool Renderer::deleteTexture(unsigned int id)
+void Renderer::waitFrame(Frame& frame, std::unique_lock<std::recursive_mutex>& lock)
 {
-	auto it = std::find_if(textures_.begin(), textures_.end(),
-		[=](const auto& tex) { return tex.id() == id; });
+	if(!frame.pending)
+		return;
 
-	if(it == textures_.end()) return false;
+	// the shared contexts should not be blocked behind the device. Another thread
+	// might finish the frame meanwhile, and only the flushing thread submits it again.
+	// The fence stays signaled until the slot is submitted again, see Readback::fence
+	auto number = frame.number;
+	vk::Fence fence = frame.fence;
+	lock.unlock();
+	vk::waitForFences(device(), {fence}, true, UINT64_MAX);
+	lock.lock();
 
-	textures_.erase(it);
-	return true;
+	if(!frame.pending || frame.number != number)
+		return;
+
+	frame.pending = false;
+
+	// frames are executed in submission order
+	completed_ = std::max(completed_, frame.number);
+	if(profiler_ && frame.stats.frame)
+		finishStats(frame);
+
+	frame.staging.reset();
+	frame.uploadedScenes.clear();
+	frame.scenes.clear();
+
+	// destroy the textures no frame in flight uses anymore
+	auto finished = [&](const auto& entry) { return entry.first <= completed_; };
+	destroyed_.erase(std::remove_if(destroyed_.begin(), destroyed_.end(), finished),
+		destroyed_.end());
 }
 
-void Renderer::start(unsigned int width, unsigned int height)
+void Renderer::finishStats(Frame& frame)
 {
-	// store (and set) viewport in some way
-	width_ = width;
-	height_ = height;
+	auto& stats = frame.stats;
+	stats.gpuTime = -1.0;
+	if(frame.timestamps) {
+		std::uint64_t ticks[2] {};
+		auto result = vk::getQueryPoolResults(device(), frame.timestamps, 0, 2, sizeof(ticks),
+			ticks, sizeof(ticks[0]), vk::QueryResultBits::e64);
+		if(result == vk::Result::success) {
+			auto elapsed = (ticks[1] - ticks[0]) & profiler_->timestampMask;
+			stats.gpuTime = elapsed * profiler_->timestampPeriod;
+		}
+	}
 
-	vertices_.clear();
-	drawDatas_.clear();
+	stats_ = stats;
+	if(profiler_->trace.is_open()) {
+		profiler_->trace << stats.frame << "," << stats.draws << "," << stats.drawCalls << ","
+			<< stats.pipelineBinds << "," << stats.descriptorSets << ","
+			<< stats.vertexBytes << "," << stats.indexBytes << "," << stats.uniformBytes << ","
+			<< stats.uploadBytes << "," << stats.buildTime << "," << stats.flushTime << ","
+			<< stats.gpuTime << "\n";
+	}
+
+	stats = {};
 }
 
-void Renderer::cancel()
+void Renderer::wait()
 {
+	for(auto& frame : frames_)
+		waitFrame(frame);
 }
 
-void Renderer::flush()
+void Renderer::resize()
 {
-	if(drawDatas_.empty())
-		return;
+	if(!swapchain_)
+		throw std::runtime_error("vvg::Renderer::resize: not rendering on a swapchain");
+
+	// the frames in flight might still render on the old framebuffers
+	wait();
+	std::lock_guard<std::recursive_mutex> lock(shared_->mutex);
+
+	// the pipelines depend on the render pass which depends on the format
+	if(swapchain_->format() != renderPassFormat_) {
+		stopPrewarm();
+		initRenderPass(device(), swapchain_->format());
+		pipelines_.clear();
+		prepared_ = false;
+	}
 
-	// allocate buffers
-	auto uniformSize = sizeof(UniformData) * drawDatas_.size();
-	auto bits = device().memoryTypeBits(vk::MemoryPropertyBits::hostVisible);
+	// the new images are rendered completely
+	renderTargets_.clear();
+	initRenderTargets();
+	drawRecords_.clear();
+	damages_.clear();
+	outOfDate_ = false;
+}
+
+bool Renderer::dirtyRegions() const
+{
+	// the multisampled attachments are not stored so they cannot keep their contents
+	return settings_.dirtyRegions && swapchain_ && settings_.samples <= 1;
+}
+
+vk::Rect2D Renderer::trackDamage(const Frame& frame, const vk::Extent2D& size)
+{
+	// the contents of the textures uploaded this frame change
+	std::vector<unsigned int> uploaded;
+	for(auto& upload : frame.uploads)
+		uploaded.push_back(upload.texture);
+	for(auto& upload : frame.transferUploads)
+		uploaded.push_back(upload.texture);
+
+	auto vertSize = vertexSize();
+	auto hashVertices = [&](std::uint64_t hash, std::size_t first, std::size_t count) {
+		return hashBytes(hash, frame.vertices.data(first * vertSize), count * vertSize);
+	};
+
+	// view coordinates to render target pixels, one more pixel for rounding and the fringe
+	auto sx = float(size.width) / std::max(width_, 1u);
+	auto sy = float(size.height) / std::max(height_, 1u);
+	auto pixels = [&](const std::array<float, 4>& bounds) {
+		auto x0 = std::max(std::floor(bounds[0] * sx) - 1.f, 0.f);
+		auto y0 = std::max(std::floor(bounds[1] * sy) - 1.f, 0.f);
+		auto x1 = std::min(std::ceil(bounds[2] * sx) + 1.f, float(size.width));
+		auto y1 = std::min(std::ceil(bounds[3] * sy) + 1.f, float(size.height));
+		if(x1 <= x0 || y1 <= y0)
+			return vk::Rect2D {};
+
+		return vk::Rect2D {{int(x0), int(y0)}, {unsigned(x1 - x0), unsigned(y1 - y0)}};
+	};
+
+	std::vector<DrawRecord> records;
+	records.reserve(drawDatas_.size());
+	for(auto& data : drawDatas_) {
+		auto hash = hashBytes(hashBasis, frame.uniforms.data(data.uniformOffset),
+			sizeof(UniformData));
+		hash = hashBytes(hash, &data.texture, sizeof(data.texture));
+		hash = hashBytes(hash, &data.variant, sizeof(data.variant));
+		for(auto& path : drawPaths(paths_, data)) {
+			hash = hashVertices(hash, path.fillOffset, path.fillCount);
+			hash = hashVertices(hash, path.strokeOffset, path.strokeCount);
+		}
+
+		hash = hashVertices(hash, data.triangleOffset, data.triangleCount);
+		if(data.stencilFill)
+			hash = hashVertices(hash, data.coverOffset, 4);
+
+		// the paint index of shapes depends on the other paints of the frame
+		auto shapeSize = sizeof(ShapeInstance);
+		auto shapes = frame.vertices.data(data.shapeOffset * shapeSize);
+		for(auto i = 0u; i < data.shapeCount; ++i)
+			hash = hashBytes(hash, shapes + i * shapeSize, offsetof(ShapeInstance, paint));
+
+		records.push_back({hash, pixels(data.bounds)});
+	}
+
+	// draws are compared by their position in the frame, when a draw is inserted or
+	// removed all following ones count as changed
+	vk::Rect2D damage {};
+	for(auto i = 0u; i < std::max(records.size(), drawRecords_.size()); ++i) {
+		auto changed = i >= records.size() || i >= drawRecords_.size() ||
+			records[i].hash != drawRecords_[i].hash ||
+			std::find(uploaded.begin(), uploaded.end(), drawDatas_[i].texture) != uploaded.end();
+		if(!changed)
+			continue;
+
+		if(i < records.size())
+			damage = unite(damage, records[i].bounds);
+		if(i < drawRecords_.size())
+			damage = unite(damage, drawRecords_[i].bounds);
+	}
+
+	// the contents of scenes are not tracked and they set their own scissor
+	auto full = !frame.scenes.empty() || damageScenes_ ||
+		damageViewport_.width != width_ || damageViewport_.height != height_;
+
+	drawRecords_ = std::move(records);
+	damageScenes_ = !frame.scenes.empty();
+	damageViewport_ = {width_, height_};
+
+	if(full)
+		return {{0, 0}, size};
+
+	return damage;
+}
+
+Readback Renderer::readback() const
+{
+	if(!offscreen_ || !submitted_)
+		return {};
+
+	// flush always moves on to the next slot for offscreen frames
+	auto& frame = frames_[(frameIndex_ + frames_.size() - 1) % frames_.size()];
+
+	Readback ret;
+	ret.frame = frame.number;
+	ret.fence = frame.fence;
+	ret.data = frame.readback.data();
+	ret.size = frame.readback.size();
+	return ret;
+}
+
+const vpp::Buffer& Renderer::uniformBuffer() const
+{
+	return frames_[frameIndex_].uniforms.buffer();
+}
+
+const vpp::Buffer& Renderer::vertexBuffer() const
+{
+	return frames_[frameIndex_].vertices.buffer();
+}
+
+const vpp::DescriptorPool& Renderer::descriptorPool() const
+{
+	return frames_[frameIndex_].descriptorPool;
+}
+
+const vpp::CommandBuffer& Renderer::commandBuffer() const
+{
+	return frames_[frameIndex_].commandBuffer;
+}
+
+unsigned int Renderer::allocateTexture()
+{
+	// reuse a free slot if there is one
+	unsigned int slot;
+	if(!freeTextureSlots_.empty()) {
+		slot = freeTextureSlots_.back();
+		freeTextureSlots_.pop_back();
+	} else {
+		slot = textures_.size();
+		if(slot >= textureIndexMask) throw std::runtime_error("vvg::Renderer: too many textures");
+		textures_.emplace_back();
+	}
+
+	// the generation makes sure ids of deleted textures are not reused
+	// immediately. Never produces 0 since the index is stored with an offset of 1.
+	auto& entry = textures_[slot];
+	++entry.generation;
+	return ((entry.generation << textureIndexBits) | (slot + 1)) & textureIDMask;
+}
+
+unsigned int Renderer::createTexture(vk::Format format, unsigned int w, unsigned int h,
+	const std::uint8_t* data, int imageFlags, bool atlas)
+{
+	// the slot is waited for first so the lock is not held meanwhile, the uploads
+	// write into it
+	std::unique_lock<std::recursive_mutex> lock(shared_->mutex);
+	currentFrame(lock);
+
+	// an atlas region cannot be repeated or have its own sampler
+	atlas &= !(imageFlags & samplerFlags);
+	auto maxSize = std::min(settings_.atlasSize, settings_.atlasPageSize - 2 * atlasPadding);
+	if(atlas && settings_.atlasPageSize > 2 * atlasPadding && w && h &&
+			w <= maxSize && h <= maxSize)
+		return createAtlasTexture(format, w, h, data, imageFlags);
+
+	// the mipmaps are generated with linear blits
+	if(imageFlags & NVG_IMAGE_GENERATE_MIPMAPS) {
+		auto features = vk::getPhysicalDeviceFormatProperties(vkPhysicalDevice(), format).
+			optimalTilingFeatures;
+		if(!(features & vk::FormatFeatureBits::blitSrc) ||
+				!(features & vk::FormatFeatureBits::blitDst) ||
+				!(features & vk::FormatFeatureBits::sampledImageFilterLinear)) {
+			dlg_warn("vvg::Renderer: cannot generate mipmaps for format {}", int(format));
+			imageFlags &= ~NVG_IMAGE_GENERATE_MIPMAPS;
+		}
+	}
+
+	auto id = allocateTexture();
+	auto& entry = textures_[(id & textureIndexMask) - 1];
+
+	// with the transfer queue the image is used on both queue families
+	std::vector<std::uint32_t> families;
+	if(transferQueue_)
+		families = {renderQueue_->family(), transferQueue_->family()};
+
+	entry.texture = {device(), id, vk::Extent2D{w, h}, format, families, imageFlags};
+
+	// the upload is recorded in the next flush, the data is only copied into
+	// the staging buffer here
+	upload(entry.texture, data, true);
+	return id;
+}
+
+unsigned int Renderer::createAtlasTexture(vk::Format format, unsigned int w, unsigned int h,
+	const std::uint8_t* data, int imageFlags)
+{
+	auto size = settings_.atlasPageSize;
+	auto pw = w + 2 * atlasPadding;
+	auto ph = h + 2 * atlasPadding;
+
+	// the first shelf that is high enough without wasting more than half of it,
+	// otherwise a new shelf below the last one
+	auto pack = [&](AtlasPage& page, vk::Offset2D& pos) {
+		for(auto& shelf : page.shelves) {
+			if(ph <= shelf.height && 2 * ph >= shelf.height && shelf.width + pw <= size) {
+				pos = {int(shelf.width), int(shelf.y)};
+				shelf.width += pw;
+				return true;
+			}
+		}
+
+		auto y = page.shelves.empty() ? 0u :
+			page.shelves.back().y + page.shelves.back().height;
+		if(y + ph > size)
+			return false;
+
+		page.shelves.push_back({y, ph, pw});
+		pos = {0, int(y)};
+		return true;
+	};
+
+	AtlasPage* page = nullptr;
+	vk::Offset2D pos {};
+	for(auto& p : atlasPages_) {
+		if(texture(p.texture)->format() == format && pack(p, pos)) {
+			page = &p;
+			break;
+		}
+	}
+
+	// the page contents are only initialized by the uploads of its textures, so its
+	// layout is initialized on the render queue before them
+	if(!page) {
+		std::vector<std::uint32_t> families;
+		if(transferQueue_)
+			families = {renderQueue_->family(), transferQueue_->family()};
+
+		auto id = allocateTexture();
+		auto& tex = textures_[(id & textureIndexMask) - 1].texture;
+		tex = {device(), id, vk::Extent2D{size, size}, format, families};
+
+		Upload upload {};
+		upload.texture = id;
+		upload.initial = true;
+		currentFrame().uploads.push_back(upload);
+
+		atlasPages_.push_back({id, 0u, {}});
+		page = &atlasPages_.back();
+		pack(*page, pos);
+	}
+
+	auto id = allocateTexture();
+	auto& tex = textures_[(id & textureIndexMask) - 1].texture;
+	vk::Rect2D region {{int(pos.x + atlasPadding), int(pos.y + atlasPadding)}, {w, h}};
+	tex = {id, *texture(page->texture), region, imageFlags};
+	++page->entries;
+
+	if(data)
+		uploadAtlas(tex, data);
+
+	return id;
+}
+
+void Renderer::uploadAtlas(const Texture& tex, const std::uint8_t* data)
+{
+	auto& frame = currentFrame();
+	auto texelSize = formatSize(tex.format());
+	auto w = tex.width();
+	auto h = tex.height();
+	auto pw = std::size_t(w + 2 * atlasPadding);
+	auto ph = std::size_t(h + 2 * atlasPadding);
+
+	// the border texels are repeated into the padding
+	auto offset = frame.staging.allocate(pw * ph * texelSize, 16u);
+	auto dst = frame.staging.data(offset);
+	for(auto y = std::size_t(0); y < ph; ++y) {
+		auto sy = std::min<std::size_t>(std::max<std::size_t>(y, atlasPadding) - atlasPadding,
+			h - 1u);
+		auto src = data + sy * w * texelSize;
+		auto row = dst + y * pw * texelSize;
+		for(auto i = 0u; i < atlasPadding; ++i) {
+			std::memcpy(row + i * texelSize, src, texelSize);
+			std::memcpy(row + (atlasPadding + w + i) * texelSize, src + (w - 1) * texelSize,
+				texelSize);
+		}
+
+		std::memcpy(row + atlasPadding * texelSize, src, w * texelSize);
+	}
+
+	auto& region = tex.region();
+	Upload upload {};
+	upload.texture = tex.page();
+	upload.initial = false;
+	upload.copy = true;
+	upload.region.bufferOffset = offset;
+	upload.region.imageSubresource = {vk::ImageAspectBits::color, 0, 0, 1};
+	upload.region.imageOffset = {int(region.offset.x - atlasPadding),
+		int(region.offset.y - atlasPadding), 0};
+	upload.region.imageExtent = {unsigned(pw), unsigned(ph), 1};
+	frame.uploads.push_back(upload);
+}
+
+bool Renderer::deleteTexture(unsigned int id)
+{
+	std::lock_guard<std::recursive_mutex> lock(shared_->mutex);
+	auto* tex = texture(id);
+	if(!tex) return false;
+
+	// atlas textures only free their space once the page is empty. Frames in flight
+	// that still sample the page are finished before anything is uploaded into it again
+	if(tex->page()) {
+		auto page = std::find_if(atlasPages_.begin(), atlasPages_.end(),
+			[&](const AtlasPage& p) { return p.texture == tex->page(); });
+		if(page != atlasPages_.end() && --page->entries == 0)
+			page->shelves.clear();
+
+		*tex = {};
+		freeTextureSlots_.push_back((id & textureIndexMask) - 1);
+		return true;
+	}
+
+	// the already submitted frames might still use it
+	for(auto& frame : frames_)
+		frame.descriptorSets.erase(id);
+
+	destroyed_.emplace_back(submitted_, std::move(*tex));
+	*tex = {};
+	freeTextureSlots_.push_back((id & textureIndexMask) - 1);
+	return true;
+}
+
+const vpp::Sampler& Renderer::textureSampler(int imageFlags)
+{
+	auto key = imageFlags & samplerFlags;
+	if(!key)
+		return sampler_;
+
+	auto it = samplers_.find(key);
+	if(it == samplers_.end())
+		it = samplers_.emplace(key, vpp::Sampler(device(), samplerInfo(key))).first;
+
+	return it->second;
+}
+
+void Renderer::dispatch(unsigned int count, void (*func)(void*, int), void* data)
+{
+	auto call = [&](unsigned int i) { func(data, i); };
+	if(workers_) workers_->run(count, call);
+	else for(auto i = 0u; i < count; ++i) call(i);
+}
+
+bool Renderer::updateTexture(unsigned int id, const vk::Offset2D& offset,
+	const vk::Extent2D& extent, const std::uint8_t& data)
+{
+	// see createTexture
+	std::unique_lock<std::recursive_mutex> lock(shared_->mutex);
+	currentFrame(lock);
+	auto* tex = texture(id);
+	if(!tex) return false;
+
+	// the padding of atlas textures depends on the borders, so they are staged completely.
+	// Atlas textures are small, so this is not much more
+	if(tex->page()) {
+		uploadAtlas(*tex, &data);
+		return true;
+	}
+
+	auto x = std::min<unsigned int>(std::max(offset.x, 0), tex->width());
+	auto y = std::min<unsigned int>(std::max(offset.y, 0), tex->height());
+	auto w = std::min(extent.width, tex->width() - x);
+	auto h = std::min(extent.height, tex->height() - y);
+	if(!w || !h) return true;
+
+	// only the rows of the updated region are copied into the staging buffer.
+	// The region is addressed with the texture width as row length.
+	auto& frame = currentFrame();
+	auto texelSize = formatSize(tex->format());
+	auto begin = (std::size_t(y) * tex->width() + x) * texelSize;
+	auto size = ((std::size_t(h) - 1) * tex->width() + w) * texelSize;
+	auto stagingOffset = frame.staging.write(&data + begin, size, 16u);
+
+	Upload upload {};
+	upload.texture = id;
+	upload.initial = false;
+	upload.copy = true;
+	upload.region.bufferOffset = stagingOffset;
+	upload.region.bufferRowLength = tex->width();
+	upload.region.imageSubresource = {vk::ImageAspectBits::color, 0, 0, 1};
+	upload.region.imageOffset = {int(x), int(y), 0};
+	upload.region.imageExtent = {w, h, 1};
+	frame.uploads.push_back(upload);
+
+	return true;
+}
+
+void Renderer::upload(const Texture& tex, const std::uint8_t* data, bool initial)
+{
+	// the staging buffer of the slot must not be used by the device anymore
+	auto& frame = currentFrame();
+
+	Upload upload {};
+	upload.texture = tex.id();
+	upload.initial = initial;
+	upload.copy = data;
+
+	if(data) {
+		auto size = std::size_t(tex.width()) * tex.height() * formatSize(tex.format());
+		auto offset = frame.staging.write(data, size, 16u);
+
+		upload.region.bufferOffset = offset;
+		upload.region.imageSubresource = {vk::ImageAspectBits::color, 0, 0, 1};
+		upload.region.imageExtent = {tex.width(), tex.height(), 1};
+	}
+
+	// only the initial upload can be done on the transfer queue since the
+	// texture is not sampled by any previous frame. Mipmaps need blits on the render queue
+	if(initial && transferQueue_ && tex.levels() == 1) frame.transferUploads.push_back(upload);
+	else frame.uploads.push_back(upload);
+}
+
+bool Renderer::submitTransferUploads(Frame& frame)
+{
+	if(frame.transferUploads.empty())
+		return false;
+
+	auto cmdBuffer = frame.uploadCommandBuffer.vkHandle();
+	vk::beginCommandBuffer(cmdBuffer, {});
+
+	std::vector<vk::ImageMemoryBarrier> barriers;
+	for(auto& upload : frame.transferUploads) {
+		auto* tex = texture(upload.texture);
+		if(!tex)
+			continue;
+
+		vk::ImageMemoryBarrier barrier;
+		barrier.image = tex->viewableImage().image().vkHandle();
+		barrier.subresourceRange = {vk::ImageAspectBits::color, 0, 1, 0, 1};
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.oldLayout = vk::ImageLayout::undefined;
+		barrier.newLayout = vk::ImageLayout::transferDstOptimal;
+		barrier.dstAccessMask = vk::AccessBits::transferWrite;
+		vk::cmdPipelineBarrier(cmdBuffer, vk::PipelineStageBits::topOfPipe,
+			vk::PipelineStageBits::transfer, {}, {}, {}, {barrier});
+
+		if(upload.copy)
+			vk::cmdCopyBufferToImage(cmdBuffer, frame.staging.buffer(), barrier.image,
+				vk::ImageLayout::transferDstOptimal, {upload.region});
+
+		// the semaphore makes the data available to the graphics queue
+		barrier.oldLayout = vk::ImageLayout::transferDstOptimal;
+		barrier.srcAccessMask = vk::AccessBits::transferWrite;
+		barrier.newLayout = vk::ImageLayout::shaderReadOnlyOptimal;
+		barrier.dstAccessMask = {};
+		barriers.push_back(barrier);
+	}
+
+	if(!barriers.empty())
+		vk::cmdPipelineBarrier(cmdBuffer, vk::PipelineStageBits::transfer,
+			vk::PipelineStageBits::bottomOfPipe, {}, {}, {}, barriers);
+
+	vk::endCommandBuffer(cmdBuffer);
+
+	vk::Semaphore semaphore = frame.uploadSemaphore;
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmdBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &semaphore;
+	vk::queueSubmit(transferQueue_->vkHandle(), {submitInfo}, {});
+
+	frame.transferUploads.clear();
+	return true;
+}
+
+void Renderer::recordUploads(vk::CommandBuffer cmdBuffer)
+{
+	std::lock_guard<std::recursive_mutex> lock(shared_->mutex);
+	auto& frame = frames_[frameIndex_];
+	recordSceneUploads(cmdBuffer, frame);
+	if(frame.uploads.empty())
+		return;
+
+	// every texture is only transitioned once, even if it is updated multiple times
+	std::vector<unsigned int> ids;
+	std::vector<vk::ImageMemoryBarrier> barriers;
+	vk::PipelineStageFlags srcStages {};
+
+	for(auto& upload : frame.uploads) {
+		if(std::find(ids.begin(), ids.end(), upload.texture) != ids.end())
+			continue;
+
+		// the texture might have already been deleted again
+		auto* tex = texture(upload.texture);
+		if(!tex)
+			continue;
+
+		ids.push_back(upload.texture);
+		barriers.emplace_back();
+
+		auto& barrier = barriers.back();
+		barrier.image = tex->viewableImage().image().vkHandle();
+		barrier.subresourceRange = {vk::ImageAspectBits::color, 0, tex->levels(), 0, 1};
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.newLayout = vk::ImageLayout::transferDstOptimal;
+		barrier.dstAccessMask = vk::AccessBits::transferWrite;
+
+		// the first upload of a texture is always the initial one.
+		// Otherwise previous frames might still sample it
+		if(upload.initial) {
+			srcStages |= vk::PipelineStageBits::topOfPipe;
+			barrier.oldLayout = vk::ImageLayout::undefined;
+			barrier.srcAccessMask = {};
+		} else {
+			srcStages |= vk::PipelineStageBits::fragmentShader;
+			barrier.oldLayout = vk::ImageLayout::shaderReadOnlyOptimal;
+			barrier.srcAccessMask = vk::AccessBits::shaderRead;
+		}
+	}
+
+	if(!barriers.empty())
+		vk::cmdPipelineBarrier(cmdBuffer, srcStages, vk::PipelineStageBits::transfer, {}, {},
+			{}, barriers);
+
+	for(auto i = 0u; i < ids.size(); ++i) {
+		auto copied = false;
+		for(auto& upload : frame.uploads) {
+			if(upload.texture != ids[i] || !upload.copy)
+				continue;
+
+			// updated regions of the same texture might overlap
+			if(copied) {
+				vk::MemoryBarrier barrier;
+				barrier.srcAccessMask = vk::AccessBits::transferWrite;
+				barrier.dstAccessMask = vk::AccessBits::transferWrite;
+				vk::cmdPipelineBarrier(cmdBuffer, vk::PipelineStageBits::transfer,
+					vk::PipelineStageBits::transfer, {}, {barrier}, {}, {});
+			}
+
+			vk::cmdCopyBufferToImage(cmdBuffer, frame.staging.buffer(), barriers[i].image,
+				vk::ImageLayout::transferDstOptimal, {upload.region});
+			copied = true;
+		}
+	}
+
+	// the mipmaps are regenerated after every upload, every level is blitted from the
+	// previous one which is then transitioned to transferSrcOptimal.
+	// Afterwards all but the last level are in transferSrcOptimal
+	std::vector<vk::ImageMemoryBarrier> finalBarriers;
+	for(auto i = 0u; i < ids.size(); ++i) {
+		auto barrier = barriers[i];
+		auto levels = barrier.subresourceRange.levelCount;
+		auto* tex = texture(ids[i]);
+
+		for(auto level = 1u; level < levels; ++level) {
+			auto src = barrier;
+			src.subresourceRange = {vk::ImageAspectBits::color, level - 1, 1, 0, 1};
+			src.oldLayout = vk::ImageLayout::transferDstOptimal;
+			src.srcAccessMask = vk::AccessBits::transferWrite;
+			src.newLayout = vk::ImageLayout::transferSrcOptimal;
+			src.dstAccessMask = vk::AccessBits::transferRead;
+			vk::cmdPipelineBarrier(cmdBuffer, vk::PipelineStageBits::transfer,
+				vk::PipelineStageBits::transfer, {}, {}, {}, {src});
+
+			auto extent = [&](unsigned int l) {
+				return vk::Offset3D {int(std::max(tex->width() >> l, 1u)),
+					int(std::max(tex->height() >> l, 1u)), 1};
+			};
+
+			vk::ImageBlit blit;
+			blit.srcSubresource = {vk::ImageAspectBits::color, level - 1, 0, 1};
+			blit.srcOffsets[1] = extent(level - 1);
+			blit.dstSubresource = {vk::ImageAspectBits::color, level, 0, 1};
+			blit.dstOffsets[1] = extent(level);
+			vk::cmdBlitImage(cmdBuffer, barrier.image, vk::ImageLayout::transferSrcOptimal,
+				barrier.image, vk::ImageLayout::transferDstOptimal, {blit}, vk::Filter::linear);
+		}
+
+		barrier.newLayout = vk::ImageLayout::shaderReadOnlyOptimal;
+		barrier.dstAccessMask = vk::AccessBits::shaderRead;
+		if(levels > 1) {
+			barrier.subresourceRange = {vk::ImageAspectBits::color, 0, levels - 1, 0, 1};
+			barrier.oldLayout = vk::ImageLayout::transferSrcOptimal;
+			barrier.srcAccessMask = vk::AccessBits::transferRead;
+			finalBarriers.push_back(barrier);
+		}
+
+		barrier.subresourceRange = {vk::ImageAspectBits::color, levels - 1, 1, 0, 1};
+		barrier.oldLayout = vk::ImageLayout::transferDstOptimal;
+		barrier.srcAccessMask = vk::AccessBits::transferWrite;
+		finalBarriers.push_back(barrier);
+	}
+
+	if(!finalBarriers.empty())
+		vk::cmdPipelineBarrier(cmdBuffer, vk::PipelineStageBits::transfer,
+			vk::PipelineStageBits::fragmentShader, {}, {}, {}, finalBarriers);
+
+	frame.uploads.clear();
+}
+
+void Renderer::recordSceneUploads(vk::CommandBuffer cmdBuffer, Frame& frame)
+{
+	if(frame.sceneUploads.empty())
+		return;
+
+	// the parts are kept alive by the frame until it has finished
+	auto& staging = frame.staging.buffer();
+	auto copy = [&](const vpp::Buffer& dst, const vk::BufferCopy& region) {
+		if(region.size)
+			vk::cmdCopyBuffer(cmdBuffer, staging, dst, {region});
+	};
+
+	for(auto& upload : frame.sceneUploads) {
+		auto& part = *upload.part;
+		copy(part.vertices, upload.vertices);
+		copy(part.indices, upload.indices);
+		copy(part.uniforms, upload.uniforms);
+	}
+
+	vk::MemoryBarrier barrier;
+	barrier.srcAccessMask = vk::AccessBits::transferWrite;
+	barrier.dstAccessMask = vk::AccessBits::vertexAttributeRead |
+		vk::AccessBits::indexRead |
+		vk::AccessBits::uniformRead |
+		vk::AccessBits::shaderRead;
+
+	auto dstStages = vk::PipelineStageBits::vertexInput |
+		vk::PipelineStageBits::vertexShader |
+		vk::PipelineStageBits::fragmentShader;
+	vk::cmdPipelineBarrier(cmdBuffer, vk::PipelineStageBits::transfer, dstStages, {},
+		{barrier}, {}, {});
+
+	// only the references must be kept now
+	for(auto& upload : frame.sceneUploads)
+		frame.uploadedScenes.push_back(std::move(upload.part));
+
+	frame.sceneUploads.clear();
+}
+
+void Renderer::start(unsigned int width, unsigned int height)
+{
+	// store (and set) viewport in some way
+	width_ = width;
+	height_ = height;
+
+	// wait until the slot can be written again, everything is written directly into it
+	auto& frame = currentFrame();
+	frame.uniforms.reset();
+	frame.vertices.reset();
+	frame.paints.clear();
+
+	if(profiler_) {
+		frame.stats = {};
+		frame.started = std::chrono::steady_clock::now();
+	}
+
+	drawDatas_.clear();
+	paths_.clear();
+	prepared_ = false;
+}
+
+void Renderer::cancel()
+{
+	// the data already written into the streams of the slot stays there until
+	// the next start
+	drawDatas_.clear();
+	paths_.clear();
+	drawCalls_.clear();
+	prepared_ = false;
+}
+
+void Renderer::flush()
+{
+	// shared contexts might create textures (and therefore use the frame slot) meanwhile.
+	// The slot was already acquired (and waited for) in start
+	std::unique_lock<std::recursive_mutex> lock(shared_->mutex);
+	auto& frame = currentFrame(lock);
+	auto flushStart = std::chrono::steady_clock::now();
+	appendDrawLists();
+	auto dirty = dirtyRegions();
+	if(drawDatas_.empty() && frame.scenes.empty() && !offscreen_ && !dirty)
+		return;
+
+	// the uniform and vertex data was already written into the mapped stream buffers
+	prepare();
+
+	// with dirty regions only what changed since the last frame is rendered. Frames
+	// without changes are skipped, their uploads stay queued until a frame is rendered
+	vk::Rect2D damage {};
+	if(dirty) {
+		damage = trackDamage(frame, swapchain_->size());
+		if(!damage.extent.width || !damage.extent.height) {
+			frame.scenes.clear();
+			cancel();
+			return;
+		}
+	}
+
+	//render
+	vk::Framebuffer fb;
+	vk::Extent2D size;
+	std::uint32_t imageID {};
+
+	if(swapchain_) {
+		// an out of date swapchain cannot be rendered on until it is recreated, the frame
+		// is discarded then. The pending uploads stay queued for the next flush
+		vk::Result result;
+		try {
+			result = vk::acquireNextImageKHR(device(), *swapchain_, UINT64_MAX,
+				frame.acquireSemaphore, {}, imageID);
+		} catch(const vk::VulkanError& error) {
+			if(error.error != vk::Result::errorOutOfDateKHR)
+				throw;
+
+			outOfDate_ = true;
+			frame.scenes.clear();
+			cancel();
+			return;
+		}
+
+		if(result == vk::Result::suboptimalKHR)
+			outOfDate_ = true;
+
+		fb = renderTargets_[imageID].framebuffer;
+		size = swapchain_->size();
+
+		// the acquired image might be some frames old, it needs the changes of all
+		// frames since then. Completely rendered if it is new or too old
+		if(dirty) {
+			auto number = submitted_ + 1;
+			damages_.push_back({number, damage});
+			if(damages_.size() > renderTargets_.size() + 1)
+				damages_.erase(damages_.begin());
+
+			auto& target = renderTargets_[imageID];
+			if(target.frame && damages_.front().first <= target.frame + 1) {
+				for(auto& entry : damages_)
+					if(entry.first > target.frame)
+						renderArea_ = unite(renderArea_, entry.second);
+
+				if(renderArea_.extent.width == size.width &&
+						renderArea_.extent.height == size.height)
+					renderArea_ = {};
+			}
+
+			target.frame = number;
+		}
+	} else if(offscreen_) {
+		fb = renderTargets_[frameIndex_].framebuffer;
+		size = offscreenSize_;
+	} else {
+		fb = *framebuffer_;
+		size = framebuffer_->size();
+	}
+
+	vk::beginCommandBuffer(frame.commandBuffer, {});
+	if(frame.timestamps) {
+		vk::cmdResetQueryPool(frame.commandBuffer, frame.timestamps, 0, 2);
+		vk::cmdWriteTimestamp(frame.commandBuffer, vk::PipelineStageBits::topOfPipe,
+			frame.timestamps, 0);
+	}
+
+	// texture uploads must happen outside of the render pass
+	recordUploads(frame.commandBuffer);
+
+	// when rendering into a framebuffer we cannot rely on the render pass to
+	// synchronize with the still running previous frames so do it manually
+	if(framebuffer_) {
+		vk::MemoryBarrier barrier;
+		barrier.srcAccessMask = vk::AccessBits::colorAttachmentWrite |
+			vk::AccessBits::depthStencilAttachmentWrite;
+		barrier.dstAccessMask = vk::AccessBits::colorAttachmentRead |
+			vk::AccessBits::colorAttachmentWrite |
+			vk::AccessBits::depthStencilAttachmentRead |
+			vk::AccessBits::depthStencilAttachmentWrite;
+
+		auto stages = vk::PipelineStageBits::colorAttachmentOutput |
+			vk::PipelineStageBits::earlyFragmentTests |
+			vk::PipelineStageBits::lateFragmentTests;
+		vk::cmdPipelineBarrier(frame.commandBuffer, stages, stages, {}, {barrier}, {}, {});
+	}
+
+	vk::ClearValue clearValues[2] {};
+	clearValues[0].color = {0.f, 0.f, 0.f, 1.0f};
+	clearValues[1].depthStencil = {1.f, 0};
+
+	// partial redraws keep the previous contents of the image outside the render area
+	auto partial = renderArea_.extent.width && renderArea_.extent.height;
+
+	vk::RenderPassBeginInfo beginInfo;
+	beginInfo.renderPass = partial ? vk::RenderPass(partialRenderPass_) : vkRenderPass();
+	beginInfo.renderArea = {{0, 0}, {size.width, size.height}};
+	if(partial)
+		beginInfo.renderArea = renderArea_;
+	beginInfo.clearValueCount = 2;
+	beginInfo.pClearValues = clearValues;
+	beginInfo.framebuffer = fb;
+
+	// scenes are replayed from their secondary command buffers. Inline and secondary
+	// commands cannot be mixed in one subpass, so then the draws of this frame are recorded
+	// into a secondary command buffer as well
+	// large frames are recorded in parallel into secondary command buffers as well
+	prepare();
+	auto parallel = workers_ && drawCalls_.size() >= 2 * minChunkCalls;
+
+	if(frame.scenes.empty() && !parallel) {
+		vk::cmdBeginRenderPass(frame.commandBuffer, beginInfo, vk::SubpassContents::eInline);
+		setViewport(frame.commandBuffer, size, renderArea_);
+		record(frame.commandBuffer);
+	} else {
+		vk::cmdBeginRenderPass(frame.commandBuffer, beginInfo,
+			vk::SubpassContents::secondaryCommandBuffers);
+
+		std::vector<vk::CommandBuffer> cmdBuffers;
+		for(auto& part : frame.scenes)
+			cmdBuffers.push_back(part->commandBuffer);
+
+		if(parallel) {
+			std::vector<vk::CommandBuffer> secondaries;
+			for(auto& cmdBuffer : frame.recordBuffers)
+				secondaries.push_back(cmdBuffer);
+
+			auto used = record(secondaries, fb, size);
+			cmdBuffers.insert(cmdBuffers.end(), secondaries.begin(), secondaries.begin() + used);
+		} else if(!drawCalls_.empty()) {
+			if(!frame.secondaryCommandBuffer)
+				frame.secondaryCommandBuffer = device().commandProvider().get(
+					renderQueue_->family(), {}, vk::CommandBufferLevel::secondary);
+
+			auto& secondary = frame.secondaryCommandBuffer;
+			beginSecondary(secondary, vkRenderPass(), fb,
+				vk::CommandBufferUsageBits::oneTimeSubmit);
+			setViewport(secondary, size, renderArea_);
+			record(secondary);
+			vk::endCommandBuffer(secondary);
+			cmdBuffers.push_back(secondary);
+		}
+
+		vk::cmdExecuteCommands(frame.commandBuffer, cmdBuffers);
+	}
+
+	vk::cmdEndRenderPass(frame.commandBuffer);
+
+	// copy the rendered image into the mapped readback buffer of the frame slot,
+	// the render pass already transitioned it (see initRenderPass)
+	if(offscreen_) {
+		vk::BufferImageCopy region;
+		region.imageSubresource = {vk::ImageAspectBits::color, 0, 0, 1};
+		region.imageExtent = {size.width, size.height, 1};
+		vk::cmdCopyImageToBuffer(frame.commandBuffer, renderTargets_[frameIndex_].image,
+			vk::ImageLayout::transferSrcOptimal, frame.readback.buffer(), {region});
+
+		vk::MemoryBarrier barrier;
+		barrier.srcAccessMask = vk::AccessBits::transferWrite;
+		barrier.dstAccessMask = vk::AccessBits::hostRead;
+		vk::cmdPipelineBarrier(frame.commandBuffer, vk::PipelineStageBits::transfer,
+			vk::PipelineStageBits::host, {}, {barrier}, {}, {});
+	}
+
+	if(frame.timestamps)
+		vk::cmdWriteTimestamp(frame.commandBuffer, vk::PipelineStageBits::bottomOfPipe,
+			frame.timestamps, 1);
+
+	vk::endCommandBuffer(frame.commandBuffer);
+
+	// submit
+	std::vector<vk::Semaphore> waitSemaphores;
+	std::vector<vk::PipelineStageFlags> waitStages;
+	vk::CommandBuffer cmdBuf = frame.commandBuffer;
+	vk::Semaphore renderSemaphore = frame.renderSemaphore;
+
+	// the textures created this frame are uploaded on the transfer queue.
+	// Updates of them in the same frame are copied on this queue and expect the initial
+	// upload and its layout transition to be finished, so the transfers wait as well
+	if(submitTransferUploads(frame)) {
+		waitSemaphores.push_back(frame.uploadSemaphore);
+		waitStages.push_back(vk::PipelineStageBits::transfer |
+			vk::PipelineStageBits::fragmentShader);
+	}
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmdBuf;
+
+	if(swapchain_) {
+		waitSemaphores.push_back(frame.acquireSemaphore);
+		waitStages.push_back(vk::PipelineStageBits::colorAttachmentOutput);
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &renderSemaphore;
+	}
+
+	submitInfo.waitSemaphoreCount = waitSemaphores.size();
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+
+	vk::resetFences(device(), {frame.fence});
+	vk::queueSubmit(renderQueue_->vkHandle(), {submitInfo}, frame.fence);
+	frame.pending = true;
+	frame.number = ++submitted_;
+
+	// the device time is known when the frame has finished, see waitFrame
+	if(profiler_) {
+		using Milliseconds = std::chrono::duration<double, std::milli>;
+		auto now = std::chrono::steady_clock::now();
+
+		auto& stats = frame.stats;
+		stats.frame = frame.number;
+		stats.draws = drawDatas_.size();
+		stats.drawCalls = drawCalls_.size();
+		stats.vertexBytes = frame.vertices.offset();
+		stats.indexBytes = frame.indices.offset();
+		stats.uniformBytes = frame.uniforms.offset();
+		stats.uploadBytes = frame.staging.offset();
+		stats.buildTime = Milliseconds(flushStart - frame.started).count();
+		stats.flushTime = Milliseconds(now - flushStart).count();
+	}
+
+	// present
+	if(swapchain_) {
+		vk::SwapchainKHR vkSwapchain = *swapchain_;
+
+		vk::PresentInfoKHR presentInfo;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = &renderSemaphore;
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = &vkSwapchain;
+		presentInfo.pImageIndices = &imageID;
+
+		// only the region that changed since the last present
+		vk::RectLayerKHR presentRect;
+		vk::PresentRegionKHR presentRegion;
+		vk::PresentRegionsKHR presentRegions;
+		if(dirty && settings_.incrementalPresent) {
+			presentRect.offset = damage.offset;
+			presentRect.extent = damage.extent;
+			presentRegion.rectangleCount = 1;
+			presentRegion.pRectangles = &presentRect;
+			presentRegions.swapchainCount = 1;
+			presentRegions.pRegions = &presentRegion;
+			presentInfo.pNext = &presentRegions;
+		}
+
+		// the frame was submitted anyways, so only remember that a resize is needed
+		try {
+			auto result = vk::queuePresentKHR(presentQueue_->vkHandle(), presentInfo);
+			if(result == vk::Result::suboptimalKHR)
+				outOfDate_ = true;
+		} catch(const vk::VulkanError& error) {
+			if(error.error != vk::Result::errorOutOfDateKHR)
+				throw;
+
+			outOfDate_ = true;
+		}
+	}
+
+	// the next frame uses the next slot
+	frameIndex_ = (frameIndex_ + 1) % frames_.size();
+
+	//cleanup
+	drawDatas_.clear();
+	paths_.clear();
+	drawCalls_.clear();
+	prepared_ = false;
+	renderArea_ = {};
+}
+
+void Renderer::prepare()
+{
+	if(prepared_)
+		return;
+
+	std::lock_guard<std::recursive_mutex> lock(shared_->mutex);
+
+	auto& frame = frames_[frameIndex_];
+	updateDescriptors(frame);
+	batch(frame);
+	prepared_ = true;
+}
+
+namespace {
+
+std::size_t fanIndexCount(std::size_t count) { return count < 3 ? 0 : (count - 2) * 3; }
+std::size_t stripIndexCount(std::size_t count) { return count < 3 ? 0 : (count - 2) * 3; }
+
+std::uint32_t* writeFan(std::uint32_t* out, std::size_t first, std::size_t count)
+{
+	for(auto i = 1u; i + 1 < count; ++i) {
+		*(out++) = first;
+		*(out++) = first + i;
+		*(out++) = first + i + 1;
+	}
+
+	return out;
+}
+
+std::uint32_t* writeStrip(std::uint32_t* out, std::size_t first, std::size_t count)
+{
+	// culling is disabled so the winding does not matter
+	for(auto i = 0u; i + 2 < count; ++i) {
+		*(out++) = first + i;
+		*(out++) = first + i + 1;
+		*(out++) = first + i + 2;
+	}
+
+	return out;
+}
+
+std::uint32_t* writeList(std::uint32_t* out, std::size_t first, std::size_t count)
+{
+	for(auto i = 0u; i < count; ++i)
+		*(out++) = first + i;
+
+	return out;
+}
+
+} // anonymous util namespace
+
+void Renderer::batch(Frame& frame)
+{
+	drawCalls_.clear();
+	frame.indices.reset();
+
+	// allocates count indices and returns where to write them
+	auto first = std::size_t(0);
+	auto allocate = [&](std::size_t count) {
+		auto offset = frame.indices.allocate(count * sizeof(std::uint32_t),
+			sizeof(std::uint32_t));
+		first = offset / sizeof(std::uint32_t);
+		return reinterpret_cast<std::uint32_t*>(frame.indices.data(offset));
+	};
+
+	// adds a draw call for the last allocation.
+	// Only plain lists and shapes are merged, stencil fills must be resolved one by one.
+	// Shapes select storage paints per instance so their paints don't have to match.
+	auto add = [&](PipelineType pipeline, const DrawData& data, std::size_t count) {
+		auto set = frame.descriptorSets.find(data.texture)->second.vkHandle();
+		auto uniformOffset = std::uint32_t(data.uniformOffset);
+		if(pipeline == PipelineType::shape && settings_.storagePaints)
+			uniformOffset = 0u;
+
+		auto vkPipeline = pipelineVariant(pipeline, data.variant);
+		auto merge = (pipeline == PipelineType::list || pipeline == PipelineType::shape);
+		if(merge && !drawCalls_.empty()) {
+			auto& prev = drawCalls_.back();
+			if(prev.pipeline == pipeline && prev.vkPipeline == vkPipeline &&
+					prev.descriptorSet == set &&
+					prev.uniformOffset == uniformOffset &&
+					prev.firstIndex + prev.indexCount == first) {
+				prev.indexCount += count;
+				return;
+			}
+		}
+
+		drawCalls_.push_back({pipeline, data.texture, set, uniformOffset,
+			std::uint32_t(first), std::uint32_t(count), vkPipeline});
+	};
+
+	for(auto& data : drawDatas_) {
+		if(data.shapeCount) {
+			first = data.shapeOffset;
+			add(PipelineType::shape, data, data.shapeCount);
+			continue;
+		}
+
+		if(data.stencilFill) {
+			auto fillCount = std::size_t(0);
+			auto strokeCount = std::size_t(0);
+			for(auto& path : drawPaths(paths_, data)) {
+				fillCount += fanIndexCount(path.fillCount);
+				strokeCount += stripIndexCount(path.strokeCount);
+			}
+
+			if(fillCount == 0)
+				continue;
+
+			auto* indices = allocate(fillCount);
+			for(auto& path : drawPaths(paths_, data))
+				indices = writeFan(indices, path.fillOffset, path.fillCount);
+			add(PipelineType::fillStencil, data, fillCount);
+
+			if(strokeCount > 0) {
+				indices = allocate(strokeCount);
+				for(auto& path : drawPaths(paths_, data))
+					indices = writeStrip(indices, path.strokeOffset, path.strokeCount);
+				add(PipelineType::fillFringe, data, strokeCount);
+			}
+
+			indices = allocate(6);
+			indices = writeStrip(indices, data.coverOffset, 4);
+			add(PipelineType::fillCover, data, 6);
+			continue;
+		}
 
-	if(uniformBuffer_.memorySize() < uniformSize) {
-		vk::BufferCreateInfo bufInfo;
-		bufInfo.usage = vk::BufferUsageBits::uniformBuffer;
-		bufInfo.size = uniformSize;
-		uniformBuffer_ = {device(), bufInfo, bits};
+		auto count = std::size_t(0);
+		for(auto& path : drawPaths(paths_, data))
+			count += fanIndexCount(path.fillCount) + stripIndexCount(path.strokeCount);
+		count += data.triangleCount;
+
+		if(count == 0)
+			continue;
+
+		auto* indices = allocate(count);
+		for(auto& path : drawPaths(paths_, data)) {
+			indices = writeFan(indices, path.fillOffset, path.fillCount);
+			indices = writeStrip(indices, path.strokeOffset, path.strokeCount);
+		}
+
+		writeList(indices, data.triangleOffset, data.triangleCount);
+		add(PipelineType::list, data, count);
+	}
+}
+
+void Renderer::updateDescriptors(Frame& frame)
+{
+	// the sets reference the uniform buffer which might have been recreated
+	if(frame.descriptorGeneration != frame.uniforms.generation()) {
+		frame.descriptorSets.clear();
+		frame.descriptorGeneration = frame.uniforms.generation();
+	}
+
+	// first find all textures that do not have a set yet, the pool must only
+	// be reset or recreated before any set of this frame is retrieved
+	std::vector<unsigned int> missing;
+	for(auto& data : drawDatas_) {
+		if(frame.descriptorSets.find(data.texture) == frame.descriptorSets.end() &&
+				std::find(missing.begin(), missing.end(), data.texture) == missing.end())
+			missing.push_back(data.texture);
+	}
+
+	if(missing.empty())
+		return;
+
+	if(frame.descriptorCount + missing.size() > frame.descriptorPoolSize) {
+		// sets of deleted textures are never freed, so the cached ones are
+		// dropped and only those which are still needed recreated
+		auto needed = frame.descriptorSets.size() + missing.size();
+		if(needed > frame.descriptorPoolSize / 2 || !frame.descriptorPool) {
+			auto size = std::max<unsigned int>(needed * 2, 16u);
+
+			vk::DescriptorPoolSize typeCounts[3];
+			typeCounts[0].type = vk::DescriptorType::uniformBufferDynamic;
+			typeCounts[0].descriptorCount = size;
+
+			typeCounts[1].type = vk::DescriptorType::combinedImageSampler;
+			typeCounts[1].descriptorCount = size;
+
+			typeCounts[2].type = vk::DescriptorType::storageBuffer;
+			typeCounts[2].descriptorCount = size;
+
+			vk::DescriptorPoolCreateInfo poolInfo;
+			poolInfo.poolSizeCount = 3;
+			poolInfo.pPoolSizes = typeCounts;
+			poolInfo.maxSets = size;
+
+			frame.descriptorPool = {device(), poolInfo};
+			frame.descriptorPoolSize = size;
+		} else {
+			vk::resetDescriptorPool(device(), frame.descriptorPool, {});
+		}
+
+		for(auto& entry : frame.descriptorSets)
+			if(std::find(missing.begin(), missing.end(), entry.first) == missing.end())
+				missing.push_back(entry.first);
+
+		frame.descriptorSets.clear();
+		frame.descriptorCount = 0;
+	}
+
+	for(auto id : missing) {
+		auto& set = frame.descriptorSets[id];
+		set = {descriptorLayout_, frame.descriptorPool};
+		++frame.descriptorCount;
+		++frame.stats.descriptorSets;
+
+		vpp::DescriptorSetUpdate descUpdate(set);
+		descUpdate.uniform({{frame.uniforms.buffer(), 0, sizeof(UniformData)}},
+			-1, vk::DescriptorType::uniformBufferDynamic);
+
+		// the draw lists of shared contexts might still use textures that were deleted
+		// after they were ended, those are drawn with the dummy texture
+		vk::ImageView iv = dummyTexture_.viewableImage().vkImageView();
+		vk::Sampler sampler = sampler_;
+		dlg_assert(iv);
+		if(auto* tex = id ? texture(id) : nullptr) {
+			iv = tex->viewableImage().vkImageView();
+			sampler = textureSampler(tex->flags());
+		}
+
+		auto layout = vk::ImageLayout::shaderReadOnlyOptimal;
+		descUpdate.imageSampler({{sampler, iv, layout}});
+		descUpdate.storage({{frame.uniforms.buffer(), 0, frame.uniforms.size()}});
+
+		descUpdate.apply();
+	}
+}
+
+namespace {
+
+// Adds the given fill paths to the given DrawData using the given function that writes
+// vertices and returns the index of the first one.
+template<typename F>
+void buildFill(DrawData& drawData, std::vector<Path>& dst, const float* bounds,
+	nytl::Span<const NVGpath> paths, bool stencilFills, bool edgeAA, F&& writeVertices)
+{
+	drawData.pathOffset = dst.size();
+	drawData.pathCount = paths.size();
+
+	// convex paths can be drawn directly as fans, everything else needs the stencil
+	auto convex = paths.size() == 1 && paths[0].convex;
+	if(stencilFills && !convex) {
+		NVGvertex quad[4] = {
+			{bounds[0], bounds[3], 0.5f, 1.0f},
+			{bounds[2], bounds[3], 0.5f, 1.0f},
+			{bounds[0], bounds[1], 0.5f, 1.0f},
+			{bounds[2], bounds[1], 0.5f, 1.0f},
+		};
+
+		drawData.stencilFill = true;
+		drawData.coverOffset = writeVertices(nytl::Span<const NVGvertex>{quad, 4});
+	}
+
+	for(auto& path : paths)
+	{
+		auto verts = nytl::Span<const NVGvertex>{path.fill, std::size_t(path.nfill)};
+		dst.emplace_back();
+		dst.back().fillOffset = writeVertices(verts);
+		dst.back().fillCount = path.nfill;
+
+		if(edgeAA && path.nstroke > 0)
+		{
+			auto stroke = nytl::Span<const NVGvertex>{path.stroke, std::size_t(path.nstroke)};
+			dst.back().strokeOffset = writeVertices(stroke);
+			dst.back().strokeCount = path.nstroke;
+		}
+	}
+}
+
+// Chooses the origin of the compact vertices inside the given bounds (min x, min y,
+// max x, max y). Prefers the center of the view with the finest step since most draws
+// can then use it and the equal paints can be batched.
+VertexOrigin vertexOrigin(const float* bounds, Vec2 viewSize)
+{
+	constexpr auto range = float(std::numeric_limits<std::int16_t>::max());
+	auto fits = [&](const VertexOrigin& o) {
+		return std::max({o.origin.x - bounds[0], bounds[2] - o.origin.x,
+			o.origin.y - bounds[1], bounds[3] - o.origin.y}) <= range * o.step;
+	};
+
+	VertexOrigin ret {{std::round(viewSize.x / 2), std::round(viewSize.y / 2)}, compactStep};
+	if(bounds[0] > bounds[2] || fits(ret))
+		return ret;
+
+	// coarser steps for huge draws, stops at a size nothing could need
+	ret.origin = {std::round((bounds[0] + bounds[2]) / 2), std::round((bounds[1] + bounds[3]) / 2)};
+	while(!fits(ret) && ret.step < 65536.f)
+		ret.step *= 2;
+
+	return ret;
+}
+
+// Extends the given bounds (min x, min y, max x, max y) to include the given vertices.
+void addBounds(float* bounds, nytl::Span<const NVGvertex> verts)
+{
+	for(auto& vert : verts) {
+		bounds[0] = std::min(bounds[0], vert.x);
+		bounds[1] = std::min(bounds[1], vert.y);
+		bounds[2] = std::max(bounds[2], vert.x);
+		bounds[3] = std::max(bounds[3], vert.y);
+	}
+}
+
+// Returns the bounds of all vertices of the given paths. The given fill bounds (may be null)
+// are included since the stencil cover quad is made from them.
+std::array<float, 4> pathBounds(nytl::Span<const NVGpath> paths, const float* fillBounds)
+{
+	constexpr auto inf = std::numeric_limits<float>::infinity();
+	std::array<float, 4> bounds = {inf, inf, -inf, -inf};
+	if(fillBounds)
+		std::copy(fillBounds, fillBounds + 4, bounds.begin());
+
+	for(auto& path : paths) {
+		addBounds(bounds.data(), {path.fill, std::size_t(path.nfill)});
+		addBounds(bounds.data(), {path.stroke, std::size_t(path.nstroke)});
+	}
+
+	return bounds;
+}
+
+// Stores the given vertices relative to the given origin.
+void compactVertices(nytl::Span<const NVGvertex> verts, const VertexOrigin& origin,
+	CompactVertex* dst)
+{
+	constexpr auto range = float(std::numeric_limits<std::int16_t>::max());
+	auto inv = 1.f / origin.step;
+	auto fixed = [&](float val, float o) {
+		return std::int16_t(std::max(-range, std::min(std::round((val - o) * inv), range)));
+	};
+	auto unorm = [](float val) {
+		return std::uint16_t(std::max(0.f, std::min(val, 1.f)) * 65535.f + 0.5f);
+	};
+
+	for(auto& vert : verts) {
+		auto u = origin.uvOffset.x + vert.u * origin.uvScale.x;
+		auto v = origin.uvOffset.y + vert.v * origin.uvScale.y;
+		*dst++ = {fixed(vert.x, origin.origin.x), fixed(vert.y, origin.origin.y),
+			unorm(u), unorm(v)};
+	}
+}
+
+// Whether the texture coordinates of the draw have to be mapped into an atlas region.
+bool remapped(const VertexOrigin& origin)
+{
+	return origin.uvScale.x != 1.f || origin.uvScale.y != 1.f ||
+		origin.uvOffset.x != 0.f || origin.uvOffset.y != 0.f;
+}
+
+// Stores the given vertices with the texture coordinates mapped into the atlas region.
+void remapVertices(nytl::Span<const NVGvertex> verts, const VertexOrigin& origin,
+	NVGvertex* dst)
+{
+	for(auto& vert : verts) {
+		*dst++ = {vert.x, vert.y, origin.uvOffset.x + vert.u * origin.uvScale.x,
+			origin.uvOffset.y + vert.v * origin.uvScale.y};
+	}
+}
+
+// Returns the texture of the draw: the page for atlas textures, whose region the
+// texture coordinates are then mapped into. Also flips them for NVG_IMAGE_FLIPY.
+// The mapping is applied to the pattern coordinates by the shader and to the vertex
+// texture coordinates of triangles, see paintUniforms.
+unsigned int textureRemap(const Renderer& renderer, const Texture& tex, VertexOrigin& origin)
+{
+	auto id = tex.id();
+	if(tex.page()) {
+		auto& page = *renderer.texture(tex.page());
+		auto& region = tex.region();
+		origin.uvOffset = {float(region.offset.x) / page.width(),
+			float(region.offset.y) / page.height()};
+		origin.uvScale = {float(region.extent.width) / page.width(),
+			float(region.extent.height) / page.height()};
+		id = page.id();
+	}
+
+	if(tex.flags() & NVG_IMAGE_FLIPY) {
+		origin.uvOffset.y += origin.uvScale.y;
+		origin.uvScale.y = -origin.uvScale.y;
+	}
+
+	return id;
+}
+
+template<typename F>
+void buildStroke(DrawData& drawData, std::vector<Path>& dst, nytl::Span<const NVGpath> paths,
+	F&& writeVertices)
+{
+	drawData.pathOffset = dst.size();
+	drawData.pathCount = paths.size();
+	for(auto& path : paths)
+	{
+		auto verts = nytl::Span<const NVGvertex>{path.stroke, std::size_t(path.nstroke)};
+		dst.emplace_back();
+		dst.back().strokeOffset = writeVertices(verts);
+		dst.back().strokeCount = path.nstroke;
+	}
+}
+
+// Computes the shader paint parameters. The texture may be null.
+// With vertexTexCoords, textures are sampled at the texture coordinates of the vertices
+// instead of in the pattern space of the paint.
+UniformData paintUniforms(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+	float strokeWidth, Vec2 viewSize, const Texture* tex, const VertexOrigin& origin,
+	bool vertexTexCoords)
+{
+	UniformData uniformData;
+	uniformData.viewSize = viewSize;
+
+	if(paint.image) {
+		auto alpha = tex && tex->format() == vk::Format::r8Unorm;
+		auto sdf = tex && tex->format() == vk::Format::r8Snorm;
+		auto premultiplied = tex && (tex->flags() & NVG_IMAGE_PREMULTIPLIED);
+		uniformData.type = typeTexture;
+		uniformData.texType = sdf ? texTypeSDF : alpha ? texTypeA :
+			premultiplied ? texTypePremultiplied : texTypeRGBA;
+	} else if(std::memcmp(&paint.innerColor, &paint.outerColor, sizeof(paint.innerColor)) == 0) {
+		uniformData.type = typeColor;
+		uniformData.texType = 0u;
+	} else {
+		uniformData.type = typeGradient;
+		uniformData.texType = 0u;
+	}
+
+	//colors
+	std::memcpy(&uniformData.innerColor, &paint.innerColor, sizeof(float) * 4);
+	std::memcpy(&uniformData.outerColor, &paint.outerColor, sizeof(float) * 4);
+
+	//mats
+	float invxform[6];
+
+	//scissor
+	float scissorMat[4][4] {};
+	if (scissor.extent[0] < -0.5f || scissor.extent[1] < -0.5f) {
+		scissorMat[3][0] = 1.0f;
+		scissorMat[3][1] = 1.0f;
+		scissorMat[3][2] = 1.0f;
+		scissorMat[3][3] = 1.0f;
+	} else {
+		nvgTransformInverse(invxform, scissor.xform);
+
+		scissorMat[0][0] = invxform[0];
+		scissorMat[0][1] = invxform[1];
+		scissorMat[1][0] = invxform[2];
+		scissorMat[1][1] = invxform[3];
+		scissorMat[2][0] = invxform[4];
+		scissorMat[2][1] = invxform[5];
+		scissorMat[2][2] = 1.0f;
+
+		//extent
+		scissorMat[3][0] = scissor.extent[0];
+		scissorMat[3][1] = scissor.extent[1];
+
+		//scale
+		scissorMat[3][2] = std::sqrt(scissor.xform[0]*scissor.xform[0] + scissor.xform[2]*
+			scissor.xform[2]) / fringe;
+		scissorMat[3][3] = std::sqrt(scissor.xform[1]*scissor.xform[1] + scissor.xform[3]*
+			scissor.xform[3]) / fringe;
+	}
+
+	scissorMat[0][3] = paint.radius;
+	scissorMat[1][3] = paint.feather;
+	scissorMat[2][3] = strokeWidth;
+
+	std::memcpy(&uniformData.scissorMat, &scissorMat, sizeof(scissorMat));
+
+	//paint
+	//triangles (text) sample textures at the texture coordinates of the vertices, which
+	//are already mapped into the atlas region. Without the paint transform all their draws
+	//of one texture (or atlas page) with the same color share the paint
+	float paintMat[4][4] {};
+	paintMat[2][2] = 1.0f;
+	if(paint.image && vertexTexCoords) {
+		paintMat[2][3] = 1.0f;
+		uniformData.outerColor = {0.f, 0.f, 1.f, 1.f};
+	} else {
+		//fills and strokes sample in pattern space like gradients, the outer color
+		//holds the mapping into the atlas region (offset, scale)
+		if(paint.image) {
+			uniformData.outerColor = {origin.uvOffset.x, origin.uvOffset.y,
+				origin.uvScale.x, origin.uvScale.y};
+		}
+
+		nvgTransformInverse(invxform, paint.xform);
+		paintMat[0][0] = invxform[0];
+		paintMat[0][1] = invxform[1];
+		paintMat[1][0] = invxform[2];
+		paintMat[1][1] = invxform[3];
+		paintMat[2][0] = invxform[4];
+		paintMat[2][1] = invxform[5];
+
+		paintMat[3][0] = paint.extent[0];
+		paintMat[3][1] = paint.extent[1];
+	}
+
+	//strokeMult
+	paintMat[0][3] = (strokeWidth * 0.5f + fringe * 0.5f) / fringe;
+
+	//compact vertex origin and step
+	paintMat[3][2] = origin.origin.x;
+	paintMat[3][3] = origin.origin.y;
+	paintMat[1][3] = origin.step;
+
+	std::memcpy(&uniformData.paintMat, &paintMat, sizeof(paintMat));
+	return uniformData;
+}
+
+// Returns the pipeline paint variant for the given paint parameters.
+std::uint8_t paintVariant(const UniformData& data, const NVGscissor& scissor)
+{
+	auto scissored = scissor.extent[0] >= -0.5f && scissor.extent[1] >= -0.5f;
+	return paintBits(data.type, data.texType) | (scissored ? variantScissor : 0u);
+}
+
+// Writes the given paint directly into the mapped uniform buffer of the frame if it was
+// not already written this frame and returns its offset.
+std::size_t writePaint(Frame& frame, const UniformData& uniformData, std::size_t alignment)
+{
+	auto it = frame.paints.find(uniformData);
+	if(it != frame.paints.end())
+		return it->second;
+
+	auto offset = frame.uniforms.write(&uniformData, sizeof(uniformData), alignment);
+	frame.paints.emplace(uniformData, offset);
+	return offset;
+}
+
+// Returns the shape instance for the given shape, the paint index is set separately.
+ShapeInstance shapeInstance(const NVGshape& shape, float fringe)
+{
+	ShapeInstance instance {};
+	auto& t = shape.xform;
+	nvgTransformPoint(&instance.rect.x, &instance.rect.y, t, shape.center[0], shape.center[1]);
+	instance.rect.z = shape.extent[0];
+	instance.rect.w = shape.extent[1];
+	instance.xform = {t[0], t[1], t[2], t[3]};
+	instance.params = {shape.radius, fringe};
+	return instance;
+}
+
+// Returns whether the given bounds (in view coordinates, expanded by the given margin)
+// are completely outside of the view or the scissor rect, i.e. the draw is not visible.
+bool culled(const float* bounds, float margin, const NVGscissor& scissor, Vec2 viewSize)
+{
+	auto x0 = bounds[0] - margin;
+	auto y0 = bounds[1] - margin;
+	auto x1 = bounds[2] + margin;
+	auto y1 = bounds[3] + margin;
+	if(x1 < 0.f || y1 < 0.f || x0 > viewSize.x || y0 > viewSize.y)
+		return true;
+
+	// a negative extent means no scissor, see paintVariant
+	if(scissor.extent[0] < -0.5f || scissor.extent[1] < -0.5f)
+		return false;
+
+	// the scissor transform maps the scissor rect centered around the origin to the view
+	auto& t = scissor.xform;
+	auto hw = std::abs(t[0]) * scissor.extent[0] + std::abs(t[2]) * scissor.extent[1];
+	auto hh = std::abs(t[1]) * scissor.extent[0] + std::abs(t[3]) * scissor.extent[1];
+	return x1 < t[4] - hw || x0 > t[4] + hw || y1 < t[5] - hh || y0 > t[5] + hh;
+}
+
+// Returns the screen space bounds of the given shape instance.
+std::array<float, 4> shapeBounds(const ShapeInstance& shape)
+{
+	auto& s = shape;
+	auto hw = std::abs(s.xform.x) * s.rect.z + std::abs(s.xform.z) * s.rect.w + s.params.y;
+	auto hh = std::abs(s.xform.y) * s.rect.z + std::abs(s.xform.w) * s.rect.w + s.params.y;
+	return {s.rect.x - hw, s.rect.y - hh, s.rect.x + hw, s.rect.y + hh};
+}
+
+} // anonymous util namespace
+
+void Renderer::fill(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+	const float* bounds, nytl::Span<const NVGpath> paths)
+{
+	// the fill bounds contain all points, the fringe is at most fringe wide
+	Vec2 viewSize = {float(width_), float(height_)};
+	if(culled(bounds, fringe, scissor, viewSize))
+		return;
+
+	std::array<float, 4> drawBounds {};
+	if(settings_.compactVertices || settings_.dirtyRegions)
+		drawBounds = pathBounds(paths, bounds);
+
+	VertexOrigin origin;
+	if(settings_.compactVertices)
+		origin = vertexOrigin(drawBounds.data(), viewSize);
+
+	auto& drawData = parsePaint(paint, scissor, fringe, fringe, origin);
+	if(settings_.dirtyRegions)
+		drawData.bounds = drawBounds;
+
+	buildFill(drawData, paths_, bounds, paths, settings_.stencilFills, edgeAA_,
+		[&](nytl::Span<const NVGvertex> verts) { return writeVertices(verts, origin); });
+}
+void Renderer::stroke(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+	float strokeWidth, nytl::Span<const NVGpath> paths)
+{
+	// the stroke vertices already include the stroke width and fringe
+	Vec2 viewSize = {float(width_), float(height_)};
+	auto drawBounds = pathBounds(paths, nullptr);
+	if(culled(drawBounds.data(), 1.f, scissor, viewSize))
+		return;
+
+	VertexOrigin origin;
+	if(settings_.compactVertices)
+		origin = vertexOrigin(drawBounds.data(), viewSize);
+
+	auto& drawData = parsePaint(paint, scissor, fringe, strokeWidth, origin);
+	if(settings_.dirtyRegions)
+		drawData.bounds = drawBounds;
+
+	buildStroke(drawData, paths_, paths,
+		[&](nytl::Span<const NVGvertex> verts) { return writeVertices(verts, origin); });
+}
+void Renderer::triangles(const NVGpaint& paint, const NVGscissor& scissor,
+	nytl::Span<const NVGvertex> verts)
+{
+	Vec2 viewSize = {float(width_), float(height_)};
+	auto bounds = pathBounds({}, nullptr);
+	addBounds(bounds.data(), verts);
+	if(culled(bounds.data(), 1.f, scissor, viewSize))
+		return;
+
+	VertexOrigin origin;
+	if(settings_.compactVertices)
+		origin = vertexOrigin(bounds.data(), viewSize);
+
+	auto& drawData = parsePaint(paint, scissor, 1.f, 1.f, origin, true);
+	if(settings_.dirtyRegions)
+		drawData.bounds = bounds;
+
+	drawData.triangleOffset = writeVertices(verts, origin);
+	drawData.triangleCount = verts.size();
+}
+bool Renderer::fillShape(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+	const NVGshape& shape)
+{
+	// image patterns need texture coordinates, which shapes don't have
+	if(paint.image)
+		return false;
+
+	// invisible shapes count as drawn
+	auto instance = shapeInstance(shape, fringe);
+	auto bounds = shapeBounds(instance);
+	if(culled(bounds.data(), 1.f, scissor, {float(width_), float(height_)}))
+		return true;
+
+	VertexOrigin origin;
+	auto& drawData = parsePaint(paint, scissor, fringe, fringe, origin);
+	if(settings_.storagePaints)
+		instance.paint = drawData.uniformOffset / sizeof(UniformData);
+	if(settings_.dirtyRegions)
+		drawData.bounds = bounds;
+
+	auto size = sizeof(ShapeInstance);
+	drawData.shapeOffset = frames_[frameIndex_].vertices.write(&instance, size, size) / size;
+	drawData.shapeCount = 1;
+	return true;
+}
+
+std::size_t Renderer::vertexSize() const
+{
+	return settings_.compactVertices ? sizeof(CompactVertex) : sizeof(NVGvertex);
+}
+
+std::size_t Renderer::writeVertices(nytl::Span<const NVGvertex> verts,
+	const VertexOrigin& origin)
+{
+	if(!settings_.compactVertices && !remapped(origin))
+		return writeVertexData(verts.data(), verts.size());
+
+	if(!settings_.compactVertices) {
+		auto& vertices = frames_[frameIndex_].vertices;
+		auto size = sizeof(NVGvertex);
+		auto offset = vertices.allocate(verts.size() * size, size);
+		remapVertices(verts, origin, reinterpret_cast<NVGvertex*>(vertices.data(offset)));
+		return offset / size;
+	}
+
+	// encode directly into the mapped buffer
+	auto& vertices = frames_[frameIndex_].vertices;
+	auto size = sizeof(CompactVertex);
+	auto offset = vertices.allocate(verts.size() * size, size);
+	compactVertices(verts, origin, reinterpret_cast<CompactVertex*>(vertices.data(offset)));
+	return offset / size;
+}
+
+std::size_t Renderer::writeVertexData(const void* data, std::size_t count)
+{
+	auto& vertices = frames_[frameIndex_].vertices;
+	auto size = vertexSize();
+	return vertices.write(data, count * size, size) / size;
+}
+
+DrawData& Renderer::parsePaint(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+	float strokeWidth, VertexOrigin& origin, bool vertexTexCoords)
+{
+	drawDatas_.emplace_back();
+
+	auto& data = drawDatas_.back();
+	prepared_ = false;
+
+	const Texture* tex = nullptr;
+	std::unique_lock<std::recursive_mutex> lock(shared_->mutex, std::defer_lock);
+	if(paint.image) {
+		lock.lock();
+		tex = texture(paint.image);
+		data.texture = tex ? textureRemap(*this, *tex, origin) : paint.image;
+	}
+
+	Vec2 viewSize = {float(width_), float(height_)};
+	auto uniformData = paintUniforms(paint, scissor, fringe, strokeWidth, viewSize, tex, origin,
+		vertexTexCoords);
+	data.variant = paintVariant(uniformData, scissor);
+
+	// the vertex texture coordinates of fills and strokes are only used for the
+	// antialiasing, the shader maps the pattern coordinates
+	if(!vertexTexCoords) {
+		origin.uvOffset = {0.f, 0.f};
+		origin.uvScale = {1.f, 1.f};
+	}
+
+	// when using storage paints they are tightly packed so the offset can be used as index
+	auto alignment = settings_.storagePaints ? sizeof(UniformData) : uniformAlignment_;
+	data.uniformOffset = writePaint(frames_[frameIndex_], uniformData, alignment);
+	return data;
+}
+
+void Renderer::appendDrawLists()
+{
+	auto node = shared_->submissions.exchange(nullptr, std::memory_order_acquire);
+	if(!node)
+		return;
+
+	std::vector<std::unique_ptr<DrawListData>> lists;
+	for(; node; node = node->next)
+		lists.emplace_back(node);
+
+	// deterministic order independent from the thread timing of the submissions
+	std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) {
+		return (a->order != b->order) ? a->order < b->order : a->sequence < b->sequence;
+	});
+
+	auto& frame = frames_[frameIndex_];
+	auto alignment = settings_.storagePaints ? sizeof(UniformData) : uniformAlignment_;
+	for(auto& list : lists) {
+		auto base = settings_.compactVertices ?
+			writeVertexData(list->compactVertices.data(), list->compactVertices.size()) :
+			writeVertexData(list->vertices.data(), list->vertices.size());
+
+		// the paint indices of the shapes are patched in the stream below
+		auto shapeSize = sizeof(ShapeInstance);
+		auto shapeBase = frame.vertices.write(list->shapes.data(),
+			list->shapes.size() * shapeSize, shapeSize) / shapeSize;
+		auto shapes = reinterpret_cast<ShapeInstance*>(frame.vertices.data(shapeBase * shapeSize));
+
+		auto pathBase = paths_.size();
+		for(auto path : list->paths) {
+			path.fillOffset += base;
+			path.strokeOffset += base;
+			paths_.push_back(path);
+		}
+
+		for(auto draw : list->draws) {
+			draw.pathOffset += pathBase;
+			draw.triangleOffset += base;
+			draw.coverOffset += base;
+			draw.uniformOffset = writePaint(frame, list->paints[draw.uniformOffset], alignment);
+
+			if(settings_.storagePaints)
+				for(auto i = 0u; i < draw.shapeCount; ++i)
+					shapes[draw.shapeOffset + i].paint = draw.uniformOffset / sizeof(UniformData);
+			draw.shapeOffset += shapeBase;
+
+			drawDatas_.push_back(draw);
+		}
+	}
+
+	// the nodes are reused by the next started draw lists
+	{
+		std::lock_guard<std::mutex> lock(shared_->recycledMutex);
+		for(auto& list : lists)
+			shared_->recycled.push_back(std::move(list));
+	}
+
+	prepared_ = false;
+}
+
+//DrawList
+void DrawList::start(unsigned int width, unsigned int height)
+{
+	width_ = width;
+	height_ = height;
+	cancel();
+}
+
+void DrawList::cancel()
+{
+	if(!data_) {
+		auto& shared = *renderer_.shared_;
+		std::lock_guard<std::mutex> lock(shared.recycledMutex);
+		if(!shared.recycled.empty()) {
+			data_ = std::move(shared.recycled.back());
+			shared.recycled.pop_back();
+		}
 	}
 
-	auto vertexSize = vertices_.size() * sizeof(NVGvertex);
-	if(vertexBuffer_.memorySize() < vertexSize) {
-		vk::BufferCreateInfo bufInfo;
-		bufInfo.usage = vk::BufferUsageBits::vertexBuffer;
-		bufInfo.size = vertexSize;
-		vertexBuffer_ = {device(), bufInfo, bits};
-	}
+	if(!data_) data_ = std::make_unique<DrawListData>();
 
-	// descriptorPool
-	if(drawDatas_.size() > descriptorPoolSize_) {
-		vk::DescriptorPoolSize typeCounts[2];
-		typeCounts[0].type = vk::DescriptorType::uniformBuffer;
-		typeCounts[0].descriptorCount = drawDatas_.size();
+	data_->vertices.clear();
+	data_->compactVertices.clear();
+	data_->shapes.clear();
+	data_->paints.clear();
+	data_->draws.clear();
+	data_->paths.clear();
+}
 
-		typeCounts[1].type = vk::DescriptorType::combinedImageSampler;
-		typeCounts[1].descriptorCount = drawDatas_.size();
+void DrawList::submit()
+{
+	if(!data_ || data_->draws.empty())
+		return;
 
-		vk::DescriptorPoolCreateInfo poolInfo;
-		poolInfo.poolSizeCount = 2;
-		poolInfo.pPoolSizes = typeCounts;
-		poolInfo.maxSets = drawDatas_.size();
+	// the node is owned by the renderer until it is flushed
+	auto node = data_.release();
+	node->order = order_;
+	node->sequence = renderer_.shared_->sequence.fetch_add(1, std::memory_order_relaxed);
 
-		descriptorPool_ = {device(), poolInfo};
-		descriptorPoolSize_ = drawDatas_.size();
-	} else if(descriptorPool_) {
-		vk::resetDescriptorPool(device(), descriptorPool_, {});
-	}
+	auto& head = renderer_.shared_->submissions;
+	node->next = head.load(std::memory_order_relaxed);
+	while(!head.compare_exchange_weak(node->next, node, std::memory_order_release,
+		std::memory_order_relaxed));
+}
 
-	// update
-	vpp::BufferUpdate update(uniformBuffer_, vpp::BufferLayout::std140);
-	for(auto& data : drawDatas_) {
-		update.alignUniform();
+void DrawList::fill(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+	const float* bounds, nytl::Span<const NVGpath> paths)
+{
+	Vec2 viewSize = {float(width_), float(height_)};
+	if(culled(bounds, fringe, scissor, viewSize))
+		return;
 
-		auto offset = update.offset();
-		update.add(vpp::raw(data.uniformData, 1)); // TODO
+	auto& settings = renderer_.settings_;
+	std::array<float, 4> drawBounds {};
+	if(settings.compactVertices || settings.dirtyRegions)
+		drawBounds = pathBounds(paths, bounds);
 
-		data.descriptorSet = {descriptorLayout_, descriptorPool_};
+	VertexOrigin origin;
+	if(settings.compactVertices)
+		origin = vertexOrigin(drawBounds.data(), viewSize);
 
-		vpp::DescriptorSetUpdate descUpdate(data.descriptorSet);
-		descUpdate.uniform({{uniformBuffer_, offset, sizeof(UniformData)}});
+	auto& drawData = parsePaint(paint, scissor, fringe, fringe, origin);
+	if(settings.dirtyRegions)
+		drawData.bounds = drawBounds;
 
-		vk::ImageView iv = dummyTexture_.viewableImage().vkImageView();
-		dlg_assert(iv);
-		if(data.texture != 0)
-			iv = texture(data.texture)->viewableImage().vkImageView();
+	buildFill(drawData, data_->paths, bounds, paths, renderer_.settings_.stencilFills,
+		renderer_.edgeAA_,
+		[&](nytl::Span<const NVGvertex> verts) { return writeVertices(verts, origin); });
+}
+
+void DrawList::stroke(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+	float strokeWidth, nytl::Span<const NVGpath> paths)
+{
+	Vec2 viewSize = {float(width_), float(height_)};
+	auto drawBounds = pathBounds(paths, nullptr);
+	if(culled(drawBounds.data(), 1.f, scissor, viewSize))
+		return;
 
-		auto layout = vk::ImageLayout::general; //XXX
-		descUpdate.imageSampler({{{}, iv, layout}});
+	auto& settings = renderer_.settings_;
+	VertexOrigin origin;
+	if(settings.compactVertices)
+		origin = vertexOrigin(drawBounds.data(), viewSize);
 
-		descUpdate.apply();
-	}
+	auto& drawData = parsePaint(paint, scissor, fringe, strokeWidth, origin);
+	if(settings.dirtyRegions)
+		drawData.bounds = drawBounds;
 
-	update.apply()->finish();
+	buildStroke(drawData, data_->paths, paths,
+		[&](nytl::Span<const NVGvertex> verts) { return writeVertices(verts, origin); });
+}
 
-	//vertex
-	vpp::BufferUpdate vupdate(vertexBuffer_, vpp::BufferLayout::std140);
-	vupdate.add(vpp::raw(*vertices_.data(), vertices_.size()));
-	vupdate.apply()->finish();
+void DrawList::triangles(const NVGpaint& paint, const NVGscissor& scissor,
+	nytl::Span<const NVGvertex> verts)
+{
+	Vec2 viewSize = {float(width_), float(height_)};
+	auto bounds = pathBounds({}, nullptr);
+	addBounds(bounds.data(), verts);
+	if(culled(bounds.data(), 1.f, scissor, viewSize))
+		return;
 
-	//render
-	if(swapchain_) {
-		renderer_.renderBlock(*presentQueue_);
-	} else {
-		vk::beginCommandBuffer(commandBuffer_, {});
+	auto& settings = renderer_.settings_;
+	VertexOrigin origin;
+	if(settings.compactVertices)
+		origin = vertexOrigin(bounds.data(), viewSize);
 
-		vk::ClearValue clearValues[2] {};
-		clearValues[0].color = {0.f, 0.f, 0.f, 1.0f};
-		clearValues[1].depthStencil = {1.f, 0};
+	auto& drawData = parsePaint(paint, scissor, 1.f, 1.f, origin, true);
+	if(settings.dirtyRegions)
+		drawData.bounds = bounds;
+	drawData.triangleOffset = writeVertices(verts, origin);
+	drawData.triangleCount = verts.size();
+}
 
-		auto size = framebuffer_->size();
+bool DrawList::fillShape(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+	const NVGshape& shape)
+{
+	if(paint.image)
+		return false;
+
+	auto instance = shapeInstance(shape, fringe);
+	auto bounds = shapeBounds(instance);
+	if(culled(bounds.data(), 1.f, scissor, {float(width_), float(height_)}))
+		return true;
+
+	// the paint index is assigned when the list is appended to the frame
+	VertexOrigin origin;
+	auto& drawData = parsePaint(paint, scissor, fringe, fringe, origin);
+	drawData.shapeOffset = data_->shapes.size();
+	drawData.shapeCount = 1;
+	data_->shapes.push_back(instance);
+	if(renderer_.settings_.dirtyRegions)
+		drawData.bounds = bounds;
+	return true;
+}
 
-		vk::RenderPassBeginInfo beginInfo;
-		beginInfo.renderPass = vkRenderPass();
-		beginInfo.renderArea = {{0, 0}, {size.width, size.height}};
-		beginInfo.clearValueCount = 2;
-		beginInfo.pClearValues = clearValues;
-		beginInfo.framebuffer = *framebuffer_;
-		vk::cmdBeginRenderPass(commandBuffer_, beginInfo, vk::SubpassContents::eInline);
+DrawData& DrawList::parsePaint(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+	float strokeWidth, VertexOrigin& origin, bool vertexTexCoords)
+{
+	if(!data_) data_ = std::make_unique<DrawListData>();
 
-		vk::Viewport viewport;
-		viewport.width = size.width;
-		viewport.height = size.height;
-		viewport.minDepth = 0.f;
-		viewport.maxDepth = 1.f;
-		vk::cmdSetViewport(commandBuffer_, 0, 1, viewport);
+	data_->draws.emplace_back();
+	auto& data = data_->draws.back();
 
-		//Update dynamic scissor state
-		vk::Rect2D scissor;
-		scissor.extent = {size.width, size.height};
-		scissor.offset = {0, 0};
-		vk::cmdSetScissor(commandBuffer_, 0, 1, scissor);
+	const Texture* tex = nullptr;
+	std::unique_lock<std::recursive_mutex> lock(renderer_.shared_->mutex, std::defer_lock);
+	if(paint.image) {
+		lock.lock();
+		tex = renderer_.texture(paint.image);
+		data.texture = tex ? textureRemap(renderer_, *tex, origin) : paint.image;
+	}
 
-		record(commandBuffer_);
+	Vec2 viewSize = {float(width_), float(height_)};
+	data_->paints.push_back(paintUniforms(paint, scissor, fringe, strokeWidth, viewSize, tex,
+		origin, vertexTexCoords));
+	data.uniformOffset = data_->paints.size() - 1;
+	data.variant = paintVariant(data_->paints.back(), scissor);
 
-		vk::cmdEndRenderPass(commandBuffer_);
-		vk::endCommandBuffer(commandBuffer_);
+	// see Renderer::parsePaint
+	if(!vertexTexCoords) {
+		origin.uvOffset = {0.f, 0.f};
+		origin.uvScale = {1.f, 1.f};
+	}
+	return data;
+}
 
-		vpp::CommandExecutionState state;
-		device().submitManager().add(*renderQueue_, {commandBuffer_}, &state);
-		state.wait();
+std::size_t DrawList::writeVertices(nytl::Span<const NVGvertex> verts,
+	const VertexOrigin& origin)
+{
+	if(renderer_.settings_.compactVertices) {
+		auto& vertices = data_->compactVertices;
+		auto offset = vertices.size();
+		vertices.resize(offset + verts.size());
+		compactVertices(verts, origin, vertices.data() + offset);
+		return offset;
 	}
 
-	//cleanup
-	vertices_.clear();
-	drawDatas_.clear();
+	auto& vertices = data_->vertices;
+	auto offset = vertices.size();
+	vertices.resize(offset + verts.size());
+	remapVertices(verts, origin, vertices.data() + offset);
+	return offset;
 }
 
-void Renderer::fill(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
-	const float* bounds, nytl::Span<const NVGpath> paths)
+const Texture* Renderer::texture(unsigned int id) const
 {
-	unused(bounds);
-	auto& drawData = parsePaint(paint, scissor, fringe, fringe);
-	drawData.paths.reserve(paths.size());
+	// the slot stores the full id, stale ids of reused slots don't match
+	auto slot = (id & textureIndexMask) - 1;
+	if(!id || slot >= textures_.size()) return nullptr;
 
-	for(auto& path : paths)
-	{
-		drawData.paths.emplace_back();
-		drawData.paths.back().fillOffset = vertices_.size();
-		drawData.paths.back().fillCount = path.nfill;
-		vertices_.insert(vertices_.end(), path.fill, path.fill + path.nfill);
-
-		if(edgeAA_ && path.nstroke > 0)
-		{
-			drawData.paths.back().strokeOffset = vertices_.size();
-			drawData.paths.back().strokeCount = path.nstroke;
-			vertices_.insert(vertices_.end(), path.stroke, path.stroke + path.nstroke);
-		}
-	}
+	auto& tex = textures_[slot].texture;
+	return (tex.id() == id) ? &tex : nullptr;
 }
-void Renderer::stroke(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
-	float strokeWidth, nytl::Span<const NVGpath> paths)
-{
-	auto& drawData = parsePaint(paint, scissor, fringe, strokeWidth);
-	drawData.paths.reserve(paths.size());
 
-	for(auto& path : paths)
-	{
-		drawData.paths.emplace_back();
-		drawData.paths.back().strokeOffset = vertices_.size();
-		drawData.paths.back().strokeCount = path.nstroke;
-		vertices_.insert(vertices_.end(), path.stroke, path.stroke + path.nstroke);
-	}
+Texture* Renderer::texture(unsigned int id)
+{
+	auto cthis = static_cast<const Renderer*>(this);
+	return const_cast<Texture*>(cthis->texture(id));
 }
-void Renderer::triangles(const NVGpaint& paint, const NVGscissor& scissor,
-	nytl::Span<const NVGvertex> verts)
+
+void Renderer::record(vk::CommandBuffer cmdBuffer)
 {
-	auto& drawData = parsePaint(paint, scissor, 1.f, 1.f);
+	prepare();
 
-	drawData.triangleOffset = vertices_.size();
-	drawData.triangleCount = verts.size();
-	vertices_.insert(vertices_.end(), verts.begin(), verts.end());
+	auto& frame = frames_[frameIndex_];
+	frame.stats.pipelineBinds += recordDrawCalls(cmdBuffer, frame.vertices.buffer(),
+		frame.indices.buffer(), drawCalls_);
 }
 
-DrawData& Renderer::parsePaint(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
-	float strokeWidth)
+void Renderer::capture(Scene& scene, unsigned int index)
 {
-	static constexpr auto typeColor = 1;
-	static constexpr auto typeGradient = 2;
-	static constexpr auto typeTexture = 3;
+	std::lock_guard<std::recursive_mutex> lock(shared_->mutex);
+	if(index >= scene.parts_.size())
+		scene.parts_.resize(index + 1);
 
-	static constexpr auto texTypeRGBA = 1;
-	static constexpr auto texTypeA = 2;
+	prepare();
 
-	//update image
-	drawDatas_.emplace_back();
+	auto& frame = frames_[frameIndex_];
+	auto& slot = scene.parts_[index];
+	slot = {};
 
-	auto& data = drawDatas_.back();
-	data.uniformData.viewSize = {float(width_), float(height_)};
+	if(drawCalls_.empty()) {
+		cancel();
+		return;
+	}
 
-	if(paint.image) {
-		auto* tex = texture(paint.image);
+	// the offsets of the draw calls stay valid since the streams are copied from the start.
+	// The data is staged right now since the streams are reused for the coming draws
+	auto part = std::make_shared<ScenePart>();
+	// empty streams (e.g. the indices of scenes with only shapes) get no buffer
+	auto stage = [&](StreamBuffer& stream, vk::BufferUsageFlags usage, vpp::Buffer& buffer,
+			vk::BufferCopy& copy) {
+		copy.size = stream.offset();
+		if(!copy.size)
+			return;
 
-		auto formatID = (tex->format() == vk::Format::r8g8b8a8Unorm) ? texTypeRGBA : texTypeA;
-		data.uniformData.type = typeTexture;
-		data.uniformData.texType = formatID;
+		copy.srcOffset = frame.staging.write(stream.data(), copy.size, 16u);
+		copy.dstOffset = 0;
 
-		data.texture = paint.image;
-	} else if(std::memcmp(&paint.innerColor, &paint.outerColor, sizeof(paint.innerColor)) == 0) {
-		data.uniformData.type = typeColor;
-		data.uniformData.texType = 0u;
-	} else {
-		data.uniformData.type = typeGradient;
-		data.uniformData.texType = 0u;
-	}
+		vk::BufferCreateInfo bufInfo;
+		bufInfo.usage = usage | vk::BufferUsageBits::transferDst;
+		bufInfo.size = copy.size;
+		buffer = {device(), bufInfo, device().memoryTypeBits(vk::MemoryPropertyBits::deviceLocal)};
+		buffer.assureMemory();
+	};
 
-	//colors
-	std::memcpy(&data.uniformData.innerColor, &paint.innerColor, sizeof(float) * 4);
-	std::memcpy(&data.uniformData.outerColor, &paint.outerColor, sizeof(float) * 4);
+	SceneUpload upload;
+	stage(frame.vertices, vk::BufferUsageBits::vertexBuffer, part->vertices, upload.vertices);
+	stage(frame.indices, vk::BufferUsageBits::indexBuffer, part->indices, upload.indices);
+	stage(frame.uniforms, vk::BufferUsageBits::uniformBuffer |
+		vk::BufferUsageBits::storageBuffer, part->uniforms, upload.uniforms);
 
-	//mats
-	float invxform[6];
+	// own descriptor sets for the own uniform buffer
+	std::vector<unsigned int> textures;
+	for(auto& call : drawCalls_)
+		if(std::find(textures.begin(), textures.end(), call.texture) == textures.end())
+			textures.push_back(call.texture);
 
-	//scissor
-	float scissorMat[4][4] {};
-	if (scissor.extent[0] < -0.5f || scissor.extent[1] < -0.5f) {
-		scissorMat[3][0] = 1.0f;
-		scissorMat[3][1] = 1.0f;
-		scissorMat[3][2] = 1.0f;
-		scissorMat[3][3] = 1.0f;
-	} else {
-		nvgTransformInverse(invxform, scissor.xform);
+	vk::DescriptorPoolSize typeCounts[3];
+	typeCounts[0].type = vk::DescriptorType::uniformBufferDynamic;
+	typeCounts[0].descriptorCount = textures.size();
 
-		scissorMat[0][0] = invxform[0];
-		scissorMat[0][1] = invxform[1];
-		scissorMat[1][0] = invxform[2];
-		scissorMat[1][1] = invxform[3];
-		scissorMat[2][0] = invxform[4];
-		scissorMat[2][1] = invxform[5];
-		scissorMat[2][2] = 1.0f;
+	typeCounts[1].type = vk::DescriptorType::combinedImageSampler;
+	typeCounts[1].descriptorCount = textures.size();
 
-		//extent
-		scissorMat[3][0] = scissor.extent[0];
-		scissorMat[3][1] = scissor.extent[1];
+	typeCounts[2].type = vk::DescriptorType::storageBuffer;
+	typeCounts[2].descriptorCount = textures.size();
 
-		//scale
-		scissorMat[3][2] = std::sqrt(scissor.xform[0]*scissor.xform[0] + scissor.xform[2]*
-			scissor.xform[2]) / fringe;
-		scissorMat[3][3] = std::sqrt(scissor.xform[1]*scissor.xform[1] + scissor.xform[3]*
-			scissor.xform[3]) / fringe;
-	}
+	vk::DescriptorPoolCreateInfo poolInfo;
+	poolInfo.poolSizeCount = 3;
+	poolInfo.pPoolSizes = typeCounts;
+	poolInfo.maxSets = textures.size();
+	part->descriptorPool = {device(), poolInfo};
 
-	scissorMat[0][3] = paint.radius;
-	scissorMat[1][3] = paint.feather;
-	scissorMat[2][3] = strokeWidth;
+	for(auto id : textures) {
+		auto& set = part->descriptorSets[id];
+		set = {descriptorLayout_, part->descriptorPool};
 
-	std::memcpy(&data.uniformData.scissorMat, &scissorMat, sizeof(scissorMat));
+		vpp::DescriptorSetUpdate descUpdate(set);
+		descUpdate.uniform({{part->uniforms, 0, sizeof(UniformData)}},
+			-1, vk::DescriptorType::uniformBufferDynamic);
 
-	//paint
-	float paintMat[4][4] {};
-	nvgTransformInverse(invxform, paint.xform);
-	paintMat[0][0] = invxform[0];
-	paintMat[0][1] = invxform[1];
-	paintMat[1][0] = invxform[2];
-	paintMat[1][1] = invxform[3];
-	paintMat[2][0] = invxform[4];
-	paintMat[2][1] = invxform[5];
-	paintMat[2][2] = 1.0f;
+		// see updateDescriptors
+		vk::ImageView iv = dummyTexture_.viewableImage().vkImageView();
+		vk::Sampler sampler = sampler_;
+		if(auto* tex = id ? texture(id) : nullptr) {
+			iv = tex->viewableImage().vkImageView();
+			sampler = textureSampler(tex->flags());
+		}
+
+		descUpdate.imageSampler({{sampler, iv, vk::ImageLayout::shaderReadOnlyOptimal}});
+		descUpdate.storage({{part->uniforms, 0, upload.uniforms.size}});
+		descUpdate.apply();
+	}
 
-	paintMat[3][0] = paint.extent[0];
-	paintMat[3][1] = paint.extent[1];
+	part->drawCalls = drawCalls_;
+	for(auto& call : part->drawCalls)
+		call.descriptorSet = part->descriptorSets[call.texture];
 
-	//strokeMult
-	paintMat[0][3] = (strokeWidth * 0.5f + fringe * 0.5f) / fringe;
+	// the secondary command buffer can be executed by multiple frames in flight
+	auto size = swapchain_ ? swapchain_->size() :
+		offscreen_ ? offscreenSize_ : framebuffer_->size();
+	part->commandBuffer = device().commandProvider().get(renderQueue_->family(), {},
+		vk::CommandBufferLevel::secondary);
 
-	std::memcpy(&data.uniformData.paintMat, &paintMat, sizeof(paintMat));
-	return data;
+	auto& cmdBuffer = part->commandBuffer;
+	beginSecondary(cmdBuffer, vkRenderPass(), {}, vk::CommandBufferUsageBits::simultaneousUse);
+	setViewport(cmdBuffer, size);
+	recordDrawCalls(cmdBuffer, part->vertices, part->indices, part->drawCalls);
+	vk::endCommandBuffer(cmdBuffer);
+
+	upload.part = part;
+	frame.sceneUploads.push_back(std::move(upload));
+	slot = std::move(part);
+
+	// the captured draws are not rendered by this frame
+	cancel();
 }
 
-const Texture* Renderer::texture(unsigned int id) const
+void Renderer::draw(const Scene& scene)
 {
-	auto it = std::find_if(textures_.begin(), textures_.end(),
-		[=](const auto& tex) { return tex.id() == id; });
-
-	if(it == textures_.end()) return nullptr;
-	return &(*it);
+	auto& frame = currentFrame();
+	for(auto& part : scene.parts_)
+		if(part)
+			frame.scenes.push_back(part);
 }
 
-Texture* Renderer::texture(unsigned int id)
+unsigned int Renderer::record(nytl::Span<const vk::CommandBuffer> cmdBuffers, vk::Framebuffer fb,
+	const vk::Extent2D& size)
 {
-	auto it = std::find_if(textures_.begin(), textures_.end(),
-		[=](const auto& tex) { return tex.id() == id; });
+	prepare();
+	if(cmdBuffers.empty())
+		return 0;
+
+	// split the draw calls into chunks with roughly the same number of indices.
+	// Small chunks are not worth a thread
+	auto maxChunks = std::max<std::size_t>(drawCalls_.size() / minChunkCalls, 1u);
+	auto chunks = std::min<std::size_t>(cmdBuffers.size(), maxChunks);
+
+	auto total = std::size_t(0);
+	for(auto& call : drawCalls_)
+		total += call.indexCount;
+
+	std::vector<std::size_t> bounds {0};
+	auto current = std::size_t(0);
+	for(auto i = 0u; i < drawCalls_.size() && bounds.size() < chunks; ++i) {
+		current += drawCalls_[i].indexCount;
+		if(current * chunks >= total * bounds.size() && i + 1 < drawCalls_.size())
+			bounds.push_back(i + 1);
+	}
+
+	bounds.push_back(drawCalls_.size());
+	chunks = bounds.size() - 1;
+
+	// every chunk binds all its state again, the stencil contents are kept between
+	// secondary command buffers of the same subpass
+	auto& frame = frames_[frameIndex_];
+	std::vector<unsigned int> binds(chunks);
+	auto recordChunk = [&](unsigned int i) {
+		auto cmdBuffer = cmdBuffers[i];
+		nytl::Span<const DrawCall> calls(drawCalls_.data() + bounds[i],
+			bounds[i + 1] - bounds[i]);
+
+		beginSecondary(cmdBuffer, vkRenderPass(), fb, vk::CommandBufferUsageBits::oneTimeSubmit);
+		setViewport(cmdBuffer, size, renderArea_);
+		binds[i] = recordDrawCalls(cmdBuffer, frame.vertices.buffer(), frame.indices.buffer(),
+			calls);
+		vk::endCommandBuffer(cmdBuffer);
+	};
 
-	if(it == textures_.end()) return nullptr;
-	return &(*it);
+	if(workers_) workers_->run(chunks, recordChunk);
+	else for(auto i = 0u; i < chunks; ++i) recordChunk(i);
+
+	for(auto count : binds)
+		frame.stats.pipelineBinds += count;
+
+	return chunks;
 }
 
-void Renderer::record(vk::CommandBuffer cmdBuffer)
+unsigned int Renderer::recordDrawCalls(vk::CommandBuffer cmdBuffer, vk::Buffer vertices,
+	vk::Buffer indices, nytl::Span<const DrawCall> calls)
 {
-	int bound = 0;
-	vk::cmdBindVertexBuffers(cmdBuffer, 0, {vertexBuffer_}, {0});
-
-	for(auto& data : drawDatas_)
+	// captured scenes have no buffers for empty streams
+	if(vertices != vk::Buffer {})
+		vk::cmdBindVertexBuffers(cmdBuffer, 0, {vertices}, {0});
+	if(indices != vk::Buffer {})
+		vk::cmdBindIndexBuffer(cmdBuffer, indices, 0, vk::IndexType::uint32);
+
+	vk::Pipeline bound {};
+	auto binds = 0u;
+	for(auto& call : calls)
 	{
-		vk::cmdBindDescriptorSets(cmdBuffer, vk::PipelineBindPoint::graphics, pipelineLayout_,
-			0, {data.descriptorSet}, {});
-
-		for(auto& path : data.paths) {
-			if(path.fillCount > 0) {
-				if(bound != 1) {
-					vk::cmdBindPipeline(cmdBuffer, vk::PipelineBindPoint::graphics, fanPipeline_);
-					bound = 1;
-				}
-
-				vk::cmdDraw(cmdBuffer, path.fillCount, 1, path.fillOffset, 0);
-			} if(path.strokeCount > 0) {
-				if(bound != 2) {
-					vk::cmdBindPipeline(cmdBuffer, vk::PipelineBindPoint::graphics, stripPipeline_);
-					bound = 2;
-				}
-
-				vk::cmdDraw(cmdBuffer, path.strokeCount, 1, path.strokeOffset, 0);
-			}
+		if(call.vkPipeline != bound) {
+			vk::cmdBindPipeline(cmdBuffer, vk::PipelineBindPoint::graphics, call.vkPipeline);
+			bound = call.vkPipeline;
+			++binds;
 		}
 
-		if(data.triangleCount > 0) {
-			if(bound != 3) {
-				vk::cmdBindPipeline(cmdBuffer, vk::PipelineBindPoint::graphics, listPipeline_);
-				bound = 3;
-			}
-
-			vk::cmdDraw(cmdBuffer, data.triangleCount, 1, data.triangleOffset, 0);
+		// the uniform data is selected with a dynamic offset or
+		// the index of the paint in the storage buffer
+		auto offset = call.uniformOffset;
+		auto index = std::uint32_t(0);
+		if(settings_.storagePaints) {
+			index = offset / sizeof(UniformData);
+			offset = 0;
 		}
+
+		vk::cmdBindDescriptorSets(cmdBuffer, vk::PipelineBindPoint::graphics, pipelineLayout_,
+			0, {call.descriptorSet}, {offset});
+		vk::cmdPushConstants(cmdBuffer, pipelineLayout_, vk::ShaderStageBits::vertex |
+			vk::ShaderStageBits::fragment, 0, sizeof(index), &index);
+
+		if(call.pipeline == PipelineType::shape)
+			vk::cmdDraw(cmdBuffer, 4, call.indexCount, 0, call.firstIndex);
+		else
+			vk::cmdDrawIndexed(cmdBuffer, call.indexCount, 1, call.firstIndex, 0, 0);
 	}
+
+	return binds;
 }
 
-void Renderer::initRenderPass(const vpp::Device& dev, vk::Format attachment)
+void Renderer::initRenderPass(const vpp::Device& dev, vk::Format attachment,
+	vk::ImageLayout finalLayout)
 {
-	vk::AttachmentDescription attachments[2] {};
+	renderPassFormat_ = attachment;
+
+	vk::AttachmentDescription attachments[3] {};
+	auto samples = sampleCount(dev, settings_.samples);
+	auto multisampled = settings_.samples > 1;
 
 	//color from swapchain
 	attachments[0].format = attachment;
-	attachments[0].samples = vk::SampleCountBits::e1;
+	attachments[0].samples = samples;
 	attachments[0].loadOp = vk::AttachmentLoadOp::clear;
 	attachments[0].storeOp = vk::AttachmentStoreOp::store;
 	attachments[0].stencilLoadOp = vk::AttachmentLoadOp::dontCare;
 	attachments[0].stencilStoreOp = vk::AttachmentStoreOp::dontCare;
 	attachments[0].initialLayout = vk::ImageLayout::undefined;
-	attachments[0].finalLayout = vk::ImageLayout::presentSrcKHR;
+	attachments[0].finalLayout = finalLayout;
 
 	vk::AttachmentReference colorReference;
 	colorReference.attachment = 0;
 	colorReference.layout = vk::ImageLayout::colorAttachmentOptimal;
 
+	//when multisampling, the swapchain image is the resolve attachment and the
+	//multisampled color attachment is only needed during the render pass
+	vk::AttachmentReference resolveReference;
+	resolveReference.attachment = 2;
+	resolveReference.layout = vk::ImageLayout::colorAttachmentOptimal;
+
+	if(multisampled) {
+		attachments[0].storeOp = vk::AttachmentStoreOp::dontCare;
+		attachments[0].finalLayout = vk::ImageLayout::colorAttachmentOptimal;
+
+		attachments[2].format = attachment;
+		attachments[2].samples = vk::SampleCountBits::e1;
+		attachments[2].loadOp = vk::AttachmentLoadOp::dontCare;
+		attachments[2].storeOp = vk::AttachmentStoreOp::store;
+		attachments[2].stencilLoadOp = vk::AttachmentLoadOp::dontCare;
+		attachments[2].stencilStoreOp = vk::AttachmentStoreOp::dontCare;
+		attachments[2].initialLayout = vk::ImageLayout::undefined;
+		attachments[2].finalLayout = finalLayout;
+	}
+
 	//stencil attachment
 	//will not be used as depth buffer
 	attachments[1].format = vk::Format::s8Uint;
-	attachments[1].samples = vk::SampleCountBits::e1;
+	attachments[1].samples = samples;
 	attachments[1].loadOp = vk::AttachmentLoadOp::clear;
 	attachments[1].storeOp = vk::AttachmentStoreOp::store;
-	attachments[1].stencilLoadOp = vk::AttachmentLoadOp::dontCare;
+	attachments[1].stencilLoadOp = vk::AttachmentLoadOp::clear;
 	attachments[1].stencilStoreOp = vk::AttachmentStoreOp::dontCare;
 	attachments[1].initialLayout = vk::ImageLayout::undefined;
 	attachments[1].finalLayout = vk::ImageLayout::depthStencilAttachmentOptimal;
@@ -750,89 +3675,224 @@ void Renderer::initRenderPass(const vpp::Device& dev, vk::Format attachment)
 	subpass.pInputAttachments = nullptr;
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &colorReference;
-	subpass.pResolveAttachments = nullptr;
+	subpass.pResolveAttachments = multisampled ? &resolveReference : nullptr;
 	subpass.pDepthStencilAttachment = &depthReference;
 	subpass.preserveAttachmentCount = 0;
 	subpass.pPreserveAttachments = nullptr;
 
+	//the acquired swapchain image is only available at colorAttachmentOutput (the stage
+	//the acquire semaphore is waited on) and the previous frame might still be using
+	//the attachments since multiple frames can be in flight.
+	vk::SubpassDependency dependencies[2] {};
+	auto& dependency = dependencies[0];
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = vk::PipelineStageBits::colorAttachmentOutput |
+		vk::PipelineStageBits::lateFragmentTests;
+	dependency.srcAccessMask = vk::AccessBits::depthStencilAttachmentWrite;
+	dependency.dstStageMask = vk::PipelineStageBits::colorAttachmentOutput |
+		vk::PipelineStageBits::earlyFragmentTests;
+	dependency.dstAccessMask = vk::AccessBits::colorAttachmentWrite |
+		vk::AccessBits::depthStencilAttachmentRead |
+		vk::AccessBits::depthStencilAttachmentWrite;
+
+	//offscreen the rendered image is copied into the readback buffer after the render pass
+	auto offscreen = (finalLayout == vk::ImageLayout::transferSrcOptimal);
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = vk::PipelineStageBits::colorAttachmentOutput;
+	dependencies[1].srcAccessMask = vk::AccessBits::colorAttachmentWrite;
+	dependencies[1].dstStageMask = vk::PipelineStageBits::transfer;
+	dependencies[1].dstAccessMask = vk::AccessBits::transferRead;
+
 	vk::RenderPassCreateInfo renderPassInfo;
-	renderPassInfo.attachmentCount = 2;
+	renderPassInfo.attachmentCount = multisampled ? 3 : 2;
 	renderPassInfo.pAttachments = attachments;
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 0;
-	renderPassInfo.pDependencies = nullptr;
+	renderPassInfo.dependencyCount = offscreen ? 2 : 1;
+	renderPassInfo.pDependencies = dependencies;
 
 	renderPass_ = {dev, renderPassInfo};
+
+	//compatible render pass for partial redraws. The clear only applies to the render area
+	//and everything in it is drawn again, the defined initial layout keeps the previous
+	//image contents outside of it. Loading them would blend the redrawn draws over
+	//their old pixels
+	if(settings_.dirtyRegions && !multisampled && !offscreen) {
+		attachments[0].initialLayout = finalLayout;
+		partialRenderPass_ = {dev, renderPassInfo};
+	}
 }
 
 
-//Texture
-Texture::Texture(const vpp::Device& dev, unsigned int xid, const vk::Extent2D& size,
-	vk::Format format, const std::uint8_t* data)
-		: format_(format), id_(xid), width_(size.width), height_(size.height)
+//StreamBuffer
+StreamBuffer::StreamBuffer(const vpp::Device& dev, vk::BufferUsageFlags usage,
+	std::size_t size) : usage_(usage)
 {
-	vk::Extent3D extent {width(), height(), 1};
+	vk::BufferCreateInfo bufInfo;
+	bufInfo.usage = usage;
+	bufInfo.size = size;
+
+	auto bits = dev.memoryTypeBits(vk::MemoryPropertyBits::hostVisible |
+		vk::MemoryPropertyBits::hostCoherent);
+	buffer_ = {dev, bufInfo, bits};
+	buffer_.assureMemory();
+
+	// the buffer stays mapped for its whole lifetime
+	map_ = buffer_.memoryMap();
+	data_ = map_.ptr();
+	size_ = size;
+}
 
-	auto info = vpp::ViewableImage::defaultColor2D();
-	info.imgInfo.extent = extent;
-	info.imgInfo.initialLayout = vk::ImageLayout::undefined;
-	info.imgInfo.tiling = vk::ImageTiling::linear;
+std::size_t StreamBuffer::allocate(std::size_t size, std::size_t alignment)
+{
+	auto offset = ((offset_ + alignment - 1) / alignment) * alignment;
+	if(offset + size > size_)
+		grow(offset + size);
 
-	info.imgInfo.format = format;
-	info.viewInfo.format = format;
+	offset_ = offset + size;
+	return offset;
+}
 
-	info.imgInfo.usage = vk::ImageUsageBits::sampled;
-	info.memoryTypeBits = dev.memoryTypeBits(vk::MemoryPropertyBits::hostVisible);
+std::size_t StreamBuffer::write(const void* data, std::size_t size, std::size_t alignment)
+{
+	auto offset = allocate(size, alignment);
+	std::memcpy(data_ + offset, data, size);
+	return offset;
+}
 
-	// info.imgInfo.usage = vk::ImageUsageBits::transferDst | vk::ImageUsageBits::sampled;
-	viewableImage_ = {dev, info};
+void StreamBuffer::grow(std::size_t needed)
+{
+	auto size = std::max(size_ * 2, needed);
+	StreamBuffer grown(buffer_.device(), usage_, size);
+	std::memcpy(grown.data_, data_, offset_);
 
-	vpp::changeLayout(viewableImage_.image(), vk::ImageLayout::undefined,
-		vk::ImageLayout::general, {vk::ImageAspectBits::color, 0, 1, 0, 1})->finish();
+	grown.offset_ = offset_;
+	grown.generation_ = generation_ + 1;
 
-	vk::ImageLayout layout = vk::ImageLayout::general;
-	if(data)
-		vpp::fill(viewableImage_.image(), *data, format, layout, extent,
-			{vk::ImageAspectBits::color, 0, 1})->finish();
+	map_ = {}; // unmap before the old buffer is destroyed
+	*this = std::move(grown);
+}
+
+//WorkerPool
+WorkerPool::WorkerPool(unsigned int threads)
+{
+	threads_.reserve(threads);
+	for(auto i = 0u; i < threads; ++i)
+		threads_.emplace_back([this]{ work(); });
 }
 
-void Texture::update(const vk::Offset2D& offset, const vk::Extent2D& extent,
-	const std::uint8_t& data)
+WorkerPool::~WorkerPool()
 {
-	unused(offset, extent);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		exit_ = true;
+	}
 
-	//TODO: really only update the given offset/extent
-	//would need an extra data copy
-	//or modify vpp::fill(Image) to also accept non tightly packed data
-	//or just fill it manually...
-	// vk::Offset3D ioffset {offset.x, offset.y, 0};
+	workCv_.notify_all();
+	for(auto& thread : threads_)
+		thread.join();
+}
 
-	vk::Extent3D iextent {width(), height(), 1};
-	vk::ImageLayout layout = vk::ImageLayout::general;
-	fill(viewableImage_.image(), data, format(), layout, iextent,
-		{vk::ImageAspectBits::color, 0, 0})->finish();
+void WorkerPool::run(unsigned int count, const std::function<void(unsigned int)>& func)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	func_ = &func;
+	count_ = count;
+	next_ = 0;
+	done_ = 0;
+	exception_ = {};
+	workCv_.notify_all();
+
+	while(next_ < count_)
+		call(lock);
+
+	doneCv_.wait(lock, [&]{ return done_ == count_; });
+	func_ = nullptr;
+
+	if(exception_)
+		std::rethrow_exception(exception_);
 }
 
+void WorkerPool::work()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while(true) {
+		workCv_.wait(lock, [&]{ return exit_ || (func_ && next_ < count_); });
+		if(exit_)
+			return;
+
+		call(lock);
+	}
+}
 
-//RenderImpl
-void RenderImpl::build(unsigned int, const vpp::RenderPassInstance& ini)
+void WorkerPool::call(std::unique_lock<std::mutex>& lock)
 {
-	renderer->record(ini.vkCommandBuffer());
+	auto index = next_++;
+	auto& func = *func_;
+
+	lock.unlock();
+	std::exception_ptr exception;
+	try {
+		func(index);
+	} catch(...) {
+		exception = std::current_exception();
+	}
+	lock.lock();
+
+	if(exception && !exception_)
+		exception_ = exception;
+
+	if(++done_ == count_)
+		doneCv_.notify_all();
 }
 
-std::vector<vk::ClearValue> RenderImpl::clearValues(unsigned int)
+//Texture
+Texture::Texture(const vpp::Device& dev, unsigned int xid, const vk::Extent2D& size,
+	vk::Format format, nytl::Span<const std::uint32_t> queueFamilies, int imageFlags)
+		: format_(format), id_(xid), width_(size.width), height_(size.height),
+			flags_(imageFlags)
 {
-	// TODO
-	std::vector<vk::ClearValue> ret(1, vk::ClearValue{});
-	ret[0].color = {0.f, 0.f, 0.f, 1.0f};
-	// ret[0].depthStencil = {1.f, 0};
-	return ret;
+	vk::Extent3D extent {width(), height(), 1};
+
+	// the full chain down to 1x1
+	if(imageFlags & NVG_IMAGE_GENERATE_MIPMAPS)
+		while(std::max(width(), height()) >> levels_)
+			++levels_;
+
+	// the data is uploaded through a staging buffer by the Renderer
+	auto info = vpp::ViewableImage::defaultColor2D();
+	info.imgInfo.extent = extent;
+	info.imgInfo.initialLayout = vk::ImageLayout::undefined;
+	info.imgInfo.tiling = vk::ImageTiling::optimal;
+
+	info.imgInfo.format = format;
+	info.viewInfo.format = format;
+
+	info.imgInfo.mipLevels = levels_;
+	info.viewInfo.subresourceRange.levelCount = levels_;
+
+	// the mipmaps are blitted from the previous level
+	info.imgInfo.usage = vk::ImageUsageBits::transferDst | vk::ImageUsageBits::sampled;
+	if(levels_ > 1)
+		info.imgInfo.usage |= vk::ImageUsageBits::transferSrc;
+	info.memoryTypeBits = dev.memoryTypeBits(vk::MemoryPropertyBits::deviceLocal);
+
+	// no ownership transfers needed if it is used on multiple queue families
+	if(queueFamilies.size() > 1) {
+		info.imgInfo.sharingMode = vk::SharingMode::concurrent;
+		info.imgInfo.queueFamilyIndexCount = queueFamilies.size();
+		info.imgInfo.pQueueFamilyIndices = queueFamilies.data();
+	}
+
+	viewableImage_ = {dev, info};
 }
 
-void RenderImpl::frame(unsigned int id)
+Texture::Texture(unsigned int xid, const Texture& page, const vk::Rect2D& region,
+	int imageFlags) : format_(page.format()), id_(xid), width_(region.extent.width),
+		height_(region.extent.height), page_(page.id()), region_(region), flags_(imageFlags)
 {
-	swapchainRenderer->record(id);
 }
 
 //class that derives vvg::Renderer for the C implementation.
@@ -844,9 +3904,25 @@ public:
 	RendererCImpl(NonOwnedDevicePtr dev, NonOwnedSwapchainPtr swapchain)
 		: Renderer(*swapchain), dev_(std::move(dev)), swapchain_(std::move(swapchain)) {}
 
+	/// Replaces the swapchain after it was recreated by the application, see vvgResize.
+	void resize(vk::SwapchainKHR swapchain, const vk::Extent2D& size, vk::Format format)
+	{
+		// the frames in flight might still use the old swapchain
+		wait();
+		swapchain_.reset(new vpp::NonOwned<vpp::Swapchain>(*dev_, swapchain, {}, size, format));
+		Renderer::swapchain_ = swapchain_.get();
+		Renderer::resize();
+	}
+
 	virtual ~RendererCImpl()
 	{
 		//first destruct the Renderer since it may depend on the device and swapchain
+		//the moved-from resources might still be in use by the device
+		stopPrewarm();
+		wait();
+		if(pipelineCache_.vkHandle())
+			savePipelineCache(*this);
+
 		Renderer::operator=({});
 	}
 
@@ -873,10 +3949,13 @@ int renderCreate(void* uptr)
 
 int createTexture(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data)
 {
-	vvg::unused(uptr, type, imageFlags);
 	auto& renderer = resolve(uptr);
-	auto format = (type == NVG_TEXTURE_ALPHA) ? vk::Format::r8Unorm : vk::Format::r8g8b8a8Unorm;
-	return renderer.createTexture(format, w, h, data);
+	auto format = vk::Format::r8g8b8a8Unorm;
+	if(type == NVG_TEXTURE_ALPHA) format = vk::Format::r8Unorm;
+	else if(type == NVG_TEXTURE_SDF) format = vk::Format::r8Snorm;
+
+	// the Renderer does not pack images whose flags need their own sampler
+	return renderer.createTexture(format, w, h, data, imageFlags, true);
 }
 int deleteTexture(void* uptr, int image)
 {
@@ -886,26 +3965,25 @@ int deleteTexture(void* uptr, int image)
 int updateTexture(void* uptr, int image, int x, int y, int w, int h, const unsigned char* data)
 {
 	auto& renderer = resolve(uptr);
-	auto* tex = renderer.texture(image);
-	if(!tex) return 0;
 
 	vk::Extent2D extent {(unsigned int) w, (unsigned int) h};
 	vk::Offset2D offset{x, y};
-	tex->update(offset, extent, *data);
-
-	return 1;
+	return renderer.updateTexture(image, offset, extent, *data);
 }
-int getTextureSize(void* uptr, int image, int* w, int* h)
+int textureSize(const vvg::Renderer& renderer, int image, int* w, int* h)
 {
-	auto& renderer = resolve(uptr);
 	auto* tex = renderer.texture(image);
 	if(!tex) return 0;
 
 	//TODO: first check pointers?
 	*w = tex->width();
-	*h = tex->width();
+	*h = tex->height();
 	return 1;
 }
+int getTextureSize(void* uptr, int image, int* w, int* h)
+{
+	return textureSize(resolve(uptr), image, w, h);
+}
 void viewport(void* uptr, int width, int height)
 {
 	auto& renderer = resolve(uptr);
@@ -943,6 +4021,12 @@ void renderDelete(void* uptr)
 	auto& renderer = resolve(uptr);
 	delete &renderer;
 }
+int fillShape(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe,
+	const NVGshape* shape)
+{
+	auto& renderer = resolve(uptr);
+	return renderer.fillShape(*paint, *scissor, fringe, *shape);
+}
 
 const NVGparams nvgContextImpl =
 {
@@ -959,7 +4043,96 @@ const NVGparams nvgContextImpl =
 	fill,
 	stroke,
 	triangles,
-	renderDelete
+	renderDelete,
+	fillShape,
+	0
+};
+
+// The implementation for shared contexts, forwards the texture calls to the Renderer
+vvg::DrawList& resolveList(void* ptr)
+{
+	return *static_cast<vvg::DrawList*>(ptr);
+}
+
+int listCreateTexture(void* uptr, int type, int w, int h, int imageFlags,
+	const unsigned char* data)
+{
+	return createTexture(&resolveList(uptr).renderer(), type, w, h, imageFlags, data);
+}
+int listDeleteTexture(void* uptr, int image)
+{
+	return deleteTexture(&resolveList(uptr).renderer(), image);
+}
+int listUpdateTexture(void* uptr, int image, int x, int y, int w, int h,
+	const unsigned char* data)
+{
+	return updateTexture(&resolveList(uptr).renderer(), image, x, y, w, h, data);
+}
+int listGetTextureSize(void* uptr, int image, int* w, int* h)
+{
+	auto& list = resolveList(uptr);
+	auto lock = list.lock();
+	return textureSize(list.renderer(), image, w, h);
+}
+void listViewport(void* uptr, int width, int height)
+{
+	resolveList(uptr).start(width, height);
+}
+void listCancel(void* uptr)
+{
+	resolveList(uptr).cancel();
+}
+void listFlush(void* uptr)
+{
+	resolveList(uptr).submit();
+}
+void listFill(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe,
+	const float* bounds, const NVGpath* paths, int npaths)
+{
+	auto& list = resolveList(uptr);
+	list.fill(*paint, *scissor, fringe, bounds, {paths, std::size_t(npaths)});
+}
+void listStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe,
+	float strokeWidth, const NVGpath* paths, int npaths)
+{
+	auto& list = resolveList(uptr);
+	list.stroke(*paint, *scissor, fringe, strokeWidth, {paths, std::size_t(npaths)});
+}
+void listTriangles(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts,
+	int nverts)
+{
+	auto& list = resolveList(uptr);
+	list.triangles(*paint, *scissor, {verts, std::size_t(nverts)});
+}
+void listDelete(void* uptr)
+{
+	delete &resolveList(uptr);
+}
+int listFillShape(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe,
+	const NVGshape* shape)
+{
+	auto& list = resolveList(uptr);
+	return list.fillShape(*paint, *scissor, fringe, *shape);
+}
+
+const NVGparams nvgListContextImpl =
+{
+	nullptr,
+	1,
+	renderCreate,
+	listCreateTexture,
+	listDeleteTexture,
+	listUpdateTexture,
+	listGetTextureSize,
+	listViewport,
+	listCancel,
+	listFlush,
+	listFill,
+	listStroke,
+	listTriangles,
+	listDelete,
+	listFillShape,
+	0
 };
 
 } // anonymous util namespace
@@ -971,9 +4144,35 @@ NVGcontext* createContext(std::unique_ptr<Renderer> renderer)
 {
 	auto impl = nvgContextImpl;
 	auto rendererPtr = renderer.get();
+	impl.sdfText = rendererPtr->settings().sdfText;
+	impl.edgeAntiAlias = rendererPtr->edgeAntiAlias();
 	impl.userPtr = renderer.release();
 	auto ret = nvgCreateInternal(&impl);
-	if(!ret) delete rendererPtr;
+	if(!ret) {
+		delete rendererPtr;
+		return ret;
+	}
+
+	auto threads = rendererPtr->settings().recordThreads;
+	if(threads > 1) {
+		auto dispatch = [](void* uptr, int count, void (*func)(void*, int), void* data) {
+			static_cast<Renderer*>(uptr)->dispatch(count, func, data);
+		};
+		nvgParallelTessellation(ret, dispatch, rendererPtr, threads, minTessCommands);
+	}
+
+	return ret;
+}
+
+NVGcontext* createSharedContext(Renderer& renderer, int order)
+{
+	auto impl = nvgListContextImpl;
+	auto list = new DrawList(renderer, order);
+	impl.sdfText = renderer.settings().sdfText;
+	impl.edgeAntiAlias = renderer.edgeAntiAlias();
+	impl.userPtr = list;
+	auto ret = nvgCreateInternal(&impl);
+	if(!ret) delete list;
 	return ret;
 }
 
@@ -996,11 +4195,16 @@ void destroyContext(const NVGcontext& context)
 const Renderer& getRenderer(const NVGcontext& context)
 {
 	auto ctx = const_cast<NVGcontext*>(&context);
-	return resolve(nvgInternalParams(ctx)->userPtr);
+	return getRenderer(*ctx);
 }
 Renderer& getRenderer(NVGcontext& context)
 {
-	return resolve(nvgInternalParams(&context)->userPtr);
+	// shared contexts are identified using their callbacks
+	auto params = nvgInternalParams(&context);
+	if(params->renderFlush == listFlush)
+		return resolveList(params->userPtr).renderer();
+
+	return resolve(params->userPtr);
 }
 
 }
@@ -1020,7 +4224,7 @@ NVGcontext* vvgCreate(const VVGContextDescription* descr)
 		vkPhDev, vkDev, {{vkQueue, descr->queueFamily}}));
 
 	// NOTE that this constructs the swapchain with an invalid surface parameter and it
-	// can therefore not be reiszed.
+	// can therefore not be resized by vpp, the application recreates it, see vvgResize.
 	vvg::NonOwnedSwapchainPtr swapchain(new vpp::NonOwned<vpp::Swapchain>(*dev,
 		vkSwapchain, {}, vkExtent, vkFormat));
 
@@ -1028,6 +4232,20 @@ NVGcontext* vvgCreate(const VVGContextDescription* descr)
 	return vvg::createContext(std::move(renderer));
 }
 
+void vvgResize(NVGcontext* context, VkSwapchainKHR swapchain, VkExtent2D size,
+	VkFormat format)
+{
+	// contexts created with vvgCreate always use a RendererCImpl
+	auto& renderer = static_cast<vvg::RendererCImpl&>(vvg::getRenderer(*context));
+	renderer.resize((vk::SwapchainKHR) swapchain, (const vk::Extent2D&) size,
+		(vk::Format) format);
+}
+
+int vvgOutOfDate(const NVGcontext* context)
+{
+	return vvg::getRenderer(*context).outOfDate();
+}
+
 void vvgDestroy(const NVGcontext* context)
 {
 	auto ctx = const_cast<NVGcontext*>(context);
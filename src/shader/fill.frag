@@ -1,115 +1,173 @@
-#version 450
-
-#extension GL_ARB_separate_shader_objects : enable
-#extension GL_ARB_shading_language_420pack : enable
-
-#define TYPE_COLOR 1
-#define TYPE_GRADIENT 2
-#define TYPE_TEXTURE 3
-
-#define TEXTYPE_RGBA 1
-#define TEXTYPE_A 2
-
-#define strokeThr -1.0f
-
-layout(constant_id = 0) const bool edgeAntiAlias = true;
-
-layout(location = 0) in vec2 ipos;
-layout(location = 1) in vec2 itexcoord;
-
-layout(location = 0) out vec4 ocolor;
-
-layout(set = 0, binding = 0) uniform UBO
-{
-	//not used here; from vertex shader
-	vec2 viewSize; //0
-
-	//type to draw (TYPE_* macros)
-	uint type; //8
-
-	//type of the texture (if type is TYPE_TEXTURE)
-	uint texType; //12
-
-	//two colors values
-	vec4 innerColor; //16
-	vec4 outerColor; //32
-
-	//mat3 is used as matrix.
-	//mat[3][0;1] is used as scissor extent
-	//mat[3][2;3] is used as scissor scale
-	//mat[0][3] is used as radius
-	//mat[1][3] is used as feather
-	//mat[2][3] is used as strokeWidth
-	mat4 scissorMat; //48
-
-	//mat3 is used as matrix
-	//mat[3][0;1] is used as extent
-	//mat[3][2;3] is FREE
-	//mat[0][3] is used as strokeMult
-	//mat[1][3] is FREE
-	//mat[2][3] is FREE
-	mat4 paintMat; //112
-
-} ubo;
-
-layout(set = 0, binding = 1) uniform sampler2D tex; //for texture drawing
-
-float sdroundrect(vec2 pt, vec2 ext, float rad)
-{
-	vec2 ext2 = ext - vec2(rad, rad);
-	vec2 d = abs(pt) - ext2;
-	return min(max(d.x, d.y), 0.0) + length(max(d, 0.0)) - rad;
-}
-
-float scissorMask(vec2 pos)
-{
-	vec2 sc = (abs((mat3(ubo.scissorMat) * vec3(pos, 1.0)).xy) - vec2(ubo.scissorMat[3]));
-	sc = vec2(0.5, 0.5) - sc * vec2(ubo.scissorMat[3][2], ubo.scissorMat[3][3]);
-	return clamp(sc.x, 0.0, 1.0) * clamp(sc.y, 0.0, 1.0);
-}
-
-float strokeMask()
-{
-	float strokeMult = ubo.paintMat[0][3];
-	return min(1.0, (1.0 - abs(itexcoord.x * 2.0 - 1.0)) * strokeMult) * min(1.0, itexcoord.y);
-}
-
-void main()
-{
-	float scissorAlpha = scissorMask(ipos);
-	if(edgeAntiAlias && scissorAlpha < 0.5f) discard;
-
-	float strokeAlpha = strokeMask();
-	if(strokeAlpha < strokeThr) discard;
-
-	if(ubo.type == TYPE_COLOR)
-	{
-		ocolor = ubo.innerColor;
-		if(edgeAntiAlias) ocolor *= strokeAlpha;
-	}
-	else if(ubo.type == TYPE_GRADIENT)
-	{
-		vec2 pt = (mat3(ubo.paintMat) * vec3(ipos, 1.0)).xy;
-		// vec2 pt = ipos;
-		float ft = ubo.scissorMat[1][3];
-		// float fac = sdroundrect(pt, vec2(ubo.paintMat[3]), ubo.scissorMat[0][3]) / ft;
-		// ocolor = mix(ubo.innerColor, ubo.outerColor, clamp(0.5 + fac, 0.0, 1.0));
-		// // ocolor = vec4(1.0, 0.0, 1.0, 1.0);
-		//
-		vec2 extent = vec2(ubo.paintMat[3][0], ubo.paintMat[3][1]);
-		float radius = ubo.scissorMat[0][3];
-		float d = clamp((sdroundrect(pt, extent, radius) + ft*0.5) / ft, 0.0, 1.0);
-		ocolor = mix(ubo.innerColor,ubo.outerColor,d);
-		// ocolor = vec4(radius, extent.x, extent.y, 1.0);
-		if(edgeAntiAlias) ocolor *= strokeAlpha;
-	}
-	else if(ubo.type == TYPE_TEXTURE)
-	{
-		ocolor = texture(tex, itexcoord);
-		if(ubo.texType == TEXTYPE_RGBA) ocolor = vec4(ocolor.xyz * ocolor.w, ocolor.w);
-		else if(ubo.texType == TEXTYPE_A) ocolor = vec4(ocolor.x);
-		ocolor = ocolor * ubo.innerColor;
-	}
-
-	ocolor *= scissorAlpha;
-}
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+#define TYPE_COLOR 1
+#define TYPE_GRADIENT 2
+#define TYPE_TEXTURE 3
+
+#define TEXTYPE_RGBA 1
+#define TEXTYPE_A 2
+#define TEXTYPE_SDF 3
+#define TEXTYPE_PREMULT 4 //rgba with premultiplied alpha, never a specialization constant
+
+#define strokeThr -1.0f
+
+layout(constant_id = 0) const bool edgeAntiAlias = true;
+
+//whether the paint is read from the paints storage buffer (indexed by the
+//push constant) instead of the uniform buffer
+layout(constant_id = 1) const bool storagePaints = false;
+
+//the paint the pipeline is specialized for: type (TYPE_* macros), texture type
+//(TEXTYPE_* macros) or 0 to read them from the paint, and whether the draw is scissored.
+//Lets the compiler remove the branches and the scissor math for the common paints.
+layout(constant_id = 2) const uint paintType = 0;
+layout(constant_id = 3) const uint paintTexType = 0;
+layout(constant_id = 4) const bool scissor = true;
+
+layout(location = 0) in vec2 ipos;
+layout(location = 1) in vec2 itexcoord;
+
+layout(location = 0) out vec4 ocolor;
+
+struct Paint
+{
+	//not used here; from vertex shader
+	vec2 viewSize; //0
+
+	//type to draw (TYPE_* macros)
+	uint type; //8
+
+	//type of the texture (if type is TYPE_TEXTURE)
+	uint texType; //12
+
+	//two colors values.
+	//For TYPE_TEXTURE the outer color is the mapping of the pattern coordinates into
+	//the texture (offset xy, scale zw), e.g. into an atlas region
+	vec4 innerColor; //16
+	vec4 outerColor; //32
+
+	//mat3 is used as matrix.
+	//mat[3][0;1] is used as scissor extent
+	//mat[3][2;3] is used as scissor scale
+	//mat[0][3] is used as radius
+	//mat[1][3] is used as feather (blur in distance units for TEXTYPE_SDF)
+	//mat[2][3] is used as strokeWidth
+	mat4 scissorMat; //48
+
+	//mat3 is used as matrix
+	//mat[3][0;1] is used as extent
+	//mat[3][2;3] is used as origin of compact vertices (fill_compact.vert)
+	//mat[0][3] is used as strokeMult
+	//mat[1][3] is used as step of compact vertices (fill_compact.vert)
+	//mat[2][3] is 1 if textures are sampled at the vertex texture coordinates (triangles)
+	mat4 paintMat; //112
+};
+
+layout(set = 0, binding = 0) uniform UBO
+{
+	Paint paint;
+} ubo;
+
+layout(set = 0, binding = 1) uniform sampler2D tex; //for texture drawing
+
+layout(set = 0, binding = 2, std430) readonly buffer Paints
+{
+	Paint paints[];
+} paints;
+
+layout(push_constant) uniform PushConstants
+{
+	uint paint; //index into paints
+} pc;
+
+Paint paint;
+
+float sdroundrect(vec2 pt, vec2 ext, float rad)
+{
+	vec2 ext2 = ext - vec2(rad, rad);
+	vec2 d = abs(pt) - ext2;
+	return min(max(d.x, d.y), 0.0) + length(max(d, 0.0)) - rad;
+}
+
+float scissorMask(vec2 pos)
+{
+	vec2 sc = (abs((mat3(paint.scissorMat) * vec3(pos, 1.0)).xy) - vec2(paint.scissorMat[3]));
+	sc = vec2(0.5, 0.5) - sc * vec2(paint.scissorMat[3][2], paint.scissorMat[3][3]);
+	return clamp(sc.x, 0.0, 1.0) * clamp(sc.y, 0.0, 1.0);
+}
+
+float strokeMask()
+{
+	float strokeMult = paint.paintMat[0][3];
+	return min(1.0, (1.0 - abs(itexcoord.x * 2.0 - 1.0)) * strokeMult) * min(1.0, itexcoord.y);
+}
+
+void main()
+{
+	if(storagePaints) paint = paints.paints[pc.paint];
+	else paint = ubo.paint;
+
+	uint type = (paintType != 0) ? paintType : paint.type;
+	uint texType = (paintTexType != 0) ? paintTexType : paint.texType;
+
+	float scissorAlpha = 1.0;
+	if(scissor) scissorAlpha = scissorMask(ipos);
+	if(edgeAntiAlias && scissorAlpha < 0.5f) discard;
+
+	float strokeAlpha = strokeMask();
+	if(strokeAlpha < strokeThr) discard;
+
+	if(type == TYPE_COLOR)
+	{
+		ocolor = paint.innerColor;
+		if(edgeAntiAlias) ocolor *= strokeAlpha;
+	}
+	else if(type == TYPE_GRADIENT)
+	{
+		vec2 pt = (mat3(paint.paintMat) * vec3(ipos, 1.0)).xy;
+		// vec2 pt = ipos;
+		float ft = paint.scissorMat[1][3];
+		// float fac = sdroundrect(pt, vec2(paint.paintMat[3]), paint.scissorMat[0][3]) / ft;
+		// ocolor = mix(paint.innerColor, paint.outerColor, clamp(0.5 + fac, 0.0, 1.0));
+		// // ocolor = vec4(1.0, 0.0, 1.0, 1.0);
+		//
+		vec2 extent = vec2(paint.paintMat[3][0], paint.paintMat[3][1]);
+		float radius = paint.scissorMat[0][3];
+		float d = clamp((sdroundrect(pt, extent, radius) + ft*0.5) / ft, 0.0, 1.0);
+		ocolor = mix(paint.innerColor,paint.outerColor,d);
+		// ocolor = vec4(radius, extent.x, extent.y, 1.0);
+		if(edgeAntiAlias) ocolor *= strokeAlpha;
+	}
+	else if(type == TYPE_TEXTURE)
+	{
+		//fills and strokes sample in pattern space like the gradients, triangles (text) at
+		//their texture coordinates, which already are mapped
+		bool vertexTexCoords = paint.paintMat[2][3] != 0.0;
+		vec2 uv = itexcoord;
+		if(!vertexTexCoords)
+		{
+			vec2 extent = vec2(paint.paintMat[3][0], paint.paintMat[3][1]);
+			vec2 pt = (mat3(paint.paintMat) * vec3(ipos, 1.0)).xy / extent;
+			uv = paint.outerColor.xy + pt * paint.outerColor.zw;
+		}
+
+		ocolor = texture(tex, uv);
+		if(texType == TEXTYPE_RGBA) ocolor = vec4(ocolor.xyz * ocolor.w, ocolor.w);
+		else if(texType == TEXTYPE_A) ocolor = vec4(ocolor.x);
+		else if(texType == TEXTYPE_SDF)
+		{
+			//signed distance in [-1, 1], the edge is antialiased over about one pixel and
+			//widened by the blur. Limited to the stored range so the quad edges stay clear.
+			float d = ocolor.x;
+			float w = min(fwidth(d) + 2.0 * paint.scissorMat[1][3], 2.0);
+			ocolor = vec4(clamp(d / max(w, 1e-5) + 0.5, 0.0, 1.0));
+		}
+		ocolor = ocolor * paint.innerColor;
+		if(edgeAntiAlias && !vertexTexCoords) ocolor *= strokeAlpha;
+	}
+
+	ocolor *= scissorAlpha;
+}
@@ -1,137 +0,0 @@
-#ifndef BINARY_FILL_FRAG_DATA_HEADER_INCLUDE
-#define BINARY_FILL_FRAG_DATA_HEADER_INCLUDE
-
-#include <stdint.h>
-
-//just check for c++11
-#if defined(__cplusplus) && __cplusplus >= 201103L
-	constexpr	
-#else
-	const
-#endif
-
-uint32_t fill_frag_data[] = {
-	119734787, 65536, 524289, 292, 0, 131089, 1, 393227, 1, 1280527431, 1685353262, 
-	808793134, 0, 196622, 0, 1, 524303, 4, 4, 1852399981, 0, 123, 142, 170, 196624, 
-	4, 7, 196611, 2, 450, 589828, 1096764487, 1935622738, 1918988389, 1600484449, 
-	1684105331, 1868526181, 1667590754, 29556, 589828, 1096764487, 1935622738, 
-	1768186216, 1818191726, 1969712737, 1600481121, 1882206772, 7037793, 262149, 4, 
-	1852399981, 0, 524293, 14, 1869767795, 1919184501, 678716261, 993158774, 
-	993158774, 3879270, 196613, 11, 29808, 196613, 12, 7632997, 196613, 13, 
-	6578546, 458757, 18, 1936286579, 1299345267, 678130529, 993158774, 0, 196613, 
-	17, 7565168, 327685, 21, 1869771891, 1632462187, 2648947, 262149, 23, 
-	846493797, 0, 196613, 29, 100, 196613, 53, 25459, 196613, 56, 5194325, 393222, 
-	56, 0, 2003134838, 1702521171, 0, 327686, 56, 1, 1701869940, 0, 327686, 56, 2, 
-	1417176436, 6647929, 393222, 56, 3, 1701736041, 1819231090, 29295, 393222, 56, 
-	4, 1702131055, 1819231090, 29295, 393222, 56, 5, 1936286579, 1299345267, 29793, 
-	393222, 56, 6, 1852399984, 1952533876, 0, 196613, 58, 7299701, 327685, 117, 
-	1869771891, 1968006507, 29804, 327685, 123, 2019914857, 1919905635, 100, 
-	393221, 141, 1936286579, 1098018675, 1634234476, 0, 262149, 142, 1936683113, 0, 
-	262149, 143, 1634886000, 109, 327685, 154, 1869771891, 1816225131, 6383728, 
-	262149, 170, 1819239279, 29295, 196613, 184, 29808, 196613, 206, 29798, 262149, 
-	209, 1702131813, 29806, 262149, 215, 1768186226, 29557, 196613, 218, 100, 
-	262149, 219, 1634886000, 109, 262149, 221, 1634886000, 109, 262149, 223, 
-	1634886000, 109, 196613, 254, 7890292, 327752, 56, 0, 35, 0, 327752, 56, 1, 35, 
-	8, 327752, 56, 2, 35, 12, 327752, 56, 3, 35, 16, 327752, 56, 4, 35, 32, 262216, 
-	56, 5, 5, 327752, 56, 5, 35, 48, 327752, 56, 5, 7, 16, 262216, 56, 6, 5, 
-	327752, 56, 6, 35, 112, 327752, 56, 6, 7, 16, 196679, 56, 2, 262215, 58, 34, 0, 
-	262215, 58, 33, 0, 262215, 123, 30, 1, 262215, 142, 30, 0, 262215, 147, 1, 0, 
-	262215, 170, 30, 0, 262215, 254, 34, 0, 262215, 254, 33, 1, 131091, 2, 196641, 
-	3, 2, 196630, 6, 32, 262167, 7, 6, 2, 262176, 8, 7, 7, 262176, 9, 7, 6, 393249, 
-	10, 6, 8, 8, 9, 262177, 16, 6, 8, 196641, 20, 6, 262165, 34, 32, 0, 262187, 34, 
-	35, 0, 262187, 34, 38, 1, 262187, 6, 42, 0, 262167, 54, 6, 4, 262168, 55, 54, 
-	4, 589854, 56, 7, 34, 34, 54, 54, 55, 55, 262176, 57, 2, 56, 262203, 57, 58, 2, 
-	262165, 59, 32, 1, 262187, 59, 60, 5, 262176, 61, 2, 55, 262167, 64, 6, 3, 
-	262168, 65, 64, 3, 262187, 6, 66, 1065353216, 262187, 59, 87, 3, 262176, 88, 2, 
-	54, 262187, 6, 95, 1056964608, 327724, 7, 96, 95, 95, 262187, 34, 98, 2, 
-	262176, 99, 2, 6, 262187, 34, 102, 3, 262187, 59, 118, 6, 262187, 59, 119, 0, 
-	262176, 122, 1, 7, 262203, 122, 123, 1, 262176, 124, 1, 6, 262187, 6, 127, 
-	1073741824, 262203, 122, 142, 1, 131092, 146, 196656, 146, 147, 262187, 6, 157, 
-	3212836864, 262187, 59, 162, 1, 262176, 163, 2, 34, 262176, 169, 3, 54, 262203, 
-	169, 170, 3, 262187, 59, 234, 4, 589849, 251, 6, 1, 0, 0, 0, 1, 0, 196635, 252, 
-	251, 262176, 253, 0, 252, 262203, 253, 254, 0, 262187, 59, 258, 2, 262176, 266, 
-	3, 6, 327734, 2, 4, 0, 3, 131320, 5, 262203, 9, 141, 7, 262203, 8, 143, 7, 
-	262203, 9, 154, 7, 262203, 8, 184, 7, 262203, 9, 206, 7, 262203, 8, 209, 7, 
-	262203, 9, 215, 7, 262203, 9, 218, 7, 262203, 8, 219, 7, 262203, 8, 221, 7, 
-	262203, 9, 223, 7, 262205, 7, 144, 142, 196670, 143, 144, 327737, 6, 145, 18, 
-	143, 196670, 141, 145, 262205, 6, 148, 141, 327864, 146, 149, 148, 95, 327847, 
-	146, 150, 147, 149, 196855, 152, 0, 262394, 150, 151, 152, 131320, 151, 65788, 
-	131320, 152, 262201, 6, 155, 21, 196670, 154, 155, 262205, 6, 156, 154, 327864, 
-	146, 158, 156, 157, 196855, 160, 0, 262394, 158, 159, 160, 131320, 159, 65788, 
-	131320, 160, 327745, 163, 164, 58, 162, 262205, 34, 165, 164, 327850, 146, 166, 
-	165, 38, 196855, 168, 0, 262394, 166, 167, 178, 131320, 167, 327745, 88, 171, 
-	58, 87, 262205, 54, 172, 171, 196670, 170, 172, 196855, 174, 0, 262394, 147, 
-	173, 174, 131320, 173, 262205, 6, 175, 154, 262205, 54, 176, 170, 327822, 54, 
-	177, 176, 175, 196670, 170, 177, 131321, 174, 131320, 174, 131321, 168, 131320, 
-	178, 327745, 163, 179, 58, 162, 262205, 34, 180, 179, 327850, 146, 181, 180, 
-	98, 196855, 183, 0, 262394, 181, 182, 245, 131320, 182, 327745, 61, 185, 58, 
-	118, 262205, 55, 186, 185, 393297, 6, 187, 186, 0, 0, 393297, 6, 188, 186, 0, 
-	1, 393297, 6, 189, 186, 0, 2, 393297, 6, 190, 186, 1, 0, 393297, 6, 191, 186, 
-	1, 1, 393297, 6, 192, 186, 1, 2, 393297, 6, 193, 186, 2, 0, 393297, 6, 194, 
-	186, 2, 1, 393297, 6, 195, 186, 2, 2, 393296, 64, 196, 187, 188, 189, 393296, 
-	64, 197, 190, 191, 192, 393296, 64, 198, 193, 194, 195, 393296, 65, 199, 196, 
-	197, 198, 262205, 7, 200, 142, 327761, 6, 201, 200, 0, 327761, 6, 202, 200, 1, 
-	393296, 64, 203, 201, 202, 66, 327825, 64, 204, 199, 203, 458831, 7, 205, 204, 
-	204, 0, 1, 196670, 184, 205, 458817, 99, 207, 58, 60, 162, 102, 262205, 6, 208, 
-	207, 196670, 206, 208, 458817, 99, 210, 58, 118, 87, 35, 262205, 6, 211, 210, 
-	458817, 99, 212, 58, 118, 87, 38, 262205, 6, 213, 212, 327760, 7, 214, 211, 
-	213, 196670, 209, 214, 458817, 99, 216, 58, 60, 119, 102, 262205, 6, 217, 216, 
-	196670, 215, 217, 262205, 7, 220, 184, 196670, 219, 220, 262205, 7, 222, 209, 
-	196670, 221, 222, 262205, 6, 224, 215, 196670, 223, 224, 458809, 6, 225, 14, 
-	219, 221, 223, 262205, 6, 226, 206, 327813, 6, 227, 226, 95, 327809, 6, 228, 
-	225, 227, 262205, 6, 229, 206, 327816, 6, 230, 228, 229, 524300, 6, 231, 1, 43, 
-	230, 42, 66, 196670, 218, 231, 327745, 88, 232, 58, 87, 262205, 54, 233, 232, 
-	327745, 88, 235, 58, 234, 262205, 54, 236, 235, 262205, 6, 237, 218, 458832, 
-	54, 238, 237, 237, 237, 237, 524300, 54, 239, 1, 46, 233, 236, 238, 196670, 
-	170, 239, 196855, 241, 0, 262394, 147, 240, 241, 131320, 240, 262205, 6, 242, 
-	154, 262205, 54, 243, 170, 327822, 54, 244, 243, 242, 196670, 170, 244, 131321, 
-	241, 131320, 241, 131321, 183, 131320, 245, 327745, 163, 246, 58, 162, 262205, 
-	34, 247, 246, 327850, 146, 248, 247, 102, 196855, 250, 0, 262394, 248, 249, 
-	250, 131320, 249, 262205, 252, 255, 254, 262205, 7, 256, 123, 327767, 54, 257, 
-	255, 256, 196670, 170, 257, 327745, 163, 259, 58, 258, 262205, 34, 260, 259, 
-	327850, 146, 261, 260, 38, 196855, 263, 0, 262394, 261, 262, 276, 131320, 262, 
-	262205, 54, 264, 170, 524367, 64, 265, 264, 264, 0, 1, 2, 327745, 266, 267, 
-	170, 102, 262205, 6, 268, 267, 327822, 64, 269, 265, 268, 327745, 266, 270, 
-	170, 102, 262205, 6, 271, 270, 327761, 6, 272, 269, 0, 327761, 6, 273, 269, 1, 
-	327761, 6, 274, 269, 2, 458832, 54, 275, 272, 273, 274, 271, 196670, 170, 275, 
-	131321, 263, 131320, 276, 327745, 163, 277, 58, 258, 262205, 34, 278, 277, 
-	327850, 146, 279, 278, 98, 196855, 281, 0, 262394, 279, 280, 281, 131320, 280, 
-	327745, 266, 282, 170, 35, 262205, 6, 283, 282, 458832, 54, 284, 283, 283, 283, 
-	283, 196670, 170, 284, 131321, 281, 131320, 281, 131321, 263, 131320, 263, 
-	262205, 54, 285, 170, 327745, 88, 286, 58, 87, 262205, 54, 287, 286, 327813, 
-	54, 288, 285, 287, 196670, 170, 288, 131321, 250, 131320, 250, 131321, 183, 
-	131320, 183, 131321, 168, 131320, 168, 262205, 6, 289, 141, 262205, 54, 290, 
-	170, 327822, 54, 291, 290, 289, 196670, 170, 291, 65789, 65592, 327734, 6, 14, 
-	0, 10, 196663, 8, 11, 196663, 8, 12, 196663, 9, 13, 131320, 15, 262203, 8, 23, 
-	7, 262203, 8, 29, 7, 262205, 7, 24, 12, 262205, 6, 25, 13, 262205, 6, 26, 13, 
-	327760, 7, 27, 25, 26, 327811, 7, 28, 24, 27, 196670, 23, 28, 262205, 7, 30, 
-	11, 393228, 7, 31, 1, 4, 30, 262205, 7, 32, 23, 327811, 7, 33, 31, 32, 196670, 
-	29, 33, 327745, 9, 36, 29, 35, 262205, 6, 37, 36, 327745, 9, 39, 29, 38, 
-	262205, 6, 40, 39, 458764, 6, 41, 1, 40, 37, 40, 458764, 6, 43, 1, 37, 41, 42, 
-	262205, 7, 44, 29, 327760, 7, 45, 42, 42, 458764, 7, 46, 1, 40, 44, 45, 393228, 
-	6, 47, 1, 66, 46, 327809, 6, 48, 43, 47, 262205, 6, 49, 13, 327811, 6, 50, 48, 
-	49, 131326, 50, 65592, 327734, 6, 18, 0, 16, 196663, 8, 17, 131320, 19, 262203, 
-	8, 53, 7, 327745, 61, 62, 58, 60, 262205, 55, 63, 62, 393297, 6, 67, 63, 0, 0, 
-	393297, 6, 68, 63, 0, 1, 393297, 6, 69, 63, 0, 2, 393297, 6, 70, 63, 1, 0, 
-	393297, 6, 71, 63, 1, 1, 393297, 6, 72, 63, 1, 2, 393297, 6, 73, 63, 2, 0, 
-	393297, 6, 74, 63, 2, 1, 393297, 6, 75, 63, 2, 2, 393296, 64, 76, 67, 68, 69, 
-	393296, 64, 77, 70, 71, 72, 393296, 64, 78, 73, 74, 75, 393296, 65, 79, 76, 77, 
-	78, 262205, 7, 80, 17, 327761, 6, 81, 80, 0, 327761, 6, 82, 80, 1, 393296, 64, 
-	83, 81, 82, 66, 327825, 64, 84, 79, 83, 458831, 7, 85, 84, 84, 0, 1, 393228, 7, 
-	86, 1, 4, 85, 393281, 88, 89, 58, 60, 87, 262205, 54, 90, 89, 327761, 6, 91, 
-	90, 0, 327761, 6, 92, 90, 1, 327760, 7, 93, 91, 92, 327811, 7, 94, 86, 93, 
-	196670, 53, 94, 262205, 7, 97, 53, 458817, 99, 100, 58, 60, 87, 98, 262205, 6, 
-	101, 100, 458817, 99, 103, 58, 60, 87, 102, 262205, 6, 104, 103, 327760, 7, 
-	105, 101, 104, 327813, 7, 106, 97, 105, 327811, 7, 107, 96, 106, 196670, 53, 
-	107, 327745, 9, 108, 53, 35, 262205, 6, 109, 108, 524300, 6, 110, 1, 43, 109, 
-	42, 66, 327745, 9, 111, 53, 38, 262205, 6, 112, 111, 524300, 6, 113, 1, 43, 
-	112, 42, 66, 327813, 6, 114, 110, 113, 131326, 114, 65592, 327734, 6, 21, 0, 
-	20, 131320, 22, 262203, 9, 117, 7, 458817, 99, 120, 58, 118, 119, 102, 262205, 
-	6, 121, 120, 196670, 117, 121, 327745, 124, 125, 123, 35, 262205, 6, 126, 125, 
-	327813, 6, 128, 126, 127, 327811, 6, 129, 128, 66, 393228, 6, 130, 1, 4, 129, 
-	327811, 6, 131, 66, 130, 262205, 6, 132, 117, 327813, 6, 133, 131, 132, 458764, 
-	6, 134, 1, 37, 66, 133, 327745, 124, 135, 123, 38, 262205, 6, 136, 135, 458764, 
-	6, 137, 1, 37, 66, 136, 327813, 6, 138, 134, 137, 131326, 138, 65592
-};
-
-#endif //header guard
\ No newline at end of file
@@ -1,26 +1,44 @@
 #version 450
 
-#extension GL_ARB_separate_shader_objects : enable
-#extension GL_ARB_shading_language_420pack : enable
-
-layout(location = 0) in vec2 ivertex;
-layout(location = 1) in vec2 itexcoord;
-
-layout(location = 0) out vec2 opos;
-layout(location = 1) out vec2 otexcoord;
-
-layout(set = 0, binding = 0) uniform UBO
-{
-	vec2 viewSize;
-} ubo;
-
-void main()
-{
-	//just perform interpolation for texture coords and screen position
-	otexcoord = itexcoord;
-	opos = ivertex;
-
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+//see fill.frag
+layout(constant_id = 1) const bool storagePaints = false;
+
+layout(location = 0) in vec2 ivertex;
+layout(location = 1) in vec2 itexcoord;
+
+layout(location = 0) out vec2 opos;
+layout(location = 1) out vec2 otexcoord;
+
+layout(set = 0, binding = 0) uniform UBO
+{
+	vec2 viewSize;
+} ubo;
+
+//only the beginning of the paint struct from fill.frag is needed.
+//the paint stride is 176 bytes: vec2, 2 uint, 2 vec4, 2 mat4
+layout(set = 0, binding = 2, std430) readonly buffer Paints
+{
+	vec4 data[]; //11 vec4 per paint, viewSize is the first vec2
+} paints;
+
+layout(push_constant) uniform PushConstants
+{
+	uint paint; //index into paints
+} pc;
+
+void main()
+{
+	vec2 viewSize = ubo.viewSize;
+	if(storagePaints) viewSize = paints.data[pc.paint * 11].xy;
+
+	//just perform interpolation for texture coords and screen position
+	otexcoord = itexcoord;
+	opos = ivertex;
+
 	//normalize the vertex coords from ([0, width], [0, height]) to ([-1, 1], [-1, 1]).
-	//unlike in opengl there is no y inversion needed.
-	gl_Position = vec4(2.0 * ivertex / ubo.viewSize - 1.0, 0.0, 1.0);
-}
+	//unlike in opengl there is no y inversion needed.
+	gl_Position = vec4(2.0 * ivertex / viewSize - 1.0, 0.0, 1.0);
+}
@@ -1,43 +0,0 @@
-#ifndef BINARY_FILL_VERT_DATA_HEADER_INCLUDE
-#define BINARY_FILL_VERT_DATA_HEADER_INCLUDE
-
-#include <stdint.h>
-
-//just check for c++11
-#if defined(__cplusplus) && __cplusplus >= 201103L
-	constexpr	
-#else
-	const
-#endif
-
-uint32_t fill_vert_data[] = {
-	119734787, 65536, 524289, 44, 0, 131089, 1, 393227, 1, 1280527431, 1685353262, 
-	808793134, 0, 196622, 0, 1, 655375, 0, 4, 1852399981, 0, 9, 11, 13, 14, 22, 
-	196611, 2, 450, 589828, 1096764487, 1935622738, 1918988389, 1600484449, 
-	1684105331, 1868526181, 1667590754, 29556, 589828, 1096764487, 1935622738, 
-	1768186216, 1818191726, 1969712737, 1600481121, 1882206772, 7037793, 262149, 4, 
-	1852399981, 0, 327685, 9, 2019914863, 1919905635, 100, 327685, 11, 2019914857, 
-	1919905635, 100, 262149, 13, 1936683119, 0, 262149, 14, 1919252073, 7890292, 
-	393221, 20, 1348430951, 1700164197, 2019914866, 0, 393222, 20, 0, 1348430951, 
-	1953067887, 7237481, 458758, 20, 1, 1348430951, 1953393007, 1702521171, 0, 
-	458758, 20, 2, 1130327143, 1148217708, 1635021673, 6644590, 458758, 20, 3, 
-	1130327143, 1147956341, 1635021673, 6644590, 196613, 22, 0, 196613, 28, 
-	5194325, 393222, 28, 0, 2003134838, 1702521171, 0, 196613, 30, 7299701, 262215, 
-	9, 30, 1, 262215, 11, 30, 1, 262215, 13, 30, 0, 262215, 14, 30, 0, 327752, 20, 
-	0, 11, 0, 327752, 20, 1, 11, 1, 327752, 20, 2, 11, 3, 327752, 20, 3, 11, 4, 
-	196679, 20, 2, 327752, 28, 0, 35, 0, 196679, 28, 2, 262215, 30, 34, 0, 262215, 
-	30, 33, 0, 131091, 2, 196641, 3, 2, 196630, 6, 32, 262167, 7, 6, 2, 262176, 8, 
-	3, 7, 262203, 8, 9, 3, 262176, 10, 1, 7, 262203, 10, 11, 1, 262203, 8, 13, 3, 
-	262203, 10, 14, 1, 262167, 16, 6, 4, 262165, 17, 32, 0, 262187, 17, 18, 1, 
-	262172, 19, 6, 18, 393246, 20, 16, 6, 19, 19, 262176, 21, 3, 20, 262203, 21, 
-	22, 3, 262165, 23, 32, 1, 262187, 23, 24, 0, 262187, 6, 25, 1073741824, 196638, 
-	28, 7, 262176, 29, 2, 28, 262203, 29, 30, 2, 262176, 31, 2, 7, 262187, 6, 35, 
-	1065353216, 262187, 6, 38, 0, 262176, 42, 3, 16, 327734, 2, 4, 0, 3, 131320, 5, 
-	262205, 7, 12, 11, 196670, 9, 12, 262205, 7, 15, 14, 196670, 13, 15, 262205, 7, 
-	26, 14, 327822, 7, 27, 26, 25, 327745, 31, 32, 30, 24, 262205, 7, 33, 32, 
-	327816, 7, 34, 27, 33, 327760, 7, 36, 35, 35, 327811, 7, 37, 34, 36, 327761, 6, 
-	39, 37, 0, 327761, 6, 40, 37, 1, 458832, 16, 41, 39, 40, 38, 35, 327745, 42, 
-	43, 22, 24, 196670, 43, 41, 65789, 65592
-};
-
-#endif //header guard
\ No newline at end of file
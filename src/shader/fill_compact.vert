@@ -0,0 +1,62 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+//fill.vert for compact vertices (RendererSettings::compactVertices).
+//The position is given in fixed point steps relative to the origin of the draw,
+//both are stored in the free members of the paint matrix (see fill.frag).
+
+//see fill.frag
+layout(constant_id = 1) const bool storagePaints = false;
+
+layout(location = 0) in ivec2 ivertex;
+layout(location = 1) in vec2 itexcoord;
+
+layout(location = 0) out vec2 opos;
+layout(location = 1) out vec2 otexcoord;
+
+//the paint struct from fill.frag up to the paint matrix
+layout(set = 0, binding = 0) uniform UBO
+{
+	vec2 viewSize;
+	uint type;
+	uint texType;
+	vec4 innerColor;
+	vec4 outerColor;
+	mat4 scissorMat;
+	mat4 paintMat;
+} ubo;
+
+//the paint stride is 176 bytes: vec2, 2 uint, 2 vec4, 2 mat4
+layout(set = 0, binding = 2, std430) readonly buffer Paints
+{
+	vec4 data[]; //11 vec4 per paint, the paint matrix columns are 7 to 10
+} paints;
+
+layout(push_constant) uniform PushConstants
+{
+	uint paint; //index into paints
+} pc;
+
+void main()
+{
+	vec2 viewSize = ubo.viewSize;
+	vec2 origin = ubo.paintMat[3].zw;
+	float step = ubo.paintMat[1].w;
+	if(storagePaints) {
+		uint base = pc.paint * 11;
+		viewSize = paints.data[base].xy;
+		origin = paints.data[base + 10].zw;
+		step = paints.data[base + 8].w;
+	}
+
+	vec2 pos = origin + vec2(ivertex) * step;
+
+	//just perform interpolation for texture coords and screen position
+	otexcoord = itexcoord;
+	opos = pos;
+
+	//normalize the vertex coords from ([0, width], [0, height]) to ([-1, 1], [-1, 1]).
+	gl_Position = vec4(2.0 * pos / viewSize - 1.0, 0.0, 1.0);
+}
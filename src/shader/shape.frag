@@ -0,0 +1,99 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+//Fragment shader for the instanced shapes of shape.vert.
+//Uses the same paint parameters as fill.frag but computes the edge coverage from the
+//distance to the rounded rect instead of interpolated fringe vertices.
+//Only color and gradient paints are drawn as shapes.
+
+#define TYPE_COLOR 1
+#define TYPE_GRADIENT 2
+
+//see fill.frag
+layout(constant_id = 0) const bool edgeAntiAlias = true;
+layout(constant_id = 1) const bool storagePaints = false;
+layout(constant_id = 2) const uint paintType = 0;
+layout(constant_id = 4) const bool scissor = true;
+
+layout(location = 0) in vec2 ipos;
+layout(location = 1) in vec2 ilocal;
+layout(location = 2) flat in vec4 ishape;
+layout(location = 3) flat in uint ipaint;
+
+layout(location = 0) out vec4 ocolor;
+
+//see fill.frag for the meaning of the members
+struct Paint
+{
+	vec2 viewSize;
+	uint type;
+	uint texType;
+	vec4 innerColor;
+	vec4 outerColor;
+	mat4 scissorMat;
+	mat4 paintMat;
+};
+
+layout(set = 0, binding = 0) uniform UBO
+{
+	Paint paint;
+} ubo;
+
+//the paint is selected per instance and not by the push constant so shapes with
+//different paints can be drawn in one call
+layout(set = 0, binding = 2, std430) readonly buffer Paints
+{
+	Paint paints[];
+} paints;
+
+Paint paint;
+
+float sdroundrect(vec2 pt, vec2 ext, float rad)
+{
+	vec2 ext2 = ext - vec2(rad, rad);
+	vec2 d = abs(pt) - ext2;
+	return min(max(d.x, d.y), 0.0) + length(max(d, 0.0)) - rad;
+}
+
+float scissorMask(vec2 pos)
+{
+	vec2 sc = (abs((mat3(paint.scissorMat) * vec3(pos, 1.0)).xy) - vec2(paint.scissorMat[3]));
+	sc = vec2(0.5, 0.5) - sc * vec2(paint.scissorMat[3][2], paint.scissorMat[3][3]);
+	return clamp(sc.x, 0.0, 1.0) * clamp(sc.y, 0.0, 1.0);
+}
+
+void main()
+{
+	if(storagePaints) paint = paints.paints[ipaint];
+	else paint = ubo.paint;
+
+	uint type = (paintType != 0) ? paintType : paint.type;
+
+	float scissorAlpha = 1.0;
+	if(scissor) scissorAlpha = scissorMask(ipos);
+	if(edgeAntiAlias && scissorAlpha < 0.5f) discard;
+
+	//like the nanovg fringe the edge is centered on the outline
+	float d = sdroundrect(ilocal, ishape.xy, ishape.z);
+	float coverage = 1.0;
+	if(edgeAntiAlias) coverage = clamp(0.5 - d / ishape.w, 0.0, 1.0);
+	else if(d > 0.0) discard;
+
+	if(type == TYPE_COLOR)
+	{
+		ocolor = paint.innerColor;
+	}
+	else if(type == TYPE_GRADIENT)
+	{
+		vec2 pt = (mat3(paint.paintMat) * vec3(ipos, 1.0)).xy;
+		float ft = paint.scissorMat[1][3];
+		vec2 extent = vec2(paint.paintMat[3][0], paint.paintMat[3][1]);
+		float radius = paint.scissorMat[0][3];
+		float t = clamp((sdroundrect(pt, extent, radius) + ft*0.5) / ft, 0.0, 1.0);
+		ocolor = mix(paint.innerColor, paint.outerColor, t);
+	}
+
+	ocolor *= coverage * scissorAlpha;
+}
@@ -0,0 +1,57 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+//Instanced filled rounded rects and circles, one instance per shape.
+//Draws a quad (triangle strip of 4 vertices) around the shape, expanded by the fringe.
+//The coverage is computed from the distance to the shape in shape.frag.
+
+//see fill.frag
+layout(constant_id = 0) const bool edgeAntiAlias = true;
+layout(constant_id = 1) const bool storagePaints = false;
+
+//the instance data, see ShapeInstance in renderer.cpp
+layout(location = 0) in vec4 irect; //center in screen space, half extent in local space
+layout(location = 1) in vec4 ixform; //the linear part of the local to screen transform
+layout(location = 2) in vec2 iparams; //corner radius in local space, fringe in pixels
+layout(location = 3) in uint ipaint; //index into paints when using storage paints
+
+layout(location = 0) out vec2 opos;
+layout(location = 1) out vec2 olocal;
+layout(location = 2) flat out vec4 oshape; //half extent, radius, fringe in local space
+layout(location = 3) flat out uint opaint;
+
+layout(set = 0, binding = 0) uniform UBO
+{
+	vec2 viewSize;
+} ubo;
+
+//the paint stride is 176 bytes: vec2, 2 uint, 2 vec4, 2 mat4
+layout(set = 0, binding = 2, std430) readonly buffer Paints
+{
+	vec4 data[]; //11 vec4 per paint, viewSize is the first vec2
+} paints;
+
+void main()
+{
+	vec2 viewSize = ubo.viewSize;
+	if(storagePaints) viewSize = paints.data[ipaint * 11].xy;
+
+	//the transform is a similarity, so its scale is the length of one axis
+	mat2 xform = mat2(ixform.xy, ixform.zw);
+	float scale = length(ixform.xy);
+	float fringe = edgeAntiAlias ? iparams.y / scale : 0.0;
+
+	vec2 corner = vec2((gl_VertexIndex & 1) != 0 ? 1.0 : -1.0,
+		(gl_VertexIndex & 2) != 0 ? 1.0 : -1.0);
+	vec2 local = corner * (irect.zw + fringe);
+	vec2 pos = irect.xy + xform * local;
+
+	opos = pos;
+	olocal = local;
+	oshape = vec4(irect.zw, iparams.x, fringe);
+	opaint = ipaint;
+
+	gl_Position = vec4(2.0 * pos / viewSize - 1.0, 0.0, 1.0);
+}
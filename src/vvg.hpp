@@ -13,40 +13,194 @@
 #include <vpp/pipeline.hpp>
 #include <vpp/descriptor.hpp>
 
+#include <memory>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
 typedef struct NVGcontext NVGcontext;
 typedef struct NVGvertex NVGvertex;
 typedef struct NVGpaint NVGpaint;
 typedef struct NVGpath NVGpath;
 typedef struct NVGscissor NVGscissor;
+typedef struct NVGshape NVGshape;
 
 /// Vulkan Vector Graphics
 namespace vvg {
 
 struct DrawData;
+struct Path;
+struct DrawCall;
+struct Frame;
+struct RenderTarget;
+struct ScenePart;
+class WorkerPool;
+class DrawList;
+struct DrawListData;
+struct RendererShared;
+struct VertexOrigin;
+struct DrawRecord;
+struct Profiler;
+struct AtlasPage;
+enum class PipelineType : std::uint8_t;
+
+/// Optional settings that can be passed to a Renderer on construction.
+struct RendererSettings {
+	/// How many frames can be in flight at the same time, i.e. how many frames the cpu
+	/// can build and submit before it has to wait for the device to finish the oldest one.
+	/// Every frame in flight has its own uniform, vertex and descriptor resources.
+	/// Must not be 0. A value of 1 results in the old blocking behaviour.
+	unsigned int framesInFlight = 2;
+
+	/// Whether the paint parameters are read from one storage buffer indexed by a push
+	/// constant instead of binding them as uniform buffer with a dynamic offset.
+	/// Identical paints in one frame are only uploaded once in both cases but
+	/// storage paints are tightly packed.
+	bool storagePaints = false;
+
+	/// Whether concave paths are filled correctly using the stencil buffer (stencil-then-cover).
+	/// Requires the render pass to have a stencil attachment as second attachment, which
+	/// is always the case when rendering on a swapchain.
+	/// Convex paths are always drawn directly without touching the stencil buffer.
+	bool stencilFills = true;
+
+	/// Whether edges are antialiased with the fringe geometry nanovg generates around
+	/// every path, like NVG_ANTIALIAS for the GL backends. The contexts created for this
+	/// Renderer let nanovg generate the fringes only if this is set.
+	/// When multisampling, fringes are not generated (see samples) but the filled rects,
+	/// rounded rects and circles drawn as instances still use their analytic coverage.
+	bool edgeAntiAlias = true;
+
+	/// Whether the initial uploads of new textures are done on a transfer queue of
+	/// another queue family (if the device has one) so they run in parallel
+	/// to rendering. The frame using them waits on a semaphore.
+	bool asyncUploads = true;
+
+	/// The number of threads (including the calling one) that record the draws of large
+	/// frames into secondary command buffers in parallel. 1 records everything on the
+	/// calling thread directly into the primary command buffer.
+	unsigned int recordThreads = 1;
+
+	/// Whether vertices are stored in 8 instead of 16 bytes: the position as 16 bit fixed
+	/// point relative to an origin per draw and the uv as unorm16. Draws visible in a view
+	/// of up to 4096 pixels keep a precision of 1/16 pixel, larger ones get coarser.
+	/// Halves the vertex bandwidth, mainly useful for bandwidth bound integrated gpus.
+	bool compactVertices = false;
+
+	/// Whether the contexts created for this Renderer store every glyph once as signed
+	/// distance field (r8Snorm texture) that is scaled to all sizes and blurred in the
+	/// fragment shader, instead of rasterizing it again for every size and blur.
+	/// Saves atlas space and uploads when text is zoomed or animated. Very small text
+	/// is slightly softer and blurs are limited to a few pixels.
+	bool sdfText = false;
+
+	/// The file the pipeline cache is loaded from on construction and saved to on
+	/// destruction. Empty means no file is used. Since the cache data is only valid
+	/// for one device and driver, applications might want to use one file per device.
+	/// Failing to read or write the file only results in a warning.
+	std::string pipelineCachePath;
+
+	/// Initial pipeline cache data, e.g. previously retrieved using
+	/// Renderer::pipelineCacheData. Used instead of the file if not empty.
+	/// Data of another device or driver version is ignored by the driver.
+	std::vector<std::uint8_t> pipelineCacheData;
+
+	/// Whether all pipeline variants that can be used with these settings are created
+	/// on construction so no frame has to wait for a pipeline compilation later on.
+	/// Otherwise they are created when first used.
+	bool prewarmPipelines = false;
+
+	/// Whether the pipelines are prewarmed on a background thread instead of blocking
+	/// the construction. Draws needing a pipeline that is not ready yet create it
+	/// themselves. Only has an effect together with prewarmPipelines.
+	/// The Renderer must not be moved while the background thread runs.
+	bool asyncPipelines = false;
+
+	/// The number of samples per pixel, 1, 2, 4 or 8 (if supported by the device).
+	/// With more than one sample, edges are antialiased by multisampling instead of the
+	/// fringe geometry nanovg generates around every path, so the contexts skip it
+	/// regardless of edgeAntiAlias.
+	/// When rendering on a swapchain, the image is drawn into a transient multisampled
+	/// attachment (lazily allocated if possible) that is resolved at the end of the render
+	/// pass. When rendering into a framebuffer, its render pass must use this sample count.
+	/// Cheaper than the fringe triangles on tile-based gpus.
+	unsigned int samples = 1;
+
+	/// Whether only the regions that changed since the last frame are redrawn when
+	/// rendering on a swapchain. The draws of every frame are compared with the ones of
+	/// the previous frame (paint, texture and vertices) and only the union of the bounds of
+	/// the changed ones is rendered, the rest of the swapchain image is kept.
+	/// Frames without any changes are not rendered and presented at all.
+	/// Relies on the swapchain images keeping their contents between presents.
+	/// Has no effect with multisampling, offscreen or when rendering into a framebuffer.
+	/// Frames that draw scenes are always rendered completely.
+	bool dirtyRegions = false;
+
+	/// Whether the changed region is passed to the presentation engine when using
+	/// dirtyRegions. The device must have been created with the
+	/// VK_KHR_incremental_present extension.
+	bool incrementalPresent = false;
+
+	/// Whether counters and timings are collected for every flushed frame, see
+	/// Renderer::stats. The device time is measured with timestamp queries around the
+	/// commands of the frame. Cheap enough to be used in production builds.
+	bool profiling = false;
+
+	/// A file the stats of every profiled frame are written to as one line of comma
+	/// separated values, in the order of the FrameStats members. Empty for none.
+	std::string profilingTrace;
+
+	/// Textures of at most this width and height that are created with atlas allowed
+	/// (the nanovg images without repeat or mipmap flags) are packed into shared atlas
+	/// pages. Draws of different images of one page can then be batched if they also
+	/// share the paint, e.g. triangles with the same color or image patterns with the
+	/// same transform. Every image is padded with its border texels so linear filtering
+	/// does not bleed. 0 disables it.
+	unsigned int atlasSize = 0;
+
+	/// The width and height of the atlas pages. The space of deleted images is only
+	/// reused once all images of a page are deleted.
+	unsigned int atlasPageSize = 1024;
+};
 
-// TODO: make work async, e.g. let texture store a work pointer and only finish it when used.
 /// Represents a vulkan texture.
 /// Can be retrieved from the nanovg texture handle using the associated renderer.
+/// The image is device local and has optimal tiling, its contents are uploaded by the
+/// Renderer (see Renderer::createTexture, Renderer::updateTexture).
 class Texture : public vpp::ResourceReference<Texture> {
 public:
 	Texture() = default;
+	/// If multiple queue families are given, the image is shared concurrently between them.
+	/// The image flags are the nanovg ones (NVGimageFlags), with NVG_IMAGE_GENERATE_MIPMAPS
+	/// the image has a full mipmap chain which is generated by the Renderer when uploading.
 	Texture(const vpp::Device& dev, unsigned int xid, const vk::Extent2D& size,
-		vk::Format format, const std::uint8_t* data = nullptr);
+		vk::Format format, nytl::Span<const std::uint32_t> queueFamilies = {},
+		int imageFlags = 0);
+
+	/// Creates a texture that is stored in the given region of an atlas page, see
+	/// RendererSettings::atlasSize. It has no own image, the page is sampled instead.
+	Texture(unsigned int xid, const Texture& page, const vk::Rect2D& region,
+		int imageFlags = 0);
 	~Texture() = default;
 
 	Texture(Texture&& other) noexcept = default;
 	Texture& operator=(Texture&& other) noexcept = default;
 
-	///Updates the texture data at the given position and the given size.
-	///Note that the given data is NOT tightly packed but must hold data for the whole texture
-	///extent.
-	void update(const vk::Offset2D& offset, const vk::Extent2D& size, const std::uint8_t& data);
-
 	unsigned int id() const { return id_; }
 	unsigned int width() const { return width_; }
 	unsigned int height() const { return height_; }
 	vk::Format format() const { return format_; }
 	const vpp::ViewableImage& viewableImage() const { return viewableImage_; }
+	int flags() const { return flags_; }
+	unsigned int levels() const { return levels_; }
+
+	/// The id of the atlas page the texture is stored in or 0 if it has its own image.
+	unsigned int page() const { return page_; }
+
+	/// The region of the atlas page the texture is stored in, without the padding.
+	const vk::Rect2D& region() const { return region_; }
 
 	const auto& resourceRef() const { return viewableImage_; }
 
@@ -56,9 +210,63 @@ protected:
 	unsigned int id_;
 	unsigned int width_;
 	unsigned int height_;
+	unsigned int page_ {};
+	vk::Rect2D region_ {};
+	int flags_ {};
+	unsigned int levels_ {1};
+};
+
+/// Retained draws that can be rendered every frame without tessellating, uploading and
+/// recording them again. Filled using Renderer::capture and rendered using Renderer::draw.
+/// A scene consists of multiple independent parts (e.g. the layers of a screen), only the
+/// parts whose contents change have to be captured again.
+/// The draws are stored in device local buffers and a secondary command buffer.
+/// Since the viewport size is part of the captured draws, scenes must be captured
+/// again when the render target is resized. Textures used by a scene must not be deleted
+/// while the scene is still drawn. Must not outlive the Renderer that captured it.
+class Scene {
+public:
+	/// Returns the number of parts, i.e. the highest captured part index + 1.
+	std::size_t parts() const { return parts_.size(); }
+
+	/// Removes the given part or all parts from the scene.
+	/// Frames in flight that render them are not affected.
+	void clear(unsigned int part) { if(part < parts_.size()) parts_[part] = {}; }
+	void clear() { parts_.clear(); }
+
+protected:
+	friend class Renderer;
+	std::vector<std::shared_ptr<ScenePart>> parts_;
+};
+
+/// Counters and timings of one frame, see RendererSettings::profiling.
+struct FrameStats {
+	std::uint64_t frame {}; // the number of the frame
+	unsigned int draws {}; // fills, strokes, triangles and shapes that were not culled
+	unsigned int drawCalls {}; // recorded draw calls after batching
+	unsigned int pipelineBinds {};
+	unsigned int descriptorSets {}; // descriptor sets written for the frame
+	std::size_t vertexBytes {}; // vertex and shape data
+	std::size_t indexBytes {};
+	std::size_t uniformBytes {}; // paint data
+	std::size_t uploadBytes {}; // texture and scene data staged for uploading
+	double buildTime {}; // cpu milliseconds from start to flush, includes tessellating
+	double flushTime {}; // cpu milliseconds spent in flush
+	double gpuTime {}; // device milliseconds for the commands of the frame, -1 if unknown
+};
+
+/// The pixels of a frame rendered by an offscreen Renderer, see Renderer::readback.
+/// The data is copied into a host visible buffer by the device, it can only be read
+/// once the fence is signaled. It stays valid until the frame slot is used again,
+/// i.e. until framesInFlight more frames were started. The fence is only reset when the
+/// slot is submitted again, waiting for it never blocks longer than for that frame.
+struct Readback {
+	std::uint64_t frame {}; // the number of the frame, 0 if no frame was flushed
+	vk::Fence fence {}; // signaled when the frame was rendered and copied
+	const std::uint8_t* data {}; // tightly packed rows in the format of the Renderer
+	std::size_t size {}; // the size of the data in bytes
 };
 
-// TODO: how to handle swapchain resizes?
 /// The Renderer class implements the nanovg backend for vulkan using the vpp library.
 /// It can be used to gain more control over the rendering e.g. to just record the required
 /// commands to a given command buffer instead of executing them.
@@ -68,17 +276,33 @@ protected:
 /// it just stores all draw calls and only renders them once finish is called.
 /// It can either render on a vulkan Swapchain for which it uses the SwapchainRenderer class
 /// or directly on a framebuffer, then it uses a plain CommandBuffer.
+/// Multiple nanovg contexts on different threads can draw using one Renderer,
+/// see createSharedContext. The texture functions are synchronized for this.
+/// The swapchain can use any present mode, flush only blocks when all frame slots are
+/// in use. When it is recreated (e.g. on a window resize) resize must be called.
 class Renderer : public vpp::Resource {
 public:
 	Renderer() = default;
-	Renderer(const vpp::Swapchain& swapchain, const vpp::Queue* presentQueue = {});
+	Renderer(const vpp::Swapchain& swapchain, const vpp::Queue* presentQueue = {},
+		const RendererSettings& settings = {});
 
 	/// Constructs the Renderer for a vulkan framebuffer that can be rendered to with the given
 	/// render pass.
-	Renderer(const vpp::Framebuffer& fb, vk::RenderPass renderPass);
+	Renderer(const vpp::Framebuffer& fb, vk::RenderPass renderPass,
+		const RendererSettings& settings = {});
+
+	/// Constructs an offscreen Renderer that renders into its own images of the given
+	/// size and format, one per frame in flight, so up to framesInFlight frames are
+	/// rendered at the same time. Every flushed frame is copied into a host visible
+	/// buffer which can be retrieved using readback without waiting for the device.
+	/// The format must have 4 bytes per pixel (or 1 for r8Unorm) and support
+	/// color attachment and transfer src usage.
+	Renderer(const vpp::Device& dev, vk::Format format, const vk::Extent2D& size,
+		const RendererSettings& settings = {});
 	virtual ~Renderer();
 
-	/// Returns the texture with the given id.
+	/// Returns the texture with the given id or nullptr if there is none.
+	/// Constant time, the id encodes the slot of the texture.
 	const Texture* texture(unsigned int id) const;
 	Texture* texture(unsigned int id);
 
@@ -94,93 +318,338 @@ public:
 	void triangles(const NVGpaint& paint, const NVGscissor& scissor,
 		nytl::Span<const NVGvertex> verts);
 
+	/// Fills the given rounded rect as one instance of the shape pipeline, the edge is
+	/// antialiased using its distance field instead of fringe geometry.
+	/// Returns false if the paint can't be drawn this way (image patterns), nothing
+	/// is drawn then and the shape must be filled as path.
+	bool fillShape(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
+		const NVGshape& shape);
+
 	/// Start a new frame. Sets the viewport parameters.
 	/// Effectively resets all stored draw commands.
 	/// Will invalidate all commandBuffers that were recorded before.
 	void start(unsigned int width, unsigned int height);
 
 	/// Cancel the current frame.
+	/// Discards all draws since the last start call.
 	void cancel();
 
+	/// Moves all draws since the last start call into the given part of the given scene
+	/// instead of rendering them in this frame. The previous contents of the part are
+	/// replaced, the other parts stay untouched. Captured data is uploaded with the next flush.
+	/// Afterwards more draws can be made for this frame as usual.
+	void capture(Scene& scene, unsigned int part = 0);
+
+	/// Renders all parts of the given scene in the current frame.
+	/// Scenes are rendered before the other draws of the frame in the order
+	/// they were drawn. Only rendered by flush, not by record.
+	void draw(const Scene& scene);
+
 	/// Flushs the current frame, i.e. renders it on the render target.
-	/// This call will block until the device has finished its commands.
+	/// Also renders the draw lists submitted by shared contexts since the last flush.
+	/// This call will only block if all frame slots are still in use by the device.
+	/// Use wait() to make sure that all submitted frames have finished rendering.
 	void flush();
 
+	/// Blocks until the device has finished all frames submitted by this Renderer.
+	void wait();
+
+	/// Recreates the render targets after the swapchain was recreated or resized, e.g.
+	/// using vpp::Swapchain::resize. Waits for the frames in flight but keeps the
+	/// pipelines (viewport and scissor are dynamic), textures and buffers. The render pass
+	/// and the pipelines are only recreated if the format of the swapchain changed.
+	/// Scenes have to be captured again for the new size.
+	/// Throws if this Renderer does not render on a swapchain.
+	void resize();
+
+	/// Whether the swapchain was reported out of date or suboptimal since the last resize,
+	/// e.g. because the window was resized. Frames flushed while it is out of date are
+	/// discarded, so the application should recreate the swapchain and call resize.
+	bool outOfDate() const { return outOfDate_; }
+
+	/// Returns the stats of the last profiled frame the device has finished, see
+	/// RendererSettings::profiling. Frames are known to be finished when their frame slot
+	/// is used again or after wait, so these are framesInFlight frames old.
+	const FrameStats& stats() const { return stats_; }
+
+	/// Returns the readback of the last flushed frame of an offscreen Renderer.
+	/// Does not block, wait for the returned fence before reading the data.
+	/// Offscreen frames are rendered and read back on every flush, even if empty.
+	/// Returns an empty Readback if this is not an offscreen Renderer.
+	Readback readback() const;
+
 	/// Records all given draw commands since the last start frame call to the given
 	/// command buffer. Note that the caller must assure that the commandBuffer is in a valid state
 	/// for this Renderer to record its commands (i.e. recording state, matching renderPass).
 	/// All commandBuffers will remain valid until the next draw (fill/stroie/triangles) call
 	/// or until start is called.
+	/// Must be called before flush since flush moves on to the next frame slot.
 	void record(vk::CommandBuffer cmdBuffer);
 
+	/// Records all draw commands since the last start call split into chunks into the given
+	/// secondary command buffers, in parallel if the Renderer has recordThreads > 1.
+	/// Begins (for the given framebuffer, may be null) and ends the command buffers and sets
+	/// the viewport and scissor to the given size. Returns how many of the command
+	/// buffers were used, small frames are split into fewer chunks. They must be executed
+	/// in the given order in a render pass compatible to the one of this Renderer.
+	/// Must be called before flush, like record.
+	unsigned int record(nytl::Span<const vk::CommandBuffer> cmdBuffers, vk::Framebuffer fb,
+		const vk::Extent2D& size);
+
 	/// Creates a texture for the given parameters and returns its id.
+	/// Single channel textures are drawn as alpha mask (r8Unorm) or as signed distance
+	/// field with the inside positive (r8Snorm).
+	/// The data is copied into a staging buffer and uploaded in the next flush. Only blocks
+	/// while the current frame slot is still used by the device, other contexts sharing
+	/// this Renderer are not blocked meanwhile. If asyncUploads is enabled the upload is done on a transfer queue.
+	/// The image flags are the nanovg ones (NVGimageFlags). They select the sampler
+	/// (repeat, nearest filtering, mipmaps), whether the data is premultiplied and whether
+	/// it is flipped when drawn. The sampler applies to the pattern coordinates of fills
+	/// and strokes, which leave [0, 1] outside of the pattern rect, so only image patterns
+	/// repeat; triangles (text) sample at their vertex texture coordinates.
+	/// Mipmaps are generated on the device with blits after every upload, they are not
+	/// generated for formats that cannot be blitted.
+	/// If atlas is true and the texture is small enough it is packed into an atlas page,
+	/// see RendererSettings::atlasSize. Never done for repeated, nearest filtered or
+	/// mipmapped textures.
 	unsigned int createTexture(vk::Format format, unsigned int width, unsigned int height,
-		const std::uint8_t* data = nullptr);
+		const std::uint8_t* data = nullptr, int imageFlags = 0, bool atlas = false);
+
+	/// Updates the texture data at the given position and the given size.
+	/// Note that the given data is NOT tightly packed but must hold data for the whole texture
+	/// extent. Only the rows of the given region are staged, the upload is recorded
+	/// together with all other uploads in the next flush.
+	/// If the given id could not be found returns false.
+	bool updateTexture(unsigned int id, const vk::Offset2D& offset, const vk::Extent2D& size,
+		const std::uint8_t& data);
+
+	/// Records the pending texture uploads into the given command buffer.
+	/// Called by flush, must only be called manually if the commands are recorded using
+	/// record. Must be called outside of a render pass and be executed before the
+	/// commands recorded by record.
+	/// Uploads done on the transfer queue are only submitted by flush, so asyncUploads
+	/// should be disabled if only record is used.
+	void recordUploads(vk::CommandBuffer cmdBuffer);
 
 	/// Deletes the texture with the given id.
 	/// If the given id could not be found returns false.
 	bool deleteTexture(unsigned int id);
 
+	/// Calls func(data, i) for every i in [0, count) and blocks until all calls have finished.
+	/// Uses the recording threads if recordThreads > 1. Used by contexts created with
+	/// createContext to tessellate large paths in parallel. Must not be called concurrently.
+	void dispatch(unsigned int count, void (*func)(void* data, int index), void* data);
+
+	/// The sampler of textures without image flags.
 	const vpp::Sampler& sampler() const { return sampler_; }
 	const vpp::RenderPass& renderPass() const { return renderPass_; }
-	const vpp::Buffer& uniformBuffer() const { return uniformBuffer_; }
-	const vpp::Buffer& vertexBuffer() const { return vertexBuffer_; }
-	const vpp::DescriptorPool& descriptorPool() const { return descriptorPool_; }
 	const vpp::DescriptorSetLayout& descriptorLayout() const { return descriptorLayout_; }
 	const vpp::PipelineLayout& pipelineLayout() const { return pipelineLayout_; }
 
-	const vpp::Swapchain* swapchain() const { return swapchain_; }
-	const vpp::SwapchainRenderer& renderer() const { return renderer_; }
+	/// The resources of the current frame slot.
+	const vpp::Buffer& uniformBuffer() const;
+	const vpp::Buffer& vertexBuffer() const;
+	const vpp::DescriptorPool& descriptorPool() const;
+	const vpp::CommandBuffer& commandBuffer() const;
 
+	const vpp::Swapchain* swapchain() const { return swapchain_; }
 	const vpp::Framebuffer* framebuffer() const { return framebuffer_; }
-	const vpp::CommandBuffer& commandBuffer() const { return commandBuffer_; }
+	bool offscreen() const { return offscreen_; }
 	vk::RenderPass vkRenderPass() const
-		{ return swapchain_ ? renderPass_ : renderPassHandle_; }
+		{ return (swapchain_ || offscreen_) ? renderPass_ : renderPassHandle_; }
+
+	const RendererSettings& settings() const { return settings_; }
+
+	/// Returns whether fringes are drawn, see RendererSettings::edgeAntiAlias.
+	bool edgeAntiAlias() const { return edgeAA_; }
+
+	/// Returns the current contents of the pipeline cache, including all pipelines
+	/// created so far. Can be stored by the application and passed as
+	/// RendererSettings::pipelineCacheData to the next Renderer.
+	std::vector<std::uint8_t> pipelineCacheData() const;
 
 protected:
+	friend class DrawList;
+
 	void init();
-	void initRenderPass(const vpp::Device& dev, vk::Format attachment);
+	void initRenderPass(const vpp::Device& dev, vk::Format attachment,
+		vk::ImageLayout finalLayout = vk::ImageLayout::presentSrcKHR);
+	void initRenderTargets();
+
+	/// Returns the current frame slot. If it is still in use by the device, waits for it.
+	/// The shared mutex is released while waiting, given lock must hold it once.
+	/// The overloads without lock must be called without holding it.
+	Frame& currentFrame(std::unique_lock<std::recursive_mutex>& lock);
+	Frame& currentFrame();
+	void waitFrame(Frame& frame, std::unique_lock<std::recursive_mutex>& lock);
+	void waitFrame(Frame& frame);
+
+	/// Makes sure the frame has a cached descriptor set for every texture used.
+	void updateDescriptors(Frame& frame);
+
+	/// Prepares the current frame for recording, i.e. updates the descriptors and
+	/// batches the draws. Does nothing if the frame was already prepared.
+	void prepare();
+
+	/// Converts all draws to indexed triangle lists and merges adjacent ones that
+	/// use the same state into one DrawCall.
+	void batch(Frame& frame);
+
+	/// Returns the pipeline for the given draw type and paint variant.
+	/// Creates it if it was not used before.
+	/// Thread-safe, can be called by the prewarm thread and the rendering thread.
+	vk::Pipeline pipelineVariant(PipelineType type, std::uint8_t variant);
+	vpp::Pipeline createPipeline(PipelineType type, std::uint8_t variant);
+
+	/// Creates all pipeline variants that can be used with the settings of this Renderer.
+	/// Returns early when stopPrewarm is called from another thread.
+	void prewarmPipelines();
+
+	/// Stops the background prewarm thread, if any, and waits for it to finish.
+	void stopPrewarm();
+
+	/// Loads the initial pipeline cache from the settings, see pipelineCachePath.
+	void initPipelineCache();
 
 	//for the c implementation
 	Renderer& operator=(Renderer&& other) = default;
 
+	/// Textures are sampled in pattern space unless vertexTexCoords is set (for triangles).
 	DrawData& parsePaint(const NVGpaint& paint, const NVGscissor& scissor, float fringe,
-		float strokeWidth);
+		float strokeWidth, VertexOrigin& origin, bool vertexTexCoords = false);
+
+	/// Copies the given data (can be null) into the staging buffer of the current frame slot
+	/// and queues its upload.
+	void upload(const Texture& tex, const std::uint8_t* data, bool initial);
+
+	/// Records the copies of captured scene data queued in the given frame.
+	void recordSceneUploads(vk::CommandBuffer cmdBuffer, Frame& frame);
+
+	/// Reads the timestamps of the finished profiled frame and publishes its stats.
+	void finishStats(Frame& frame);
+
+	/// Returns the id of a new texture in a free slot of textures_.
+	unsigned int allocateTexture();
+
+	/// Packs a texture into an atlas page, creates a new page if no one has space.
+	unsigned int createAtlasTexture(vk::Format format, unsigned int width, unsigned int height,
+		const std::uint8_t* data, int imageFlags);
+
+	/// Returns the sampler for textures with the given image flags, created when first used.
+	const vpp::Sampler& textureSampler(int imageFlags);
+
+	/// Stages the data of the given atlas texture (tightly packed) with its padding.
+	void uploadAtlas(const Texture& tex, const std::uint8_t* data);
+
+	/// Records the given draw calls reading the given vertex and index buffers.
+	/// Returns the number of pipeline binds.
+	unsigned int recordDrawCalls(vk::CommandBuffer cmdBuffer, vk::Buffer vertices,
+		vk::Buffer indices, nytl::Span<const DrawCall> calls);
+
+	/// Submits the queued transfer queue uploads of the frame. Returns false if there were none,
+	/// otherwise the uploadSemaphore of the frame will be signaled.
+	bool submitTransferUploads(Frame& frame);
+
+	/// Appends the draws of all submitted draw lists to the current frame.
+	void appendDrawLists();
+
+	/// Writes the given vertices into the vertex stream of the current frame slot.
+	/// Compact vertices are stored relative to the given origin.
+	/// Returns the index of the first written vertex.
+	std::size_t writeVertices(nytl::Span<const NVGvertex> verts, const VertexOrigin& origin);
+
+	/// Copies the given number of vertices, already in the vertex format of this Renderer,
+	/// into the vertex stream of the current frame slot. Returns the index of the first one.
+	std::size_t writeVertexData(const void* data, std::size_t count);
+
+	/// The size of one vertex in the vertex buffers.
+	std::size_t vertexSize() const;
+
+	/// Whether the settings and render target allow partial redraws, see dirtyRegions.
+	bool dirtyRegions() const;
+
+	/// Compares the draws of the given (prepared) frame with the ones of the last
+	/// rendered frame and returns the region of the render target that changed.
+	/// Returns an empty rect if nothing changed.
+	vk::Rect2D trackDamage(const Frame& frame, const vk::Extent2D& size);
 
 protected:
 	const vpp::Swapchain* swapchain_ = nullptr; // if rendering on swapchain
-	vpp::SwapchainRenderer renderer_; // used if rendering on swapchain
-	vpp::RenderPass renderPass_; // for swapchain
+	std::vector<RenderTarget> renderTargets_; // one for each swapchain image or frame slot
+	vpp::RenderPass renderPass_; // for swapchain and offscreen
+	vpp::RenderPass partialRenderPass_; // keeps the image outside the render area, for dirtyRegions
 
 	const vpp::Framebuffer* framebuffer_ = nullptr; // if rendering into framebuffer
-	vpp::CommandBuffer commandBuffer_; // commandBuffer to submit if rendering into fb
-	const vpp::Queue* renderQueue_; // queue used for rendering if rendering into fb
+	const vpp::Queue* renderQueue_; // queue used for rendering
 	const vpp::Queue* presentQueue_; // queue for presenting
+	const vpp::Queue* transferQueue_ {}; // queue for async uploads, may be null
 	vk::RenderPass renderPassHandle_; // for framebuffer
 
-	unsigned int texID_ = 0; // the currently highest texture id
-	std::vector<Texture> textures_;
-
-	vpp::Buffer uniformBuffer_;
-	vpp::Buffer vertexBuffer_;
+	vk::Format renderPassFormat_ {}; // the color format of renderPass_
+	bool outOfDate_ = false; // whether the swapchain has to be recreated
+	bool offscreen_ = false; // if rendering into own images
+	vk::Format offscreenFormat_ {};
+	vk::Extent2D offscreenSize_ {};
+
+	RendererSettings settings_;
+	std::vector<Frame> frames_; // the frame slots
+	unsigned int frameIndex_ = 0; // the current frame slot
+	std::uint64_t submitted_ {}; // number of submitted frames
+	std::uint64_t completed_ {}; // number of frames known to be finished by the device
+
+	// texture slot map. The ids store the slot index (+1) in the lower bits and
+	// the generation of the slot in the upper bits. Kept positive since nanovg uses ints.
+	static constexpr unsigned int textureIndexBits = 20;
+	static constexpr unsigned int textureIndexMask = (1u << textureIndexBits) - 1;
+	static constexpr unsigned int textureIDMask = 0x7FFFFFFFu;
+
+	struct TextureSlot {
+		Texture texture; // empty (id 0) if the slot is free
+		unsigned int generation {};
+	};
+
+	std::vector<TextureSlot> textures_;
+	std::vector<unsigned int> freeTextureSlots_;
+
+	// deleted textures and the number of submitted frames when they were deleted.
+	// Destroyed once all those frames have finished.
+	std::vector<std::pair<std::uint64_t, Texture>> destroyed_;
+	std::vector<AtlasPage> atlasPages_;
 
 	std::vector<DrawData> drawDatas_;
-	std::vector<NVGvertex> vertices_;
+	std::vector<Path> paths_; // the paths of the drawDatas_
+	std::vector<DrawCall> drawCalls_; // the batched draw calls of the current frame
+	bool prepared_ = false; // whether drawCalls_ match drawDatas_
+	std::unique_ptr<WorkerPool> workers_; // for parallel recording, if recordThreads > 1
+	std::unique_ptr<RendererShared> shared_; // state used by shared contexts
+	std::size_t uniformAlignment_ {}; // alignment for the uniform buffer offsets
 
 	unsigned int width_ {};
 	unsigned int height_ {};
 
-	vpp::Sampler sampler_;
+	// dirty region tracking: the draws of the last rendered frame and the changed regions
+	// of the last frames with their numbers, combined for swapchain images drawn
+	// some frames ago
+	std::vector<DrawRecord> drawRecords_;
+	std::vector<std::pair<std::uint64_t, vk::Rect2D>> damages_;
+	vk::Extent2D damageViewport_ {}; // viewport of the last rendered frame
+	bool damageScenes_ = false; // whether the last rendered frame drew scenes
+	vk::Rect2D renderArea_ {}; // of the frame being recorded, empty extent for everything
 
-	vpp::DescriptorPool descriptorPool_;
+	std::unique_ptr<Profiler> profiler_; // if profiling is enabled
+	FrameStats stats_; // of the last finished profiled frame
+
+	vpp::Sampler sampler_;
+	std::unordered_map<int, vpp::Sampler> samplers_; // by the sampler image flags
 	vpp::DescriptorSetLayout descriptorLayout_;
-	unsigned int descriptorPoolSize_ {}; // current maximal draw calls count
 
 	vpp::PipelineLayout pipelineLayout_;
-	vpp::Pipeline fanPipeline_;
-	vpp::Pipeline stripPipeline_;
-	vpp::Pipeline listPipeline_;
-	unsigned int bound_ = 0;
+	vpp::PipelineCache pipelineCache_;
+	vpp::ShaderModule vertexShader_;
+	vpp::ShaderModule fragmentShader_;
+	vpp::ShaderModule shapeVertexShader_;
+	vpp::ShaderModule shapeFragmentShader_;
+	std::unordered_map<std::uint32_t, vpp::Pipeline> pipelines_; // by type and variant
 
 	Texture dummyTexture_;
 
@@ -193,6 +662,16 @@ protected:
 /// Renderer object.
 NVGcontext* createContext(std::unique_ptr<Renderer> renderer);
 
+/// Creates a nanovg context that uses the device resources (pipelines, textures, frame slots)
+/// of the given Renderer but records its draws on its own, e.g. on another thread.
+/// When a frame of the context ends (nvgEndFrame) its draws are submitted to the Renderer
+/// without locking and are rendered with its next flush, after the draws of the Renderer
+/// itself. Draw lists are rendered sorted by the given order and then by submission order.
+/// The textures of the context are textures of the Renderer. Submitted draws of textures
+/// that are deleted before the next flush are drawn with an empty texture. The context
+/// must be destroyed before the Renderer.
+NVGcontext* createSharedContext(Renderer& renderer, int order = 0);
+
 /// Creates the nanovg context for a given Swapchain.
 NVGcontext* createContext(const vpp::Swapchain& swapchain);
 